@@ -198,6 +198,9 @@ struct _ntfs_attr {
 	u8 compression_block_size_bits;
 	u8 compression_block_clusters;
 	s8 unused_runs; /* pre-reserved entries available */
+	struct COMPRESSED_CACHE *cb_cache; /* decompressed blocks, see compress.c */
+	s32 rl_count;	/* elements before the terminator of rl, 0 if unknown */
+	s32 rl_hint;	/* element found by the last ntfs_attr_find_vcn() */
 };
 
 /**
@@ -214,6 +217,17 @@ typedef enum {
 	NA_RunlistDirty,	/* 1: Runlist has been updated */
 } ntfs_attr_state_bits;
 
+/*
+ * ntfs_attr_rl_changed - forget the shape of the runlist of @na
+ *
+ * To be called whenever the runlist is replaced, freed or loses elements,
+ * so that ntfs_attr_find_vcn() does not search stale elements.
+ */
+static __inline__ void ntfs_attr_rl_changed(ntfs_attr *na)
+{
+	na->rl_count = 0;
+}
+
 #define  test_nattr_flag(na, flag)	 test_bit(NA_##flag, (na)->state)
 #define   set_nattr_flag(na, flag)	  set_bit(NA_##flag, (na)->state)
 #define clear_nattr_flag(na, flag)	clear_bit(NA_##flag, (na)->state)
@@ -298,6 +312,8 @@ extern void ntfs_attr_close(ntfs_attr *na);
 
 extern s64 ntfs_attr_pread(ntfs_attr *na, const s64 pos, s64 count,
 		void *b);
+extern s64 ntfs_attr_bulk_read(ntfs_attr *na, const s64 pos, s64 count,
+		void *b);
 extern s64 ntfs_attr_pwrite(ntfs_attr *na, const s64 pos, s64 count,
 		const void *b);
 extern int ntfs_attr_pclose(ntfs_attr *na);
@@ -352,6 +368,8 @@ extern int ntfs_attr_update_mapping_pairs(ntfs_attr *na, VCN from_vcn);
 
 extern int ntfs_attr_truncate(ntfs_attr *na, const s64 newsize);
 extern int ntfs_attr_truncate_solid(ntfs_attr *na, const s64 newsize);
+extern int ntfs_attr_reserve(ntfs_attr *na, s64 size);
+extern int ntfs_attr_release_reserve(ntfs_attr *na);
 
 /**
  * get_attribute_value_length - return the length of the value of an attribute
@@ -53,6 +53,16 @@ struct CACHED_NIDATA {
 	ntfs_inode *ni;
 } ;
 
+struct CACHED_MFT {
+	struct CACHED_MFT *next;
+	struct CACHED_MFT *previous;
+	MFT_RECORD *mrec;	/* fixed up record */
+	size_t mrecsize;
+	union ALIGNMENT payload[0];
+		/* above fields must match "struct CACHED_GENERIC" */
+	u64 mft_no;
+} ;
+
 struct CACHED_LOOKUP {
 	struct CACHED_LOOKUP *next;
 	struct CACHED_LOOKUP *previous;
@@ -92,10 +102,30 @@ struct CACHE_HEADER {
 	unsigned long writes;
 	unsigned long hits;
 	int fixed_size;
+	int item_count;
 	int max_hash;
 	struct CACHED_GENERIC entry[0];
 } ;
 
+	/* the caches of a volume, as sized by ntfs_lru_cache_sizes() */
+enum {
+	LRU_INODE,
+	LRU_NIDATA,
+	LRU_LOOKUP,
+	LRU_SECURID,
+	LRU_LEGACY,
+	LRU_MFT,
+	LRU_COUNT
+} ;
+
+struct CACHE_STATS {
+	const char *name;
+	int entries;		/* zero if the cache is not present */
+	unsigned long reads;
+	unsigned long writes;
+	unsigned long hits;
+} ;
+
 	/* cast to generic, avoiding gcc warnings */
 #define GENERIC(pstr) ((const struct CACHED_GENERIC*)(const void*)(pstr))
 
@@ -111,8 +141,14 @@ int ntfs_invalidate_cache(struct CACHE_HEADER *cache,
 int ntfs_remove_cache(struct CACHE_HEADER *cache,
 			struct CACHED_GENERIC *item, int flags);
 
+void ntfs_lru_cache_sizes(const ntfs_volume *vol, s64 budget,
+			int sizes[LRU_COUNT]);
+void ntfs_create_lru_caches_sized(ntfs_volume *vol,
+			const int sizes[LRU_COUNT]);
 void ntfs_create_lru_caches(ntfs_volume *vol);
 void ntfs_free_lru_caches(ntfs_volume *vol);
+int ntfs_lru_cache_stats(const ntfs_volume *vol,
+			struct CACHE_STATS stats[LRU_COUNT]);
 
 #endif /* _NTFS_CACHE_H_ */
 
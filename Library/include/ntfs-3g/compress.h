@@ -37,5 +37,7 @@ extern s64 ntfs_compressed_pwrite(ntfs_attr *na, runlist_element *brl, s64 wpos,
 extern int ntfs_compressed_close(ntfs_attr *na, runlist_element *brl,
 				s64 offs, VCN *update_from);
 
+extern void ntfs_compressed_cache_free(ntfs_attr *na);
+
 #endif /* defined _NTFS_COMPRESS_H */
 
@@ -62,9 +62,13 @@ extern ntfschar NTFS_INDEX_R[3];
 extern u64 ntfs_inode_lookup_by_name(ntfs_inode *dir_ni,
 		const ntfschar *uname, const int uname_len);
 extern u64 ntfs_inode_lookup_by_mbsname(ntfs_inode *dir_ni, const char *name);
+extern u64 ntfs_inode_lookup_by_ucsname(ntfs_inode *dir_ni,
+		const ntfschar *uname, int uname_len);
 extern void ntfs_inode_update_mbsname(ntfs_inode *dir_ni, const char *name,
 				u64 inum);
 
+extern ntfs_inode *ntfs_ucs_pathname_to_inode(ntfs_volume *vol,
+		ntfs_inode *parent, const ntfschar *path, int len);
 extern ntfs_inode *ntfs_pathname_to_inode(ntfs_volume *vol, ntfs_inode *parent,
 		const char *pathname);
 extern ntfs_inode *ntfs_create(ntfs_inode *dir_ni, le32 securid,
@@ -108,6 +112,16 @@ typedef int (*ntfs_filldir_t)(void *dirent, const ntfschar *name,
 extern int ntfs_readdir(ntfs_inode *dir_ni, s64 *pos,
 		void *dirent, ntfs_filldir_t filldir);
 
+/*
+ * This is the "ntfs_fnfilldir" function type, used by ntfs_readdir_fn()
+ * to hand the FILE_NAME_ATTR index key of each directory entry.
+ */
+typedef int (*ntfs_fnfilldir_t)(void *dirent, const FILE_NAME_ATTR *fn,
+		const s64 pos, const MFT_REF mref, const unsigned dt_type);
+
+extern int ntfs_readdir_fn(ntfs_inode *dir_ni, s64 *pos,
+		void *dirent, ntfs_fnfilldir_t fnfilldir);
+
 ntfs_inode *ntfs_dir_parent_inode(ntfs_inode *ni);
 u32 ntfs_interix_types(ntfs_inode *ni);
 
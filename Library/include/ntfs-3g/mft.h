@@ -130,5 +130,13 @@ extern int ntfs_mft_record_free(ntfs_volume *vol, ntfs_inode *ni);
 
 extern int ntfs_mft_usn_dec(MFT_RECORD *mrec);
 
+#if CACHE_MFT_SIZE
+
+struct CACHED_GENERIC;
+
+extern int ntfs_mft_cache_hash(const struct CACHED_GENERIC *cached);
+
+#endif
+
 #endif /* defined _NTFS_MFT_H */
 
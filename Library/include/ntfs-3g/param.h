@@ -27,6 +27,10 @@
 #define CACHE_LOOKUP_SIZE 64	/* lookup cache, zero or >= 3 and not too big */
 #define CACHE_SECURID_SIZE 16    /* securid cache, zero or >= 3 and not too big */
 #define CACHE_LEGACY_SIZE 8    /* legacy cache size, zero or >= 3 and not too big */
+#define CACHE_CB_BUDGET 262144	/* bytes of decompressed blocks per attribute */
+#define CACHE_MFT_SIZE 256	/* mft record cache, zero or >= 3 and not too big */
+#define MFT_READ_AHEAD 16384	/* bytes of mft records read at once on a miss */
+#define CACHE_MAX_ENTRIES 1048576 /* max size of a cache sized at mount time */
 
 #define FORCE_FORMAT_v1x 0	/* Insert security data as in NTFS v1.x */
 #define OWNERFROMACL 1		/* Get the owner from ACL (not Windows owner) */
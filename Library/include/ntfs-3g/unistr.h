@@ -35,6 +35,10 @@ extern int ntfs_names_full_collate(const ntfschar *name1, const u32 name1_len,
 		const IGNORE_CASE_BOOL ic,
 		const ntfschar *upcase, const u32 upcase_len);
 
+extern int ntfs_names_upcased_collate(const ntfschar *key, const u32 key_len,
+		const ntfschar *name, const u32 name_len,
+		const ntfschar *upcase, const u32 upcase_len);
+
 extern int ntfs_ucsncmp(const ntfschar *s1, const ntfschar *s2, size_t n);
 
 extern int ntfs_ucsncasecmp(const ntfschar *s1, const ntfschar *s2, size_t n,
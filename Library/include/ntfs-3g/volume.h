@@ -254,6 +254,9 @@ struct _ntfs_volume {
 	s64 free_clusters; 	/* Track the number of free clusters which
 				   greatly improves statfs() performance */
 	s64 free_mft_records; 	/* Same for free mft records (see above) */
+	s64 mft_record_reads;	/* Count of mft records read from $MFT */
+	s64 index_block_reads;	/* Count of index blocks read from
+				   $INDEX_ALLOCATION attributes */
 	BOOL efs_raw;		/* volume is mounted for raw access to
 				   efs-encrypted files */
 #ifdef XATTR_MAPPINGS
@@ -274,6 +277,9 @@ struct _ntfs_volume {
 #if CACHE_LEGACY_SIZE
 	struct CACHE_HEADER *legacy_cache;
 #endif
+#if CACHE_MFT_SIZE
+	struct CACHE_HEADER *mft_cache;
+#endif
 
 };
 
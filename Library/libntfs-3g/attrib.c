@@ -322,6 +322,7 @@ static void __ntfs_attr_init(ntfs_attr *na, ntfs_inode *ni,
 		const ATTR_TYPES type, ntfschar *name, const u32 name_len)
 {
 	na->rl = NULL;
+	ntfs_attr_rl_changed(na);
 	na->ni = ni;
 	na->type = type;
 	na->name = name;
@@ -537,6 +538,7 @@ void ntfs_attr_close(ntfs_attr *na)
 {
 	if (!na)
 		return;
+	ntfs_compressed_cache_free(na);
 	if (NAttrNonResident(na) && na->rl)
 		free(na->rl);
 	/* Don't release if using an internal constant. */
@@ -581,6 +583,7 @@ int ntfs_attr_map_runlist(ntfs_attr *na, VCN vcn)
 				na->rl);
 		if (rl) {
 			na->rl = rl;
+			ntfs_attr_rl_changed(na);
 			ntfs_attr_put_search_ctx(ctx);
 			return 0;
 		}
@@ -643,6 +646,7 @@ static int ntfs_attr_map_partial_runlist(ntfs_attr *na, VCN vcn)
 				rl = na->rl;
 			if (rl) {
 				na->rl = rl;
+				ntfs_attr_rl_changed(na);
 				highest_vcn = sle64_to_cpu(a->highest_vcn);
 				if (highest_vcn < needed) {
 				/* corruption detection on unchanged runlists */
@@ -738,6 +742,7 @@ int ntfs_attr_map_whole_runlist(ntfs_attr *na)
 			if (!rl)
 				goto err_out;
 			na->rl = rl;
+			ntfs_attr_rl_changed(na);
 		}
 
 		/* Are we in the first extent? */
@@ -865,6 +870,11 @@ retry:
  * on read and allocate clusters on write. You need to update the runlist, the
  * attribute itself as well as write the modified mft record to disk.
  *
+ * The runlist of heavily fragmented attributes can be very long, so the
+ * element found is remembered to serve sequential accesses at once, and
+ * other vcns are binary searched among the elements counted when the
+ * runlist was last walked.
+ *
  * If there is an error return NULL with errno set to the error code. The
  * following error codes are defined:
  *	EINVAL		Input parameter error.
@@ -876,6 +886,7 @@ runlist_element *ntfs_attr_find_vcn(ntfs_attr *na, const VCN vcn)
 {
 	runlist_element *rl;
 	BOOL is_retry = FALSE;
+	s32 n, i, lo, hi;
 
 	if (!na || !NAttrNonResident(na) || vcn < 0) {
 		errno = EINVAL;
@@ -891,6 +902,42 @@ retry:
 		goto map_rl;
 	if (vcn < rl[0].vcn)
 		goto map_rl;
+	if (!na->rl_count) {
+		/* Count the elements, the runlist was changed. */
+		while (rl->length)
+			rl++;
+		na->rl_count = rl - na->rl;
+		na->rl_hint = 0;
+		rl = na->rl;
+	}
+	/*
+	 * Elements may have been appended since they were counted, but the
+	 * counted ones are still valid. Try the last element found and the
+	 * next one, then binary search the counted elements.
+	 */
+	n = na->rl_count;
+	i = na->rl_hint;
+	if (i < n && vcn >= rl[i + 1].vcn)
+		i++;
+	if (i < n && (vcn < rl[i].vcn || vcn >= rl[i + 1].vcn)) {
+		lo = 0;
+		hi = n;
+		while (lo < hi) {
+			i = lo + (hi - lo) / 2;
+			if (vcn < rl[i].vcn)
+				hi = i;
+			else if (vcn >= rl[i + 1].vcn)
+				lo = i + 1;
+			else
+				break;
+		}
+		if (lo >= hi)
+			i = n;
+	}
+	if (i < n)
+		na->rl_hint = i;
+	rl += i;
+	/* Past the counted elements, walk the runlist as it is now. */
 	while (rl->length) {
 		if (vcn < rl[1].vcn) {
 			if (rl->lcn >= (LCN)LCN_HOLE)
@@ -1184,6 +1231,109 @@ s64 ntfs_attr_pread(ntfs_attr *na, const s64 pos, s64 count, void *b)
 	return ret;
 }
 
+/**
+ * ntfs_attr_bulk_read - read a large range of a plain non-resident attribute
+ * @na:		ntfs attribute to read from
+ * @pos:	byte position in the attribute to begin reading from
+ * @count:	number of bytes to read
+ * @b:		output data buffer
+ *
+ * Same as ntfs_attr_pread(), for reading large ranges in one call. The
+ * whole runlist is mapped once, then runs which are contiguous on disk
+ * are coalesced into extents and each extent is read by a single device
+ * read straight into @b. Holes and data beyond the initialized size are
+ * zeroed in place.
+ *
+ * Compressed, encrypted and resident attributes are read through
+ * ntfs_attr_pread().
+ *
+ * Return the number of bytes read, which is lower than @count only at the
+ * end of the attribute, or -1 with errno set if nothing could be read.
+ */
+s64 ntfs_attr_bulk_read(ntfs_attr *na, const s64 pos, s64 count, void *b)
+{
+	ntfs_volume *vol;
+	runlist_element *rl;
+	s64 total, to_zero, ofs, ext_len, br;
+	LCN ext_lcn;
+	u8 bits;
+
+	if (!na || !na->ni || !na->ni->vol || !b || pos < 0 || count < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!NAttrNonResident(na)
+	    || (na->data_flags & (ATTR_COMPRESSION_MASK | ATTR_IS_ENCRYPTED)))
+		return (ntfs_attr_pread(na, pos, count, b));
+
+	vol = na->ni->vol;
+	bits = vol->cluster_size_bits;
+	if (pos >= na->data_size)
+		return 0;
+	if (count > na->data_size - pos)
+		count = na->data_size - pos;
+	if (!count)
+		return 0;
+
+	if (!NAttrFullyMapped(na) && ntfs_attr_map_whole_runlist(na))
+		return -1;
+
+	/* Zero out reads beyond initialized size. */
+	to_zero = 0;
+	if (pos + count > na->initialized_size) {
+		to_zero = pos + count - max(pos, na->initialized_size);
+		count -= to_zero;
+		memset((u8*)b + count, 0, to_zero);
+	}
+
+	total = 0;
+	if (count) {
+		rl = ntfs_attr_find_vcn(na, pos >> bits);
+		if (!rl)
+			return -1;
+		ofs = pos - (rl->vcn << bits);
+	}
+	while (total < count) {
+		if (!rl->length || ((rl->lcn < 0) && (rl->lcn != LCN_HOLE))) {
+			errno = EIO;
+			ntfs_log_perror("%s: Bad run (%lld)", __FUNCTION__,
+					(long long)rl->lcn);
+			break;
+		}
+		/* Extend the extent over the runs contiguous on disk */
+		ext_lcn = rl->lcn;
+		ext_len = (rl->length << bits) - ofs;
+		while ((ext_len < count - total)
+		    && rl[1].length
+		    && (((ext_lcn == LCN_HOLE) && (rl[1].lcn == LCN_HOLE))
+			|| ((ext_lcn >= 0)
+			    && (rl[1].lcn == rl->lcn + rl->length)))) {
+			rl++;
+			ext_len += rl->length << bits;
+		}
+		ext_len = min(ext_len, count - total);
+		if (ext_lcn == LCN_HOLE)
+			memset((u8*)b + total, 0, ext_len);
+		else {
+			br = ntfs_pread(vol->dev, (ext_lcn << bits) + ofs,
+					ext_len, (u8*)b + total);
+			if (br != ext_len) {
+				if (br > 0)
+					total += br;
+				else if (!br)
+					errno = EIO;
+				break;
+			}
+		}
+		total += ext_len;
+		rl++;
+		ofs = 0;
+	}
+	if (total < count)
+		return (total ? total : -1);
+	return (total + to_zero);
+}
+
 static int ntfs_attr_fill_zero(ntfs_attr *na, s64 pos, s64 count)
 {
 	char *buf;
@@ -1370,6 +1520,7 @@ static int ntfs_attr_fill_hole(ntfs_attr *na, s64 count, s64 *ofs,
 	if (*rl && (na->data_flags & ATTR_COMPRESSION_MASK)) {
 		runlist_element *oldrl = na->rl;
 		na->rl = *rl;
+		ntfs_attr_rl_changed(na);
 		*rl = ntfs_rl_extend(na,*rl,2);
 		if (!*rl) na->rl = oldrl; /* restore to original if failed */
 	}
@@ -1385,6 +1536,7 @@ static int ntfs_attr_fill_hole(ntfs_attr *na, s64 count, s64 *ofs,
 	}
 	na->unused_runs = 2;
 	na->rl = *rl;
+	ntfs_attr_rl_changed(na);
 	if ((*update_from == -1) || (from_vcn < *update_from))
 		*update_from = from_vcn;
 	*rl = ntfs_attr_find_vcn(na, cur_vcn);
@@ -1804,6 +1956,8 @@ static s64 ntfs_attr_pwrite_i(ntfs_attr *na, const s64 pos, s64 count,
 	compressed = (na->data_flags & ATTR_COMPRESSION_MASK)
 			 != const_cpu_to_le16(0);
 	na->unused_runs = 0; /* prepare overflow checks */
+	/* Blocks decompressed earlier may be overwritten */
+	ntfs_compressed_cache_free(na);
 	/*
 	 * Encrypted attributes are only supported in raw mode.  We return
 	 * access denied, which is what Windows NT4 does, too.
@@ -4830,6 +4984,7 @@ int ntfs_attr_make_non_resident(ntfs_attr *na,
 	NAttrSetNonResident(na);
 	NAttrSetBeingNonResident(na);
 	na->rl = rl;
+	ntfs_attr_rl_changed(na);
 	na->allocated_size = new_allocated_size;
 	na->data_size = na->initialized_size = le32_to_cpu(a->value_length);
 	/*
@@ -4950,6 +5105,7 @@ cluster_free_err_out:
 	NAttrClearFullyMapped(na);
 	na->allocated_size = na->data_size;
 	na->rl = NULL;
+	ntfs_attr_rl_changed(na);
 	free(rl);
 	errno = err;
 	return -1;
@@ -5431,6 +5587,7 @@ static int ntfs_attr_make_resident(ntfs_attr *na, ntfs_attr_search_ctx *ctx)
 	/* Throw away the now unused runlist. */
 	free(na->rl);
 	na->rl = NULL;
+	ntfs_attr_rl_changed(na);
 
 	/* Update in-memory struct ntfs_attr. */
 	NAttrClearNonResident(na);
@@ -6077,6 +6234,7 @@ static int ntfs_non_resident_attr_shrink(ntfs_attr *na, const s64 newsize)
 		}
 
 		/* Truncate the runlist itself. */
+		ntfs_attr_rl_changed(na);
 		if (ntfs_rl_truncate(&na->rl, first_free_vcn)) {
 			/*
 			 * Failed to truncate the runlist, so just throw it
@@ -6304,6 +6462,7 @@ static int ntfs_non_resident_attr_expand_i(ntfs_attr *na, const s64 newsize,
 			return -1;
 		}
 		na->rl = rln;
+		ntfs_attr_rl_changed(na);
 		NAttrSetRunlistDirty(na);
 
 		/* Prepare to mapping pairs update. */
@@ -6380,6 +6539,7 @@ rollback:
 		ntfs_log_perror("Leaking clusters");
 	}
 	/* Now, truncate the runlist itself. */
+	ntfs_attr_rl_changed(na);
 	if (ntfs_rl_truncate(&na->rl, org_alloc_size >>
 			vol->cluster_size_bits)) {
 		/*
@@ -6463,6 +6623,7 @@ static int ntfs_attr_truncate_i(ntfs_attr *na, const s64 newsize,
 		ret = STATUS_OK;
 		goto out;
 	}
+	ntfs_compressed_cache_free(na);
 	/*
 	 * Encrypted attributes are not supported. We return access denied,
 	 * which is what Windows NT4 does, too.
@@ -6540,6 +6701,81 @@ int ntfs_attr_truncate_solid(ntfs_attr *na, const s64 newsize)
 	return (ntfs_attr_truncate_i(na, newsize, HOLES_NO));
 }
 
+/*
+ *		Reserve clusters beyond the end of data
+ *
+ *	The allocation of a plain non resident $DATA attribute is extended
+ *	so that @size bytes fit, the data size is not changed. Appending
+ *	up to @size then neither allocates clusters nor rewrites the
+ *	mapping pairs. The clusters left unused are freed by
+ *	ntfs_attr_release_reserve().
+ *
+ *	Returns 0 if succeeded (or nothing to reserve),
+ *		-1 if it failed (as explained in errno)
+ */
+
+int ntfs_attr_reserve(ntfs_attr *na, s64 size)
+{
+	ntfs_attr_search_ctx *ctx;
+	s64 data_size;
+	int res;
+
+	if (!na || (na->type != AT_DATA) || !NAttrNonResident(na)
+	    || (na->data_flags & (ATTR_COMPRESSION_MASK | ATTR_IS_ENCRYPTED))) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if (size <= na->allocated_size)
+		return (0);
+	data_size = na->data_size;
+	res = ntfs_non_resident_attr_expand(na, size, HOLES_NO);
+	NAttrClearDataAppending(na);
+	if (res)
+		return (-1);
+		/* only the allocation was wanted, put back the data size */
+	ctx = ntfs_attr_get_search_ctx(na->ni, NULL);
+	if (ctx && !ntfs_attr_lookup(na->type, na->name, na->name_len,
+				CASE_SENSITIVE, 0, NULL, 0, ctx)) {
+		na->data_size = data_size;
+		ctx->attr->data_size = cpu_to_sle64(data_size);
+		if (na->name == AT_UNNAMED)
+			na->ni->data_size = data_size;
+		ntfs_inode_mark_dirty(ctx->ntfs_ino);
+	} else {
+		ntfs_log_perror("Failed to restore the data size");
+		res = -1;
+	}
+	if (ctx)
+		ntfs_attr_put_search_ctx(ctx);
+	if (res)
+		ntfs_non_resident_attr_shrink(na, data_size);
+	return (res);
+}
+
+/*
+ *		Free the clusters allocated beyond the end of data
+ *
+ *	Returns 0 if succeeded (or nothing to free),
+ *		-1 if it failed (as explained in errno)
+ */
+
+int ntfs_attr_release_reserve(ntfs_attr *na)
+{
+	s64 cluster_size;
+
+	if (!na) {
+		errno = EINVAL;
+		return (-1);
+	}
+	cluster_size = na->ni->vol->cluster_size;
+	if (!NAttrNonResident(na)
+	    || (na->data_flags & ATTR_COMPRESSION_MASK)
+	    || (na->allocated_size
+		<= ((na->data_size + cluster_size - 1) & -cluster_size)))
+		return (0);
+	return (ntfs_non_resident_attr_shrink(na, na->data_size));
+}
+
 /*
  *		Stuff a hole in a compressed file
  *
@@ -6854,61 +7090,25 @@ int ntfs_attr_remove(ntfs_inode *ni, const ATTR_TYPES type, ntfschar *name,
 	return ret;
 }
 
-/* Below macros are 32-bit ready. */
-#define BCX(x) ((x) - (((x) >> 1) & 0x77777777) - \
-		      (((x) >> 2) & 0x33333333) - \
-		      (((x) >> 3) & 0x11111111))
-#define BITCOUNT(x) (((BCX(x) + (BCX(x) >> 4)) & 0x0F0F0F0F) % 255)
-
-static u8 *ntfs_init_lut256(void)
-{
-	int i;
-	u8 *lut;
-	
-	lut = ntfs_malloc(256);
-	if (lut)
-		for(i = 0; i < 256; i++)
-			*(lut + i) = 8 - BITCOUNT(i);
-	return lut;
-}
-
 s64 ntfs_attr_get_free_bits(ntfs_attr *na)
 {
-	u8 *buf, *lut;
+	u8 *buf;
 	s64 br      = 0;
 	s64 total   = 0;
 	s64 nr_free = 0;
 
-	lut = ntfs_init_lut256();
-	if (!lut)
-		return -1;
-	
 	buf = ntfs_malloc(65536);
 	if (!buf)
-		goto out;
+		return -1;
 
 	while (1) {
-		u32 *p;
 		br = ntfs_attr_pread(na, total, 65536, buf);
 		if (br <= 0)
 			break;
 		total += br;
-		p = (u32 *)buf + br / 4 - 1;
-		for (; (u8 *)p >= buf; p--) {
-			nr_free += lut[ *p        & 255] + 
-			           lut[(*p >>  8) & 255] + 
-			           lut[(*p >> 16) & 255] + 
-			           lut[(*p >> 24)      ];
-		}
-		switch (br % 4) {
-			case 3:  nr_free += lut[*(buf + br - 3)];
-			case 2:  nr_free += lut[*(buf + br - 2)];
-			case 1:  nr_free += lut[*(buf + br - 1)];
-		}
+		nr_free += (br << 3) - ntfs_bits_weight(buf, br << 3);
 	}
 	free(buf);
-out:
-	free(lut);
 	if (!total || br < 0)
 		return -1;
 	return nr_free;
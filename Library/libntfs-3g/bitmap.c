@@ -100,6 +100,208 @@ char ntfs_bit_get_and_set(u8 *bitmap, const u64 bit, const u8 new_value)
 	return old_bit;
 }
 
+/*
+ * The bitmap kernels below work on 64 bits at a time. A word is loaded
+ * little endian, so bit n of the word is bit n of the field of bits on
+ * any machine, and bytes past the end of the field are never read.
+ */
+
+static __inline__ u64 ntfs_bits_load(const u8 *p, s64 nr_bits)
+{
+	u64 word;
+
+	if (nr_bits >= 64) {
+		memcpy(&word, p, sizeof(word));
+		return le64_to_cpu(word);
+	}
+	word = 0;
+	memcpy(&word, p, (nr_bits + 7) >> 3);
+	return le64_to_cpu(word) & ((1ULL << nr_bits) - 1);
+}
+
+static __inline__ int ntfs_bits_ffs(u64 word)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	int bit = 0;
+
+	if (!(word & 0xffffffffULL)) {
+		word >>= 32;
+		bit += 32;
+	}
+	if (!(word & 0xffff)) {
+		word >>= 16;
+		bit += 16;
+	}
+	if (!(word & 0xff)) {
+		word >>= 8;
+		bit += 8;
+	}
+	if (!(word & 0xf)) {
+		word >>= 4;
+		bit += 4;
+	}
+	if (!(word & 0x3)) {
+		word >>= 2;
+		bit += 2;
+	}
+	if (!(word & 0x1))
+		bit++;
+	return bit;
+#endif
+}
+
+static __inline__ int ntfs_bits_hweight(u64 word)
+{
+	word -= (word >> 1) & 0x5555555555555555ULL;
+	word = (word & 0x3333333333333333ULL)
+			+ ((word >> 2) & 0x3333333333333333ULL);
+	word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	word += word >> 8;
+	word += word >> 16;
+	word += word >> 32;
+	return word & 0x7f;
+}
+
+/**
+ * ntfs_bits_weight - count the set bits in a field of bits
+ * @bitmap:	field of bits
+ * @nr_bits:	number of bits in @bitmap
+ *
+ * Return the number of bits set among the first @nr_bits bits of @bitmap.
+ */
+s64 ntfs_bits_weight(const u8 *bitmap, s64 nr_bits)
+{
+	s64 weight = 0;
+
+	for (; nr_bits > 0; nr_bits -= 64, bitmap += 8)
+		weight += ntfs_bits_hweight(ntfs_bits_load(bitmap, nr_bits));
+	return weight;
+}
+
+/*
+ * Find the first bit in [@start, @end) of @bitmap which differs from the
+ * bits of @skip (0 or ~0).
+ */
+static s64 ntfs_bits_find(const u8 *bitmap, s64 start, s64 end, u64 skip)
+{
+	const u8 *p;
+	u64 word;
+	s64 pos;
+
+	if (start >= end)
+		return -1;
+	p = bitmap + (start >> 3);
+	pos = start & ~7LL;
+	word = (ntfs_bits_load(p, end - pos) ^ skip) & (~0ULL << (start & 7));
+	while (1) {
+		if (end - pos < 64)
+			word &= (1ULL << (end - pos)) - 1;
+		if (word)
+			return pos + ntfs_bits_ffs(word);
+		pos += 64;
+		p += 8;
+		if (pos >= end)
+			return -1;
+		word = ntfs_bits_load(p, end - pos) ^ skip;
+	}
+}
+
+/**
+ * ntfs_bits_find_zero - find the first clear bit in a field of bits
+ * @bitmap:	field of bits
+ * @start:	first bit to look at
+ * @end:	bit after the last bit to look at
+ *
+ * Return the first clear bit from @start up to @end, or -1 if there is none.
+ */
+s64 ntfs_bits_find_zero(const u8 *bitmap, s64 start, s64 end)
+{
+	return ntfs_bits_find(bitmap, start, end, ~0ULL);
+}
+
+/**
+ * ntfs_bits_find_set - find the first set bit in a field of bits
+ * @bitmap:	field of bits
+ * @start:	first bit to look at
+ * @end:	bit after the last bit to look at
+ *
+ * Return the first set bit from @start up to @end, or -1 if there is none.
+ */
+s64 ntfs_bits_find_set(const u8 *bitmap, s64 start, s64 end)
+{
+	return ntfs_bits_find(bitmap, start, end, 0);
+}
+
+/**
+ * ntfs_bits_longest_zero_run - find the longest run of clear bits
+ * @bitmap:	field of bits
+ * @nr_bits:	number of bits in @bitmap
+ * @length:	if not NULL, return the length of the run here
+ *
+ * Return the first bit of the first longest run of clear bits among the
+ * first @nr_bits bits of @bitmap, or -1 if they are all set.
+ */
+s64 ntfs_bits_longest_zero_run(const u8 *bitmap, s64 nr_bits, s64 *length)
+{
+	s64 start, end, best = -1, best_len = 0;
+
+	for (end = 0; end < nr_bits; ) {
+		start = ntfs_bits_find_zero(bitmap, end, nr_bits);
+		if (start < 0)
+			break;
+		end = ntfs_bits_find_set(bitmap, start, nr_bits);
+		if (end < 0)
+			end = nr_bits;
+		if (end - start > best_len) {
+			best = start;
+			best_len = end - start;
+		}
+	}
+	if (length)
+		*length = best_len;
+	return best;
+}
+
+/**
+ * ntfs_bits_set_range - set a run of bits in a field of bits to a value
+ * @bitmap:	field of bits
+ * @start:	first bit to set
+ * @count:	number of bits to set
+ * @value:	value to set the bits to (0 or 1)
+ */
+void ntfs_bits_set_range(u8 *bitmap, s64 start, s64 count, int value)
+{
+	u8 *p = bitmap + (start >> 3);
+	int bit = start & 7;
+	u8 mask;
+
+	if (count <= 0)
+		return;
+	if (bit) {
+		mask = 0xff << bit;
+		if (count < 8 - bit)
+			mask &= 0xff >> (8 - bit - count);
+		if (value)
+			*p++ |= mask;
+		else
+			*p++ &= ~mask;
+		count -= 8 - bit;
+		if (count <= 0)
+			return;
+	}
+	memset(p, value ? 0xff : 0, count >> 3);
+	p += count >> 3;
+	if (count & 7) {
+		mask = 0xff >> (8 - (count & 7));
+		if (value)
+			*p |= mask;
+		else
+			*p &= ~mask;
+	}
+}
+
 /**
  * ntfs_bitmap_set_bits_in_run - set a run of bits in a bitmap to a value
  * @na:		attribute containing the bitmap
@@ -33,6 +33,8 @@
 #include "types.h"
 #include "security.h"
 #include "cache.h"
+#include "inode.h"
+#include "mft.h"
 #include "misc.h"
 #include "logging.h"
 
@@ -52,8 +54,29 @@
  *	shortage of memory, data is simply not cached.
  *	When there is a hashing bug, hashing is dropped, and sequential
  *	searches are used.
+ *
+ *	The hash functions return any non-negative value, which is
+ *	reduced to the size of the hash table of the cache, so that
+ *	the size of caches can be chosen at mount time.
+ */
+
+/*
+ *		Get the hash index of an entry
+ *
+ *	Returns a negative value when the entry cannot be hashed
  */
 
+static int hashindex(const struct CACHE_HEADER *cache,
+			const struct CACHED_GENERIC *item)
+{
+	int h;
+
+	h = cache->dohash(item);
+	if (h >= 0)
+		h %= cache->max_hash;
+	return (h);
+}
+
 /*
  *		Enter a new hash index, after a new record has been inserted
  *
@@ -68,7 +91,7 @@ static void inserthashindex(struct CACHE_HEADER *cache,
 	struct HASH_ENTRY *first;
 
 	if (cache->dohash) {
-		h = cache->dohash(current);
+		h = hashindex(cache,current);
 		if ((h >= 0) && (h < cache->max_hash)) {
 			/* get a free link and insert at top of hash list */
 			link = cache->free_hash;
@@ -159,7 +182,7 @@ struct CACHED_GENERIC *ntfs_fetch_cache(struct CACHE_HEADER *cache,
 			 * When possible, use the hash table to
 			 * locate the entry if present
 			 */
-			h = cache->dohash(wanted);
+			h = hashindex(cache,wanted);
 		        link = cache->first_hash[h];
 			while (link && compare(link->entry, wanted))
 				link = link->next;
@@ -225,7 +248,7 @@ struct CACHED_GENERIC *ntfs_enter_cache(struct CACHE_HEADER *cache,
 			 * When possible, use the hash table to
 			 * find out whether the entry if present
 			 */
-			h = cache->dohash(item);
+			h = hashindex(cache,item);
 		        link = cache->first_hash[h];
 			while (link && compare(link->entry, item))
 				link = link->next;
@@ -274,7 +297,7 @@ struct CACHED_GENERIC *ntfs_enter_cache(struct CACHE_HEADER *cache,
 				before->next = (struct CACHED_GENERIC*)NULL;
 				if (cache->dohash)
 					drophashindex(cache,current,
-						cache->dohash(current));
+						hashindex(cache,current));
 				if (cache->dofree)
 					cache->dofree(current);
 				cache->oldest_entry = current->previous;
@@ -389,7 +412,7 @@ int ntfs_invalidate_cache(struct CACHE_HEADER *cache,
 			 * When possible, use the hash table to
 			 * find out whether the entry if present
 			 */
-			h = cache->dohash(item);
+			h = hashindex(cache,item);
 		        link = cache->first_hash[h];
 			while (link) {
 				if (compare(link->entry, item))
@@ -416,7 +439,7 @@ int ntfs_invalidate_cache(struct CACHE_HEADER *cache,
 					next = current->next;
 					if (cache->dohash)
 						drophashindex(cache,current,
-						    cache->dohash(current));
+						    hashindex(cache,current));
 					do_invalidate(cache,current,flags);
 					current = next;
 					count++;
@@ -437,7 +460,7 @@ int ntfs_remove_cache(struct CACHE_HEADER *cache,
 	count = 0;
 	if (cache) {
 		if (cache->dohash)
-			drophashindex(cache,item,cache->dohash(item));
+			drophashindex(cache,item,hashindex(cache,item));
 		do_invalidate(cache,item,flags);
 		count++;
 	}
@@ -483,10 +506,11 @@ static struct CACHE_HEADER *ntfs_create_cache(const char *name,
 	size_t size;
 	int i;
 
-	size = sizeof(struct CACHE_HEADER) + item_count*full_item_size;
+	size = sizeof(struct CACHE_HEADER)
+			+ (size_t)item_count*full_item_size;
 	if (max_hash)
-		size += item_count*sizeof(struct HASH_ENTRY)
-			 + max_hash*sizeof(struct HASH_ENTRY*);
+		size += (size_t)item_count*sizeof(struct HASH_ENTRY)
+			 + (size_t)max_hash*sizeof(struct HASH_ENTRY*);
 	cache = (struct CACHE_HEADER*)ntfs_malloc(size);
 	if (cache) {
 				/* header */
@@ -500,6 +524,7 @@ static struct CACHE_HEADER *ntfs_create_cache(const char *name,
 			cache->max_hash = 0;
 		}
 		cache->fixed_size = full_item_size - sizeof(struct CACHED_GENERIC);
+		cache->item_count = item_count;
 		cache->reads = 0;
 		cache->writes = 0;
 		cache->hits = 0;
@@ -548,40 +573,171 @@ static struct CACHE_HEADER *ntfs_create_cache(const char *name,
 }
 
 /*
- *		Create all LRU caches
+ *		Estimated memory used by an entry of a cache
+ *
+ *	This includes the hash entries, and the data allocated or kept
+ *	alive by the entry. Zero is returned for the caches which are
+ *	searched sequentially, they are not sized from a memory budget.
+ */
+
+static s64 lru_entry_cost(const ntfs_volume *vol, int kind)
+{
+	s64 cost;
+
+	cost = sizeof(struct HASH_ENTRY) + 2*sizeof(struct HASH_ENTRY*);
+	switch (kind) {
+	case LRU_INODE :
+			/* a path name is usually short */
+		cost += sizeof(struct CACHED_INODE) + 64;
+		break;
+	case LRU_NIDATA :
+			/* the inode is kept open with its record */
+		cost += sizeof(struct CACHED_NIDATA) + sizeof(ntfs_inode)
+			+ vol->mft_record_size;
+		break;
+	case LRU_LOOKUP :
+		cost += sizeof(struct CACHED_LOOKUP) + 32;
+		break;
+	case LRU_MFT :
+		cost += sizeof(struct CACHED_MFT) + vol->mft_record_size;
+		break;
+	default :
+		cost = 0;
+		break;
+	}
+	return (cost);
+}
+
+/*
+ *		Get the sizes of the LRU caches of a volume
+ *
+ *	When @budget is zero the sizes are the ones defined in param.h,
+ *	otherwise they are scaled so that the hashed caches use about
+ *	@budget bytes, in the proportions of param.h. The caller may then
+ *	change individual sizes before creating the caches.
+ */
+
+void ntfs_lru_cache_sizes(const ntfs_volume *vol, s64 budget,
+			int sizes[LRU_COUNT])
+{
+	static const int defaults[LRU_COUNT] = {
+		CACHE_INODE_SIZE, CACHE_NIDATA_SIZE, CACHE_LOOKUP_SIZE,
+		CACHE_SECURID_SIZE, CACHE_LEGACY_SIZE, CACHE_MFT_SIZE
+	} ;
+	s64 total;
+	s64 count;
+	int i;
+
+	total = 0;
+	for (i=0; i<LRU_COUNT; i++) {
+		sizes[i] = defaults[i];
+		total += defaults[i]*lru_entry_cost(vol, i);
+	}
+	if ((budget > 0) && total) {
+		for (i=0; i<LRU_COUNT; i++) {
+			if (defaults[i] && lru_entry_cost(vol, i)) {
+				count = budget*defaults[i]/total;
+				if (count < 3)
+					count = 3;
+				if (count > CACHE_MAX_ENTRIES)
+					count = CACHE_MAX_ENTRIES;
+				sizes[i] = count;
+			}
+		}
+	}
+}
+
+/*
+ *		Get a valid number of entries for a cache
  *
+ *	A cache must have zero or at least three entries
+ */
+
+static int lru_entries(const int sizes[LRU_COUNT], int kind)
+{
+	int count;
+
+	count = sizes[kind];
+	if (count <= 0)
+		count = 0;
+	else
+		if (count < 3)
+			count = 3;
+		else
+			if (count > CACHE_MAX_ENTRIES)
+				count = CACHE_MAX_ENTRIES;
+	return (count);
+}
+
+/*
+ *		Create all LRU caches with the given numbers of entries
+ *
+ *	The hash tables are sized from the numbers of entries.
  *	No error return, if creation is not possible, cacheing will
  *	just be not available
  */
 
-void ntfs_create_lru_caches(ntfs_volume *vol)
+void ntfs_create_lru_caches_sized(ntfs_volume *vol,
+			const int sizes[LRU_COUNT])
 {
+	int count;
+
 #if CACHE_INODE_SIZE
 		 /* inode cache */
-	vol->xinode_cache = ntfs_create_cache("inode",(cache_free)NULL,
-		ntfs_dir_inode_hash, sizeof(struct CACHED_INODE),
-		CACHE_INODE_SIZE, 2*CACHE_INODE_SIZE);
+	count = lru_entries(sizes, LRU_INODE);
+	if (count)
+		vol->xinode_cache = ntfs_create_cache("inode",
+			(cache_free)NULL, ntfs_dir_inode_hash,
+			sizeof(struct CACHED_INODE), count, 2*count);
 #endif
 #if CACHE_NIDATA_SIZE
 		 /* idata cache */
-	vol->nidata_cache = ntfs_create_cache("nidata",
-		ntfs_inode_nidata_free, ntfs_inode_nidata_hash,
-		sizeof(struct CACHED_NIDATA),
-		CACHE_NIDATA_SIZE, 2*CACHE_NIDATA_SIZE);
+	count = lru_entries(sizes, LRU_NIDATA);
+	if (count)
+		vol->nidata_cache = ntfs_create_cache("nidata",
+			ntfs_inode_nidata_free, ntfs_inode_nidata_hash,
+			sizeof(struct CACHED_NIDATA), count, 2*count);
 #endif
 #if CACHE_LOOKUP_SIZE
 		 /* lookup cache */
-	vol->lookup_cache = ntfs_create_cache("lookup",
-		(cache_free)NULL, ntfs_dir_lookup_hash,
-		sizeof(struct CACHED_LOOKUP),
-		CACHE_LOOKUP_SIZE, 2*CACHE_LOOKUP_SIZE);
+	count = lru_entries(sizes, LRU_LOOKUP);
+	if (count)
+		vol->lookup_cache = ntfs_create_cache("lookup",
+			(cache_free)NULL, ntfs_dir_lookup_hash,
+			sizeof(struct CACHED_LOOKUP), count, 2*count);
 #endif
-	vol->securid_cache = ntfs_create_cache("securid",(cache_free)NULL,
-		(cache_hash)NULL,sizeof(struct CACHED_SECURID), CACHE_SECURID_SIZE, 0);
+	count = lru_entries(sizes, LRU_SECURID);
+	if (count)
+		vol->securid_cache = ntfs_create_cache("securid",
+			(cache_free)NULL, (cache_hash)NULL,
+			sizeof(struct CACHED_SECURID), count, 0);
 #if CACHE_LEGACY_SIZE
-	vol->legacy_cache = ntfs_create_cache("legacy",(cache_free)NULL,
-		(cache_hash)NULL, sizeof(struct CACHED_PERMISSIONS_LEGACY), CACHE_LEGACY_SIZE, 0);
+	count = lru_entries(sizes, LRU_LEGACY);
+	if (count)
+		vol->legacy_cache = ntfs_create_cache("legacy",
+			(cache_free)NULL, (cache_hash)NULL,
+			sizeof(struct CACHED_PERMISSIONS_LEGACY), count, 0);
 #endif
+#if CACHE_MFT_SIZE
+		 /* mft record cache */
+	count = lru_entries(sizes, LRU_MFT);
+	if (count)
+		vol->mft_cache = ntfs_create_cache("mft",
+			(cache_free)NULL, ntfs_mft_cache_hash,
+			sizeof(struct CACHED_MFT), count, 2*count);
+#endif
+}
+
+/*
+ *		Create all LRU caches with the sizes defined in param.h
+ */
+
+void ntfs_create_lru_caches(ntfs_volume *vol)
+{
+	int sizes[LRU_COUNT];
+
+	ntfs_lru_cache_sizes(vol, 0, sizes);
+	ntfs_create_lru_caches_sized(vol, sizes);
 }
 
 /*
@@ -603,4 +759,72 @@ void ntfs_free_lru_caches(ntfs_volume *vol)
 #if CACHE_LEGACY_SIZE
 	ntfs_free_cache(vol->legacy_cache);
 #endif
+#if CACHE_MFT_SIZE
+	ntfs_free_cache(vol->mft_cache);
+#endif
+}
+
+/*
+ *		Get the statistics of a cache
+ */
+
+static void lru_cache_stats(struct CACHE_STATS *stats, const char *name,
+			const struct CACHE_HEADER *cache)
+{
+	stats->name = name;
+	if (cache) {
+		stats->entries = cache->item_count;
+		stats->reads = cache->reads;
+		stats->writes = cache->writes;
+		stats->hits = cache->hits;
+	} else {
+		stats->entries = 0;
+		stats->reads = 0;
+		stats->writes = 0;
+		stats->hits = 0;
+	}
+}
+
+/*
+ *		Get the statistics of all LRU caches of a volume
+ *
+ *	The caches which are not present are reported with no entries.
+ *	Returns the number of caches reported
+ */
+
+int ntfs_lru_cache_stats(const ntfs_volume *vol,
+			struct CACHE_STATS stats[LRU_COUNT])
+{
+#if CACHE_INODE_SIZE
+	lru_cache_stats(&stats[LRU_INODE], "inode", vol->xinode_cache);
+#else
+	lru_cache_stats(&stats[LRU_INODE], "inode",
+			(struct CACHE_HEADER*)NULL);
+#endif
+#if CACHE_NIDATA_SIZE
+	lru_cache_stats(&stats[LRU_NIDATA], "nidata", vol->nidata_cache);
+#else
+	lru_cache_stats(&stats[LRU_NIDATA], "nidata",
+			(struct CACHE_HEADER*)NULL);
+#endif
+#if CACHE_LOOKUP_SIZE
+	lru_cache_stats(&stats[LRU_LOOKUP], "lookup", vol->lookup_cache);
+#else
+	lru_cache_stats(&stats[LRU_LOOKUP], "lookup",
+			(struct CACHE_HEADER*)NULL);
+#endif
+	lru_cache_stats(&stats[LRU_SECURID], "securid", vol->securid_cache);
+#if CACHE_LEGACY_SIZE
+	lru_cache_stats(&stats[LRU_LEGACY], "legacy", vol->legacy_cache);
+#else
+	lru_cache_stats(&stats[LRU_LEGACY], "legacy",
+			(struct CACHE_HEADER*)NULL);
+#endif
+#if CACHE_MFT_SIZE
+	lru_cache_stats(&stats[LRU_MFT], "mft", vol->mft_cache);
+#else
+	lru_cache_stats(&stats[LRU_MFT], "mft",
+			(struct CACHE_HEADER*)NULL);
+#endif
+	return (LRU_COUNT);
 }
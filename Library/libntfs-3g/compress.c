@@ -41,6 +41,7 @@
 #include <errno.h>
 #endif
 
+#include "param.h"
 #include "attrib.h"
 #include "debug.h"
 #include "volume.h"
@@ -553,6 +554,7 @@ do_next_tag:
 		u16 lg, pt, length, max_non_overlap;
 		register u16 i;
 		u8 *dest_back_addr;
+		int run;
 
 		/* Check if we are done / still in range. */
 		if (cb >= cb_sb_end || dest > dest_sb_end)
@@ -560,11 +562,25 @@ do_next_tag:
 		/* Determine token type and parse appropriately.*/
 		if ((tag & NTFS_TOKEN_MASK) == NTFS_SYMBOL_TOKEN) {
 			/*
-			 * We have a symbol token, copy the symbol across, and
-			 * advance the source and destination positions.
+			 * We have a symbol token. The following tokens of the
+			 * tag are often symbols too, copy the whole run of
+			 * symbols across at once, within the limits checked
+			 * above for each token, and advance the source and
+			 * destination positions.
 			 */
-			*dest++ = *cb++;
-			/* Continue with the next token. */
+			for (run = 1; run < 8 - token; run++)
+				if ((tag >> run) & NTFS_TOKEN_MASK)
+					break;
+			if (run > cb_sb_end - cb)
+				run = cb_sb_end - cb;
+			if (run > dest_sb_end - dest + 1)
+				run = dest_sb_end - dest + 1;
+			memcpy(dest, cb, run);
+			dest += run;
+			cb += run;
+			/* Continue with the token after the run. */
+			token += run - 1;
+			tag >>= run - 1;
 			continue;
 		}
 		/*
@@ -598,27 +614,21 @@ do_next_tag:
 		/* Verify destination is in range. */
 		if (dest + length > dest_sb_end)
 			goto return_overflow;
-		/* The number of non-overlapping bytes. */
-		max_non_overlap = dest - dest_back_addr;
-		if (length <= max_non_overlap) {
-			/* The byte sequence doesn't overlap, just copy it. */
-			memcpy(dest, dest_back_addr, length);
-			/* Advance destination pointer. */
-			dest += length;
-		} else {
-			/*
-			 * The byte sequence does overlap, copy non-overlapping
-			 * part and then do a slow byte by byte copy for the
-			 * overlapping part. Also, advance the destination
-			 * pointer.
-			 */
+		/*
+		 * Copy the byte sequence and advance the destination pointer.
+		 * When it overlaps, the bytes from dest_back_addr to dest hold
+		 * a whole number of periods of the repeated pattern, so copy
+		 * them all at once and double the copied part each time
+		 * instead of doing a slow byte by byte copy.
+		 */
+		do {
+			max_non_overlap = dest - dest_back_addr;
+			if (max_non_overlap > length)
+				max_non_overlap = length;
 			memcpy(dest, dest_back_addr, max_non_overlap);
 			dest += max_non_overlap;
-			dest_back_addr += max_non_overlap;
 			length -= max_non_overlap;
-			while (length--)
-				*dest++ = *dest_back_addr++;
-		}
+		} while (length);
 		/* Advance source position and continue with the next token. */
 		cb += 2;
 	}
@@ -683,6 +693,107 @@ restart:
 	return FALSE;
 }
 
+/*
+ *		Cache of decompressed compression blocks
+ *
+ *	The compression blocks last decompressed for an attribute are kept
+ *	in up to CACHE_CB_BUDGET bytes, so that reading a compressed file by
+ *	chunks smaller than a compression block decompresses each block
+ *	once. The cache belongs to the ntfs_attr, it is dropped when data
+ *	is written or the attribute is resized, and when it is closed.
+ */
+
+struct CACHED_CB {
+	VCN vcn;		/* first vcn of the block, -1 if free */
+	u32 stamp;		/* last use, for LRU */
+	u8 *data;
+} ;
+
+struct COMPRESSED_CACHE {
+	u32 count;
+	u32 stamp;
+	struct CACHED_CB blocks[1];
+} ;
+
+/*
+ *		Find the decompressed block starting at a vcn
+ */
+
+static struct CACHED_CB *ntfs_cb_cache_find(ntfs_attr *na, VCN vcn)
+{
+	struct COMPRESSED_CACHE *cache;
+	u32 i;
+
+	cache = na->cb_cache;
+	if (cache)
+		for (i=0; i<cache->count; i++)
+			if (cache->blocks[i].vcn == vcn) {
+				cache->blocks[i].stamp = ++cache->stamp;
+				return (&cache->blocks[i]);
+			}
+	return ((struct CACHED_CB*)NULL);
+}
+
+/*
+ *		Get the least recently used block, creating the cache if needed
+ *
+ *	The block is free until its vcn is set, once its data is valid.
+ *
+ *	Returns NULL if there is no memory for a cache
+ */
+
+static struct CACHED_CB *ntfs_cb_cache_slot(ntfs_attr *na)
+{
+	struct COMPRESSED_CACHE *cache;
+	struct CACHED_CB *slot;
+	u32 cb_size;
+	u32 count;
+	u8 *data;
+	u32 i;
+
+	cache = na->cb_cache;
+	if (!cache) {
+		cb_size = na->compression_block_size;
+		count = CACHE_CB_BUDGET/cb_size;
+		if (!count)
+			count = 1;
+		cache = (struct COMPRESSED_CACHE*)ntfs_malloc(
+				sizeof(struct COMPRESSED_CACHE)
+				+ (count - 1)*sizeof(struct CACHED_CB)
+				+ (size_t)count*cb_size);
+		if (!cache)
+			return ((struct CACHED_CB*)NULL);
+		cache->count = count;
+		cache->stamp = 0;
+		data = (u8*)&cache->blocks[count];
+		for (i=0; i<count; i++) {
+			cache->blocks[i].vcn = -1;
+			cache->blocks[i].stamp = 0;
+			cache->blocks[i].data = &data[(size_t)i*cb_size];
+		}
+		na->cb_cache = cache;
+	}
+	slot = &cache->blocks[0];
+	for (i=1; i<cache->count; i++)
+		if (cache->blocks[i].stamp < slot->stamp)
+			slot = &cache->blocks[i];
+	slot->vcn = -1;
+	slot->stamp = ++cache->stamp;
+	return (slot);
+}
+
+/*
+ *		Drop the decompressed blocks of an attribute
+ */
+
+void ntfs_compressed_cache_free(ntfs_attr *na)
+{
+	if (na->cb_cache) {
+		free(na->cb_cache);
+		na->cb_cache = (struct COMPRESSED_CACHE*)NULL;
+	}
+}
+
 /**
  * ntfs_compressed_attr_pread - read from a compressed attribute
  * @na:		ntfs attribute to read from
@@ -693,7 +804,9 @@ restart:
  * NOTE:  You probably want to be using attrib.c::ntfs_attr_pread() instead.
  *
  * This function will read @count bytes starting at offset @pos from the
- * compressed ntfs attribute @na into the data buffer @b.
+ * compressed ntfs attribute @na into the data buffer @b. Compressed blocks
+ * are decompressed whole into the cache of the attribute, and copied from
+ * it by later reads.
  *
  * On success, return the number of successfully read bytes.  If this number
  * is lower than @count this means that the read reached end of file or that
@@ -712,6 +825,7 @@ s64 ntfs_compressed_attr_pread(ntfs_attr *na, s64 pos, s64 count, void *b)
 	ntfs_volume *vol;
 	runlist_element *rl;
 	u8 *dest, *cb, *cb_pos, *cb_end;
+	struct CACHED_CB *cached;
 	u32 cb_size;
 	int err;
 	ATTR_FLAGS data_flags;
@@ -876,9 +990,18 @@ do_next_cb:
 		na->ni->flags |= compression;
 		na->data_flags = data_flags;
 		ofs = 0;
+	} else if ((cached = ntfs_cb_cache_find(na, vcn))) {
+		/* Compressed cb decompressed by a previous read. */
+		to_read = min(count, cb_size - ofs);
+		memcpy(b, cached->data + ofs, to_read);
+		total += to_read;
+		count -= to_read;
+		b = (u8*)b + to_read;
+		ofs = 0;
 	} else {
 		s64 tdata_size, tinitialized_size;
 		u32 decompsz;
+		u8 *decomp;
 
 		/*
 		 * Compressed cb, decompress it into the temporary buffer, then
@@ -936,10 +1059,23 @@ do_next_cb:
 		if (cb_pos + 2 <= cb_end)
 			*(u16*)cb_pos = 0;
 		ntfs_log_debug("Successfully read the compression block.\n");
-		/* Do not decompress beyond the requested block */
 		to_read = min(count, cb_size - ofs);
-		decompsz = ((ofs + to_read - 1) | (NTFS_SB_SIZE - 1)) + 1;
-		if (ntfs_decompress(dest, decompsz, cb, cb_size) < 0) {
+		cached = ntfs_cb_cache_slot(na);
+		if (cached) {
+			/*
+			 * Decompress the whole block for the next reads,
+			 * the sub-blocks missing at the end are zeroes.
+			 */
+			decomp = cached->data;
+			decompsz = cb_size;
+			memset(decomp, 0, cb_size);
+		} else {
+			/* Do not decompress beyond the requested block */
+			decomp = dest;
+			decompsz = ((ofs + to_read - 1)
+					| (NTFS_SB_SIZE - 1)) + 1;
+		}
+		if (ntfs_decompress(decomp, decompsz, cb, cb_size) < 0) {
 			err = errno;
 			free(cb);
 			free(dest);
@@ -948,7 +1084,9 @@ do_next_cb:
 			errno = err;
 			return -1;
 		}
-		memcpy(b, dest + ofs, to_read);
+		if (cached)
+			cached->vcn = vcn;
+		memcpy(b, decomp + ofs, to_read);
 		total += to_read;
 		count -= to_read;
 		b = (u8*)b + to_read;
@@ -1237,6 +1375,8 @@ static int ntfs_compress_overwr_free(ntfs_attr *na, runlist_element *rl,
 
 	vol = na->ni->vol;
 	res = 0;
+		/* runs are merged or moved below */
+	ntfs_attr_rl_changed(na);
 	freelcn = rl->lcn + usedcnt;
 	freevcn = rl->vcn + usedcnt;
 	freelength = rl->length - usedcnt;
@@ -1450,6 +1590,8 @@ static int ntfs_compress_free(ntfs_attr *na, runlist_element *rl,
 
 	res = -1; /* default return */
 	vol = na->ni->vol;
+		/* runs are merged or moved below */
+	ntfs_attr_rl_changed(na);
 	freecnt = (reserved - used) >> vol->cluster_size_bits;
 	usedcnt = (reserved >> vol->cluster_size_bits) - freecnt;
 	if (rl->vcn < *update_from)
@@ -1869,6 +2011,7 @@ int ntfs_compressed_close(ntfs_attr *na, runlist_element *wrl, s64 offs,
 	BOOL fail;
 	BOOL done;
 
+	ntfs_compressed_cache_free(na);
 	if (na->unused_runs < 2) {
 		ntfs_log_error("No unused runs for compressed close\n");
 		errno = EIO;
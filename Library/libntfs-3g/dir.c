@@ -94,13 +94,15 @@ ntfschar NTFS_INDEX_R[3] = { const_cpu_to_le16('$'), const_cpu_to_le16('R'),
 /*
  *		Pathname hashing
  *
- *	Based on first char and second char (which may be '\0')
+ *	Based on all the chars of the last component, the cache
+ *	reduces the value to the size of its hash table
  */
 
 int ntfs_dir_inode_hash(const struct CACHED_GENERIC *cached)
 {
 	const char *path;
 	const unsigned char *name;
+	unsigned int val;
 
 	path = (const char*)cached->variable;
 	if (!path) {
@@ -110,8 +112,10 @@ int ntfs_dir_inode_hash(const struct CACHED_GENERIC *cached)
 	name = (const unsigned char*)strrchr(path,'/');
 	if (!name)
 		name = (const unsigned char*)path;
-	return (((name[0] << 1) + name[1] + strlen((const char*)name))
-				% (2*CACHE_INODE_SIZE));
+	val = 0;
+	while (*name)
+		val = val*31 + *name++;
+	return (val >> 1);
 }
 
 /*
@@ -196,10 +200,30 @@ static int lookup_cache_inv_compare(const struct CACHED_GENERIC *cached,
 		    || (MREF(c->inum) != MREF(w->inum)));
 }
 
+/*
+ *		Missing name comparing for invalidating lookup cache
+ *
+ *	All entries recording a name as missing from the designated
+ *	directory are invalidated
+ *
+ *	Only use associated with a CACHE_NOHASH flag
+ */
+
+static int lookup_cache_neg_inv_compare(const struct CACHED_GENERIC *cached,
+			const struct CACHED_GENERIC *wanted)
+{
+	const struct CACHED_LOOKUP *c = (const struct CACHED_LOOKUP*) cached;
+	const struct CACHED_LOOKUP *w = (const struct CACHED_LOOKUP*) wanted;
+	return (!c->name
+		    || (c->parent != w->parent)
+		    || (c->inum != (u64)-1));
+}
+
 /*
  *		Lookup hashing
  *
- *	Based on first, second and and last char
+ *	Based on all the chars of the name, the cache reduces the
+ *	value to the size of its hash table
  */
 
 int ntfs_dir_lookup_hash(const struct CACHED_GENERIC *cached)
@@ -214,12 +238,34 @@ int ntfs_dir_lookup_hash(const struct CACHED_GENERIC *cached)
 		ntfs_log_error("Bad lookup cache entry\n");
 		return (-1);
 	}
-	val = (name[0] << 2) + (name[1] << 1) + name[count - 1] + count;
-	return (val % (2*CACHE_LOOKUP_SIZE));
+	val = 0;
+	while (count--)
+		val = val*31 + *name++;
+	return (val >> 1);
 }
 
 #endif
 
+/*
+ *		Collate the name looked for against the name of an index entry
+ *
+ *	When the case is ignored, the key has been upcased for the lookup
+ */
+
+static int ntfs_lookup_collate(ntfs_volume *vol, const ntfschar *key,
+			int key_len, BOOL upcased, INDEX_ENTRY *ie)
+{
+	if (upcased)
+		return (ntfs_names_upcased_collate(key, key_len,
+				(ntfschar*)&ie->key.file_name.file_name,
+				ie->key.file_name.file_name_length,
+				vol->upcase, vol->upcase_len));
+	return (ntfs_names_full_collate(key, key_len,
+				(ntfschar*)&ie->key.file_name.file_name,
+				ie->key.file_name.file_name_length,
+				CASE_SENSITIVE, vol->upcase, vol->upcase_len));
+}
+
 /**
  * ntfs_inode_lookup_by_name - find an inode in a directory given its name
  * @dir_ni:	ntfs inode of the directory in which to search for the name
@@ -243,7 +289,8 @@ int ntfs_dir_lookup_hash(const struct CACHED_GENERIC *cached)
  * the mft reference of the case insensitive match.
  *
  * If the volume is mounted with the case sensitive flag set, then we only
- * allow exact matches.
+ * allow exact matches. Otherwise the name is upcased once and compared
+ * to the index entries through ntfs_names_upcased_collate().
  */
 u64 ntfs_inode_lookup_by_name(ntfs_inode *dir_ni,
 		const ntfschar *uname, const int uname_len)
@@ -256,7 +303,9 @@ u64 ntfs_inode_lookup_by_name(ntfs_inode *dir_ni,
 	INDEX_ROOT *ir;
 	INDEX_ENTRY *ie;
 	INDEX_ALLOCATION *ia;
-	IGNORE_CASE_BOOL case_sensitivity;
+	ntfschar upkey[NTFS_MAX_NAME_LEN];
+	const ntfschar *key;
+	BOOL upcased;
 	u8 *index_end;
 	ntfs_attr *ia_na;
 	int eo, rc;
@@ -281,7 +330,19 @@ u64 ntfs_inode_lookup_by_name(ntfs_inode *dir_ni,
 				"%lld", (unsigned long long)dir_ni->mft_no);
 		goto put_err_out;
 	}
-	case_sensitivity = (NVolCaseSensitive(vol) ? CASE_SENSITIVE : IGNORE_CASE);
+	key = uname;
+	upcased = !NVolCaseSensitive(vol) && (uname_len <= NTFS_MAX_NAME_LEN);
+	if (upcased) {
+		memcpy(upkey, uname, uname_len*sizeof(ntfschar));
+		ntfs_name_upcase(upkey, uname_len,
+				vol->upcase, vol->upcase_len);
+		key = upkey;
+	} else if (!NVolCaseSensitive(vol)) {
+		/* no such long name in a directory */
+		ntfs_attr_put_search_ctx(ctx);
+		errno = ENOENT;
+		return -1;
+	}
 	/* Get to the index root value. */
 	ir = (INDEX_ROOT*)((u8*)ctx->attr +
 			le16_to_cpu(ctx->attr->value_offset));
@@ -326,10 +387,7 @@ u64 ntfs_inode_lookup_by_name(ntfs_inode *dir_ni,
 		 * Not a perfect match, need to do full blown collation so we
 		 * know which way in the B+tree we have to go.
 		 */
-		rc = ntfs_names_full_collate(uname, uname_len,
-				(ntfschar*)&ie->key.file_name.file_name,
-				ie->key.file_name.file_name_length,
-				case_sensitivity, vol->upcase, vol->upcase_len);
+		rc = ntfs_lookup_collate(vol, key, uname_len, upcased, ie);
 		/*
 		 * If uname collates before the name of the current entry, there
 		 * is definitely no such name in this index but we might need to
@@ -394,6 +452,7 @@ descend_into_child_node:
 	/* Read the index block starting at vcn. */
 	br = ntfs_attr_mst_pread(ia_na, vcn << index_vcn_size_bits, 1,
 			index_block_size, ia);
+	vol->index_block_reads++;
 	if (br != 1) {
 		if (br != -1)
 			errno = EIO;
@@ -466,10 +525,7 @@ descend_into_child_node:
 		 * Not a perfect match, need to do full blown collation so we
 		 * know which way in the B+tree we have to go.
 		 */
-		rc = ntfs_names_full_collate(uname, uname_len,
-				(ntfschar*)&ie->key.file_name.file_name,
-				ie->key.file_name.file_name_length,
-				case_sensitivity, vol->upcase, vol->upcase_len);
+		rc = ntfs_lookup_collate(vol, key, uname_len, upcased, ie);
 		/*
 		 * If uname collates before the name of the current entry, there
 		 * is definitely no such name in this index but we might need to
@@ -651,6 +707,88 @@ void ntfs_inode_update_mbsname(ntfs_inode *dir_ni, const char *name, u64 inum)
 #endif
 }
 
+/*
+ *		Lookup a file in a directory from its Unicode name
+ *
+ *	The name is first fetched from cache if one is defined. Names
+ *	found missing are cached too, so that probing again for a missing
+ *	name does not search the directory. The cached key is the (upcased
+ *	if the volume is not case sensitive) name with a terminating null
+ *	character, so it cannot match the key of a multibyte name.
+ *
+ *	Returns the inode number
+ *		or -1 if not possible (errno tells why)
+ */
+
+u64 ntfs_inode_lookup_by_ucsname(ntfs_inode *dir_ni, const ntfschar *uname,
+		int uname_len)
+{
+#if CACHE_LOOKUP_SIZE
+	struct CACHED_LOOKUP item;
+	struct CACHED_LOOKUP *cached;
+	ntfschar key[NTFS_MAX_NAME_LEN + 1];
+	ntfs_volume *vol;
+	u64 inum;
+	int err;
+
+	vol = dir_ni->vol;
+	if (vol->lookup_cache
+	    && (uname_len > 0) && (uname_len <= NTFS_MAX_NAME_LEN)) {
+		memcpy(key, uname, uname_len*sizeof(ntfschar));
+		if (!NVolCaseSensitive(vol))
+			ntfs_name_upcase(key, uname_len,
+					vol->upcase, vol->upcase_len);
+		key[uname_len] = const_cpu_to_le16(0);
+		item.name = (const char*)key;
+		item.namesize = (uname_len + 1)*sizeof(ntfschar);
+		item.parent = dir_ni->mft_no;
+		cached = (struct CACHED_LOOKUP*)ntfs_fetch_cache(
+				vol->lookup_cache, GENERIC(&item),
+				lookup_cache_compare);
+		if (cached) {
+			inum = cached->inum;
+			if (inum == (u64)-1)
+				errno = ENOENT;
+			return (inum);
+		}
+		inum = ntfs_inode_lookup_by_name(dir_ni, uname, uname_len);
+		err = errno;
+			/* enter into cache if found or missing, not on errors */
+		if ((inum != (u64)-1) || (err == ENOENT)) {
+			item.inum = inum;
+			ntfs_enter_cache(vol->lookup_cache, GENERIC(&item),
+					lookup_cache_compare);
+		}
+		errno = err;
+		return (inum);
+	}
+#endif
+	return (ntfs_inode_lookup_by_name(dir_ni, uname, uname_len));
+}
+
+/*
+ *		Forget the names cached as missing from a directory
+ *
+ *	To be called when a name is added to the directory
+ */
+
+static void ntfs_dir_forget_missing(ntfs_inode *dir_ni)
+{
+#if CACHE_LOOKUP_SIZE
+	struct CACHED_LOOKUP item;
+
+	if (dir_ni->vol->lookup_cache) {
+		item.name = (const char*)NULL;
+		item.namesize = 0;
+		item.parent = dir_ni->mft_no;
+		item.inum = (u64)-1;
+		ntfs_invalidate_cache(dir_ni->vol->lookup_cache,
+				GENERIC(&item), lookup_cache_neg_inv_compare,
+				CACHE_NOHASH);
+	}
+#endif
+}
+
 /**
  * ntfs_pathname_to_inode - Find the inode which represents the given pathname
  * @vol:       An ntfs volume obtained from ntfs_mount
@@ -845,6 +983,104 @@ out:
 	return result;
 }
 
+/**
+ * ntfs_ucs_pathname_to_inode - Find the inode of a Unicode pathname
+ * @vol:       An ntfs volume obtained from ntfs_mount
+ * @parent:    A directory inode to begin the search (may be NULL)
+ * @path:      Little endian Unicode pathname, not necessarily terminated
+ * @len:       Length of @path in Unicode characters
+ *
+ * Same as ntfs_pathname_to_inode() for a pathname which is already in
+ * Unicode. The components are looked up in place, no copy or conversion of
+ * the pathname is made. Empty and "." components are skipped, ".." goes to
+ * the parent directory, the root being its own parent. If @parent is NULL,
+ * then the root directory is used as the base for the search.
+ *
+ * @parent is never closed, it is returned when @path designates it.
+ *
+ * Return:  inode  Success, the pathname was valid
+ *	    NULL   Error, the pathname was invalid, or some other error occurred
+ */
+ntfs_inode *ntfs_ucs_pathname_to_inode(ntfs_volume *vol, ntfs_inode *parent,
+		const ntfschar *path, int len)
+{
+	ntfs_inode *ni;
+	ntfs_inode *next;
+	u64 inum;
+	int start, end;
+	int err = 0;
+
+	if (!vol || (!path && len)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	ni = parent;
+	if (!ni) {
+		ni = ntfs_inode_open(vol, FILE_root);
+		if (!ni) {
+			ntfs_log_debug("Couldn't open the inode of the root "
+					"directory.\n");
+			errno = EIO;
+			return NULL;
+		}
+	}
+
+	for (start=0; start<len; start=end+1) {
+		/* Find the end of the token. */
+		for (end=start; (end<len)
+		    && (path[end] != const_cpu_to_le16(PATH_SEP)); end++) { }
+		if ((end == start)
+		    || ((end - start == 1)
+			&& (path[start] == const_cpu_to_le16('.'))))
+			continue;
+		if ((end - start == 2)
+		    && (path[start] == const_cpu_to_le16('.'))
+		    && (path[start + 1] == const_cpu_to_le16('.'))) {
+			if (ni->mft_no == FILE_root)
+				continue;
+			next = ntfs_dir_parent_inode(ni);
+			if (!next) {
+				err = EIO;
+				break;
+			}
+		} else {
+			if (end - start > NTFS_MAX_NAME_LEN) {
+				err = ENAMETOOLONG;
+				break;
+			}
+			inum = ntfs_inode_lookup_by_ucsname(ni, &path[start],
+					end - start);
+			if (inum == (u64)-1) {
+				err = ENOENT;
+				break;
+			}
+			next = ntfs_inode_open(vol, MREF(inum));
+			if (!next) {
+				ntfs_log_debug("Cannot open inode %llu.\n",
+					(unsigned long long)MREF(inum));
+				err = EIO;
+				break;
+			}
+		}
+		if ((ni != parent) && ntfs_inode_close(ni)) {
+			err = errno;
+			ntfs_inode_close(next);
+			ni = parent;
+			break;
+		}
+		ni = next;
+	}
+
+	if (err) {
+		if (ni != parent)
+			ntfs_inode_close(ni);
+		errno = err;
+		return NULL;
+	}
+	return ni;
+}
+
 /*
  * The little endian Unicode string ".." for ntfs_readdir().
  */
@@ -967,13 +1203,17 @@ static u32 ntfs_dir_entry_type(ntfs_inode *dir_ni, MFT_REF mref,
  * @ie:		current index entry
  * @dirent:	context for filldir callback supplied by the caller
  * @filldir:	filldir callback supplied by the caller
+ * @fnfilldir:	index key callback, used instead of @filldir when not NULL
  *
  * Pass information specifying the current directory entry @ie to the @filldir
- * callback.
+ * callback, or hand its FILE_NAME_ATTR key to the @fnfilldir callback.
+ * In the latter case the entry type is taken from the key only, so that
+ * no mft record is read for the entry.
  */
 static int ntfs_filldir(ntfs_inode *dir_ni, s64 *pos, u8 ivcn_bits,
 		const INDEX_TYPE index_type, index_union iu, INDEX_ENTRY *ie,
-		void *dirent, ntfs_filldir_t filldir)
+		void *dirent, ntfs_filldir_t filldir,
+		ntfs_fnfilldir_t fnfilldir)
 {
 	FILE_NAME_ATTR *fn = &ie->key.file_name;
 	unsigned dt_type;
@@ -996,7 +1236,8 @@ static int ntfs_filldir(ntfs_inode *dir_ni, s64 *pos, u8 ivcn_bits,
 	/* Skip root directory self reference entry. */
 	if (MREF_LE(ie->indexed_file) == FILE_root)
 		return 0;
-	if ((ie->key.file_name.file_attributes
+	if (!fnfilldir
+	    && (ie->key.file_name.file_attributes
 		     & (FILE_ATTR_REPARSE_POINT | FILE_ATTR_SYSTEM))
 	    && !metadata)
 		dt_type = ntfs_dir_entry_type(dir_ni, mref,
@@ -1012,7 +1253,9 @@ static int ntfs_filldir(ntfs_inode *dir_ni, s64 *pos, u8 ivcn_bits,
 				|| !(fn->file_attributes & FILE_ATTR_HIDDEN)))
             || (NVolShowSysFiles(dir_ni->vol) && (NVolShowHidFiles(dir_ni->vol)
 				|| metadata))) {
-		if (NVolCaseSensitive(dir_ni->vol)) {
+		if (fnfilldir) {
+			res = fnfilldir(dirent, fn, *pos, mref, dt_type);
+		} else if (NVolCaseSensitive(dir_ni->vol)) {
 			res = filldir(dirent, fn->file_name,
 					fn->file_name_length,
 					fn->file_name_type, *pos,
@@ -1103,24 +1346,15 @@ err_out:
 	return ERR_MREF(-1);
 }
 
-/**
- * ntfs_readdir - read the contents of an ntfs directory
- * @dir_ni:	ntfs inode of current directory
- * @pos:	current position in directory
- * @dirent:	context for filldir callback supplied by the caller
- * @filldir:	filldir callback supplied by the caller
- *
- * Parse the index root and the index blocks that are marked in use in the
- * index bitmap and hand each found directory entry to the @filldir callback
- * supplied by the caller.
- *
- * Return 0 on success or -1 on error with errno set to the error code.
+/*
+ *		Common body of ntfs_readdir() and ntfs_readdir_fn()
  *
- * Note: Index blocks are parsed in ascending vcn order, from which follows
- * that the directory entries are not returned sorted.
+ * Exactly one of @filldir and @fnfilldir is defined. The emulated
+ * "." and ".." entries have no index key, they are only passed
+ * to @filldir.
  */
-int ntfs_readdir(ntfs_inode *dir_ni, s64 *pos,
-		void *dirent, ntfs_filldir_t filldir)
+static int ntfs_readdir_i(ntfs_inode *dir_ni, s64 *pos, void *dirent,
+		ntfs_filldir_t filldir, ntfs_fnfilldir_t fnfilldir)
 {
 	s64 i_size, br, ia_pos, bmp_pos, ia_start;
 	ntfs_volume *vol;
@@ -1136,7 +1370,7 @@ int ntfs_readdir(ntfs_inode *dir_ni, s64 *pos,
 
 	ntfs_log_trace("Entering.\n");
 	
-	if (!dir_ni || !pos || !filldir) {
+	if (!dir_ni || !pos || (!filldir && !fnfilldir)) {
 		errno = EINVAL;
 		return -1;
 	}
@@ -1171,6 +1405,8 @@ int ntfs_readdir(ntfs_inode *dir_ni, s64 *pos,
 		goto done;
 
 	/* Emulate . and .. for all directories. */
+	if (!*pos && fnfilldir)
+		*pos = 2;
 	if (!*pos) {
 		rc = filldir(dirent, dotdot, 1, FILE_NAME_POSIX, *pos,
 				MK_MREF(dir_ni->mft_no,
@@ -1267,7 +1503,8 @@ int ntfs_readdir(ntfs_inode *dir_ni, s64 *pos,
 		 * invoke the filldir() callback as appropriate.
 		 */
 		rc = ntfs_filldir(dir_ni, pos, index_vcn_size_bits,
-				INDEX_TYPE_ROOT, ir, ie, dirent, filldir);
+				INDEX_TYPE_ROOT, ir, ie, dirent, filldir,
+				fnfilldir);
 		if (rc) {
 			ntfs_attr_put_search_ctx(ctx);
 			ctx = NULL;
@@ -1323,7 +1560,8 @@ skip_index_root:
 		goto err_out;
 	}
 
-	bmp_buf_pos = 0;
+	/* The buffer starts at the byte holding the bit of bmp_pos. */
+	bmp_buf_pos = bmp_pos & 7;
 	/* If the index block is not in use find the next one that is. */
 	while (!(bmp[bmp_buf_pos >> 3] & (1 << (bmp_buf_pos & 7)))) {
 find_next_index_buffer:
@@ -1353,6 +1591,7 @@ find_next_index_buffer:
 	/* Read the index block starting at bmp_pos. */
 	br = ntfs_attr_mst_pread(ia_na, bmp_pos << index_block_size_bits, 1,
 			index_block_size, ia);
+	vol->index_block_reads++;
 	if (br != 1) {
 		if (br != -1)
 			errno = EIO;
@@ -1423,7 +1662,8 @@ find_next_index_buffer:
 		 * invoke the filldir() callback as appropriate.
 		 */
 		rc = ntfs_filldir(dir_ni, pos, index_vcn_size_bits,
-				INDEX_TYPE_ALLOCATION, ia, ie, dirent, filldir);
+				INDEX_TYPE_ALLOCATION, ia, ie, dirent, filldir,
+				fnfilldir);
 		if (rc)
 			goto err_out;
 	}
@@ -1457,6 +1697,52 @@ err_out:
 	return -1;
 }
 
+/**
+ * ntfs_readdir - read the contents of an ntfs directory
+ * @dir_ni:	ntfs inode of current directory
+ * @pos:	current position in directory
+ * @dirent:	context for filldir callback supplied by the caller
+ * @filldir:	filldir callback supplied by the caller
+ *
+ * Parse the index root and the index blocks that are marked in use in the
+ * index bitmap and hand each found directory entry to the @filldir callback
+ * supplied by the caller.
+ *
+ * Return 0 on success or -1 on error with errno set to the error code.
+ *
+ * Note: Index blocks are parsed in ascending vcn order, from which follows
+ * that the directory entries are not returned sorted.
+ */
+int ntfs_readdir(ntfs_inode *dir_ni, s64 *pos,
+		void *dirent, ntfs_filldir_t filldir)
+{
+	return (ntfs_readdir_i(dir_ni, pos, dirent, filldir,
+			(ntfs_fnfilldir_t)NULL));
+}
+
+/**
+ * ntfs_readdir_fn - read the index keys of an ntfs directory
+ * @dir_ni:	ntfs inode of current directory
+ * @pos:	current position in directory
+ * @dirent:	context for fnfilldir callback supplied by the caller
+ * @fnfilldir:	fnfilldir callback supplied by the caller
+ *
+ * Same as ntfs_readdir(), except that the FILE_NAME_ATTR key of each
+ * entry is handed over as found in the index, with the name neither
+ * translated to lower case nor copied. The key holds the times, sizes
+ * and attributes of the entry as of its last inode sync, so a listing
+ * can be built without reading the mft record of each entry.
+ * The emulated "." and ".." entries are not reported.
+ *
+ * Return 0 on success or -1 on error with errno set to the error code.
+ */
+int ntfs_readdir_fn(ntfs_inode *dir_ni, s64 *pos,
+		void *dirent, ntfs_fnfilldir_t fnfilldir)
+{
+	return (ntfs_readdir_i(dir_ni, pos, dirent, (ntfs_filldir_t)NULL,
+			fnfilldir));
+}
+
 
 /**
  * __ntfs_create - create object on ntfs volume
@@ -1728,6 +2014,7 @@ static ntfs_inode *__ntfs_create(ntfs_inode *dir_ni, le32 securid,
 		ntfs_log_perror("Failed to add entry to the index");
 		goto err_out;
 	}
+	ntfs_dir_forget_missing(dir_ni);
 	/* Set hard links count and directory flag. */
 	ni->mrec->link_count = const_cpu_to_le16(1);
 	if (S_ISDIR(type))
@@ -2219,6 +2506,7 @@ static int ntfs_link_i(ntfs_inode *ni, ntfs_inode *dir_ni, const ntfschar *name,
 		ntfs_log_perror("Failed to add filename to the index");
 		goto err_out;
 	}
+	ntfs_dir_forget_missing(dir_ni);
 	/* Add FILE_NAME attribute to inode. */
 	if (ntfs_attr_add(ni, AT_FILE_NAME, AT_UNNAMED, 0, (u8*)fn, fn_len)) {
 		ntfs_log_error("Failed to add FILE_NAME attribute.\n");
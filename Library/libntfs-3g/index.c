@@ -597,6 +597,7 @@ static int ntfs_ib_read(ntfs_index_context *icx, VCN vcn, INDEX_BLOCK *dst)
 	pos = ntfs_ib_vcn_to_pos(icx, vcn);
 
 	ret = ntfs_attr_mst_pread(icx->ia_na, pos, 1, icx->block_size, (u8 *)dst);
+	icx->ni->vol->index_block_reads++;
 	if (ret != 1) {
 		if (ret == -1)
 			ntfs_log_perror("Failed to read index block");
@@ -954,8 +955,7 @@ static int ntfs_ibm_clear(ntfs_index_context *icx, VCN vcn)
 static VCN ntfs_ibm_get_free(ntfs_index_context *icx)
 {
 	u8 *bm;
-	int bit;
-	s64 vcn, byte, size;
+	s64 vcn, bit, size;
 
 	ntfs_log_trace("Entering\n");
 	
@@ -964,21 +964,11 @@ static VCN ntfs_ibm_get_free(ntfs_index_context *icx)
 	if (!bm)
 		return (VCN)-1;
 	
-	for (byte = 0; byte < size; byte++) {
-		
-		if (bm[byte] == 255)
-			continue;
-		
-		for (bit = 0; bit < 8; bit++) {
-			if (!(bm[byte] & (1 << bit))) {
-				vcn = ntfs_ibm_pos_to_vcn(icx, byte * 8 + bit);
-				goto out;
-			}
-		}
-	}
-	
-	vcn = ntfs_ibm_pos_to_vcn(icx, size * 8);
-out:	
+	bit = ntfs_bits_find_zero(bm, 0, size * 8);
+	if (bit < 0)
+		bit = size * 8;
+	vcn = ntfs_ibm_pos_to_vcn(icx, bit);
+
 	ntfs_log_trace("allocated vcn: %lld\n", (long long)vcn);
 
 	if (ntfs_ibm_set(icx, vcn))
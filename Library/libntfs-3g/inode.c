@@ -407,12 +407,13 @@ void ntfs_inode_nidata_free(const struct CACHED_GENERIC *cached)
 
 /*
  *		Compute a hash value for an inode entry
+ *
+ *	The cache reduces the value to the size of its hash table
  */
 
 int ntfs_inode_nidata_hash(const struct CACHED_GENERIC *item)
 {
-	return (((const struct CACHED_NIDATA*)item)->inum
-			% (2*CACHE_NIDATA_SIZE));
+	return (((const struct CACHED_NIDATA*)item)->inum & 0x7fffffff);
 }
 
 /*
@@ -113,61 +113,6 @@ static void update_full_status(ntfs_volume *vol, LCN lcn)
 		}
 }
  
-static s64 max_empty_bit_range(unsigned char *buf, int size)
-{
-	int i, j, run = 0;
-	int max_range = 0;
-	s64 start_pos = -1;
-	
-	ntfs_log_trace("Entering\n");
-	
-	i = 0;
-	while (i < size) {
-		switch (*buf) {
-		case 0 :
-			do {
-				buf++;
-				run += 8;
-				i++;
-			} while ((i < size) && !*buf);
-			break;
-		case 255 :
-			if (run > max_range) {
-				max_range = run;
-				start_pos = (s64)i * 8 - run;
-			}
-			run = 0;
-			do {
-				buf++;
-				i++;
-			} while ((i < size) && (*buf == 255));
-			break;
-		default :
-			for (j = 0; j < 8; j++) {
-			
-				int bit = *buf & (1 << j);
-		
-				if (bit) {
-					if (run > max_range) {
-						max_range = run;
-						start_pos = (s64)i * 8 + (j - run);
-					}
-					run = 0;
-				} else 
-					run++;
-			}
-			i++;
-			buf++;
-		
-		}
-	}
-	
-	if (run > max_range)
-		start_pos = (s64)i * 8 - run;
-	
-	return start_pos;
-}
-
 static int bitmap_writeback(ntfs_volume *vol, s64 pos, s64 size, void *b, 
 			    u8 *writeback)
 {
@@ -239,9 +184,9 @@ runlist *ntfs_cluster_alloc(ntfs_volume *vol, VCN start_vcn, s64 count,
 	LCN last_read_pos, lcn;
 	LCN bmp_pos;		/* current bit position inside the bitmap */
 	LCN prev_lcn = 0, prev_run_len = 0;
-	s64 clusters, br;
+	s64 clusters, br, run;
 	runlist *rl = NULL, *trl;
-	u8 *buf, *byte, bit, writeback;
+	u8 *buf, writeback;
 	u8 pass = 1; 	/* 1: inside zone;  2: start of zone */
 	u8 search_zone; /* 4: data2 (start) 1: mft (middle) 2: data1 (end) */
 	u8 done_zones = 0;
@@ -336,26 +281,33 @@ runlist *ntfs_cluster_alloc(ntfs_volume *vol, VCN start_vcn, s64 count,
 		writeback = 0;
 		
 		while (lcn < buf_size) {
-			byte = buf + (lcn >> 3);
-			bit = 1 << (lcn & 7);
-			if (has_guess) {
-				if (*byte & bit) {
-					has_guess = 0;
-					break;
-				}
-			} else {
-				lcn = max_empty_bit_range(buf, br);
+			if (!has_guess) {
+				lcn = ntfs_bits_longest_zero_run(buf, buf_size,
+						NULL);
 				if (lcn < 0)
 					break;
 				has_guess = 1;
 				continue;
 			}
-
-			/* First free bit is at lcn + bmp_pos. */
+			/* Free bits run from lcn + bmp_pos up to a set bit. */
+			run = ntfs_bits_find_set(buf, lcn, buf_size);
+			if (run == lcn) {
+				has_guess = 0;
+				break;
+			}
+			if (run < 0)
+				run = buf_size;
+			run -= lcn;
+			if (run > clusters)
+				run = clusters;
 			 
 			/* Reallocate memory if necessary. */
 			if ((rlpos + 2) * (int)sizeof(runlist) >= rlsize) {
-				rlsize += 4096;
+				/*
+				 * Double the block, the runlist may later grow
+				 * in place, see ntfs_rl_realloc().
+				 */
+				rlsize = rlsize ? rlsize << 1 : 4096;
 				trl = realloc(rl, rlsize);
 				if (!trl) {
 					err = ENOMEM;
@@ -365,15 +317,18 @@ runlist *ntfs_cluster_alloc(ntfs_volume *vol, VCN start_vcn, s64 count,
 				rl = trl;
 			}
 			
-			/* Allocate the bitmap bit. */
-			*byte |= bit;
+			/* Allocate the bitmap bits. */
+			ntfs_bits_set_range(buf, lcn, run, 1);
 			writeback = 1;
-			if (vol->free_clusters <= 0) 
+			if (vol->free_clusters < run) {
 				ntfs_log_error("Non-positive free clusters "
 					       "(%lld)!\n",
-						(long long)vol->free_clusters);
-			else	
-				vol->free_clusters--; 
+						(long long)vol->free_clusters
+						- run);
+				if (vol->free_clusters > 0)
+					vol->free_clusters = 0;
+			} else
+				vol->free_clusters -= run; 
 			
 			/*
 			 * Coalesce with previous run if adjacent LCNs.
@@ -386,7 +341,8 @@ runlist *ntfs_cluster_alloc(ntfs_volume *vol, VCN start_vcn, s64 count,
 					       (long long)prev_lcn, 
 					       (long long)lcn, (long long)bmp_pos, 
 					       (long long)prev_run_len);
-				rl[rlpos - 1].length = ++prev_run_len;
+				prev_run_len += run;
+				rl[rlpos - 1].length = prev_run_len;
 			} else {
 				if (rlpos)
 					rl[rlpos].vcn = rl[rlpos - 1].vcn +
@@ -398,7 +354,7 @@ runlist *ntfs_cluster_alloc(ntfs_volume *vol, VCN start_vcn, s64 count,
 				}
 				
 				rl[rlpos].lcn = prev_lcn = lcn + bmp_pos;
-				rl[rlpos].length = prev_run_len = 1;
+				rl[rlpos].length = prev_run_len = run;
 				rlpos++;
 			}
 			
@@ -407,15 +363,15 @@ runlist *ntfs_cluster_alloc(ntfs_volume *vol, VCN start_vcn, s64 count,
 				       (long long)rl[rlpos - 1].lcn, 
 				       (long long)rl[rlpos - 1].length);
 			/* Done? */
-			if (!--clusters) {
+			clusters -= run;
+			lcn += run;
+			if (!clusters) {
 				if (used_zone_pos)
 					ntfs_cluster_update_zone_pos(vol, 
-						search_zone, lcn + bmp_pos + 1 +
+						search_zone, lcn + bmp_pos +
 							NTFS_LCNALLOC_SKIP);
 				goto done_ret;
 			}
-			
-			lcn++;
 		}
 		
 		if (bitmap_writeback(vol, last_read_pos, br, buf, &writeback)) {
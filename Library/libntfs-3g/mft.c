@@ -55,8 +55,154 @@
 #include "layout.h"
 #include "lcnalloc.h"
 #include "mft.h"
+#include "mst.h"
 #include "logging.h"
 #include "misc.h"
+#include "cache.h"
+
+#if CACHE_MFT_SIZE
+
+/*
+ *		Mft record cache
+ *
+ *	Records are kept fixed up, as read from or written to disk, never
+ *	as modified in memory by an open inode. Reading a missing record
+ *	reads the aligned window of MFT_READ_AHEAD bytes around it, as
+ *	neighbouring files are usually allocated close to each other.
+ */
+
+int ntfs_mft_cache_hash(const struct CACHED_GENERIC *cached)
+{
+	return (((const struct CACHED_MFT*)cached)->mft_no & 0x7fffffff);
+}
+
+static int ntfs_mft_cache_compare(const struct CACHED_GENERIC *cached,
+			const struct CACHED_GENERIC *wanted)
+{
+	return (((const struct CACHED_MFT*)cached)->mft_no
+			!= ((const struct CACHED_MFT*)wanted)->mft_no);
+}
+
+/*
+ *		Copy a record from the cache
+ *
+ *	Returns TRUE if the record was found
+ */
+
+static BOOL ntfs_mft_cache_get(ntfs_volume *vol, VCN m, MFT_RECORD *b)
+{
+	struct CACHED_MFT item;
+	struct CACHED_MFT *cached;
+
+	item.mft_no = m;
+	item.mrec = (MFT_RECORD*)NULL;
+	item.mrecsize = 0;
+	cached = (struct CACHED_MFT*)ntfs_fetch_cache(vol->mft_cache,
+				GENERIC(&item), ntfs_mft_cache_compare);
+	if (!cached)
+		return (FALSE);
+	memcpy(b, cached->mrec, vol->mft_record_size);
+	return (TRUE);
+}
+
+/*
+ *		Enter a fixed up record into the cache, or update it
+ */
+
+static void ntfs_mft_cache_put(ntfs_volume *vol, VCN m, const MFT_RECORD *b)
+{
+	struct CACHED_MFT item;
+	struct CACHED_MFT *cached;
+
+	item.mft_no = m;
+	item.mrec = (MFT_RECORD*)b;
+	item.mrecsize = vol->mft_record_size;
+	cached = (struct CACHED_MFT*)ntfs_enter_cache(vol->mft_cache,
+				GENERIC(&item), ntfs_mft_cache_compare);
+		/* an entry already present is not updated by the cache */
+	if (cached)
+		memcpy(cached->mrec, b, vol->mft_record_size);
+}
+
+/*
+ *		Forget a record whose state on disk is not known
+ */
+
+static void ntfs_mft_cache_forget(ntfs_volume *vol, VCN m)
+{
+	struct CACHED_MFT item;
+
+	item.mft_no = m;
+	item.mrec = (MFT_RECORD*)NULL;
+	item.mrecsize = 0;
+	ntfs_invalidate_cache(vol->mft_cache, GENERIC(&item),
+				ntfs_mft_cache_compare, 0);
+}
+
+/*
+ *		Read a missing record with its neighbours
+ *
+ *	The window of records around @m is read at once, the ones in use
+ *	according to the mft bitmap are fixed up and entered into the
+ *	cache, and @m is fixed up in any case and copied to @b.
+ *
+ *	Returns 0 if successful, or -1 if the window could not be read,
+ *	the caller should then read @m alone.
+ */
+
+static int ntfs_mft_read_window(ntfs_volume *vol, VCN m, MFT_RECORD *b)
+{
+	u8 bmp[MFT_READ_AHEAD / NTFS_BLOCK_SIZE / 8 + 2];
+	MFT_RECORD *mrec;
+	u8 *buf;
+	VCN first, end, i;
+	s64 window, br, bmpsize;
+	BOOL warn;
+
+	window = MFT_READ_AHEAD >> vol->mft_record_size_bits;
+	if (window < 2 || !vol->mftbmp_na)
+		return (-1);
+	first = m & ~(window - 1);
+	end = vol->mft_na->initialized_size >> vol->mft_record_size_bits;
+	if (end > first + window)
+		end = first + window;
+	buf = (u8*)ntfs_malloc((end - first) << vol->mft_record_size_bits);
+	if (!buf)
+		return (-1);
+	br = ntfs_attr_pread(vol->mft_na, first << vol->mft_record_size_bits,
+			(end - first) << vol->mft_record_size_bits, buf);
+	if (br != ((end - first) << vol->mft_record_size_bits)) {
+		free(buf);
+		return (-1);
+	}
+	vol->mft_record_reads += end - first;
+		/* records beyond the mft bitmap are not in use */
+	bmpsize = ntfs_attr_pread(vol->mftbmp_na, first >> 3,
+			((first & 7) + (end - first) + 7) >> 3, bmp);
+	if (bmpsize < 0)
+		bmpsize = 0;
+	warn = !NVolNoFixupWarn(vol);
+	for (i = first; i < end; i++) {
+		mrec = (MFT_RECORD*)(buf + ((i - first)
+				<< vol->mft_record_size_bits));
+		if (((i >> 3) - (first >> 3)) < bmpsize
+		    && ntfs_bit_get(bmp, (i & 7) + ((i >> 3) - (first >> 3)) * 8)) {
+			if (!ntfs_mst_post_read_fixup_warn((NTFS_RECORD*)mrec,
+					vol->mft_record_size, warn))
+				ntfs_mft_cache_put(vol, i, mrec);
+		} else
+			if (i == m)
+				ntfs_mst_post_read_fixup_warn(
+					(NTFS_RECORD*)mrec,
+					vol->mft_record_size, warn);
+		if (i == m)
+			memcpy(b, mrec, vol->mft_record_size);
+	}
+	free(buf);
+	return (0);
+}
+
+#endif /* CACHE_MFT_SIZE */
 
 /**
  * ntfs_mft_records_read - read records from the mft from disk
@@ -104,6 +250,14 @@ int ntfs_mft_records_read(const ntfs_volume *vol, const MFT_REF mref,
 				vol->mft_record_size_bits);
 		return -1;
 	}
+#if CACHE_MFT_SIZE
+	if ((count == 1) && vol->mft_cache) {
+		/* vol is const here, use it through the $MFT inode */
+		if (ntfs_mft_cache_get(vol->mft_na->ni->vol, m, b)
+		    || !ntfs_mft_read_window(vol->mft_na->ni->vol, m, b))
+			return 0;
+	}
+#endif
 	br = ntfs_attr_mst_pread(vol->mft_na, m << vol->mft_record_size_bits,
 			count, vol->mft_record_size, b);
 	if (br != count) {
@@ -114,6 +268,8 @@ int ntfs_mft_records_read(const ntfs_volume *vol, const MFT_REF mref,
 				(long long)br);
 		return -1;
 	}
+	/* vol is const here, account through the $MFT inode */
+	vol->mft_na->ni->vol->mft_record_reads += count;
 	return 0;
 }
 
@@ -148,6 +304,9 @@ int ntfs_mft_records_write(const ntfs_volume *vol, const MFT_REF mref,
 	VCN m;
 	void *bmirr = NULL;
 	int cnt = 0, res = 0;
+#if CACHE_MFT_SIZE
+	s64 i;
+#endif
 
 	if (!vol || !vol->mft_na || vol->mftmirr_size <= 0 || !b || count < 0) {
 		errno = EINVAL;
@@ -189,6 +348,20 @@ int ntfs_mft_records_write(const ntfs_volume *vol, const MFT_REF mref,
 			ntfs_log_perror("Error writing $Mft record(s)");
 		res = errno;
 	}
+#if CACHE_MFT_SIZE
+	if (vol->mft_cache) {
+		/* the records written are deprotected again in @b */
+		for (i = 0; i < count; i++) {
+			if (i < bw)
+				ntfs_mft_cache_put(vol->mft_na->ni->vol, m + i,
+					(MFT_RECORD*)((char*)b
+					+ (i << vol->mft_record_size_bits)));
+			else
+				ntfs_mft_cache_forget(vol->mft_na->ni->vol,
+					m + i);
+		}
+	}
+#endif
 	if (bmirr && bw > 0) {
 		if (bw < cnt)
 			cnt = bw;
@@ -434,19 +607,6 @@ out:
 
 static const char *es = "  Leaving inconsistent metadata.  Run chkdsk.";
 
-/**
- * ntfs_ffz - Find the first unset (zero) bit in a word
- * @word:
- *
- * Description...
- *
- * Returns:
- */
-static inline unsigned int ntfs_ffz(unsigned int word)
-{
-	return ffs(~word) - 1;
-}
-
 static int ntfs_is_mft(ntfs_inode *ni)
 {
 	if (ni && ni->mft_no == FILE_MFT)
@@ -479,11 +639,11 @@ static int ntfs_is_mft(ntfs_inode *ni)
  */
 static int ntfs_mft_bitmap_find_free_rec(ntfs_volume *vol, ntfs_inode *base_ni)
 {
-	s64 pass_end, ll, data_pos, pass_start, ofs, bit;
+	s64 pass_end, ll, data_pos, pass_start, ofs, bit, end;
 	ntfs_attr *mftbmp_na;
-	u8 *buf, *byte;
+	u8 *buf;
 	unsigned int size;
-	u8 pass, b;
+	u8 pass;
 	int ret = -1;
 
 	ntfs_log_enter("Entering\n");
@@ -527,10 +687,6 @@ static int ntfs_mft_bitmap_find_free_rec(ntfs_volume *vol, ntfs_inode *base_ni)
 			"pass_end 0x%llx, data_pos 0x%llx.\n", pass,
 			(long long)pass_start, (long long)pass_end,
 			(long long)data_pos);
-#ifdef DEBUG
-	byte = NULL;
-	b = 0;
-#endif
 	/* Loop until a free mft record is found. */
 	for (; pass <= 2; size = PAGE_SIZE) {
 		/* Cap size to pass_end. */
@@ -550,38 +706,30 @@ static int ntfs_mft_bitmap_find_free_rec(ntfs_volume *vol, ntfs_inode *base_ni)
 			size = ll << 3;
 			bit = data_pos & 7;
 			data_pos &= ~7ull;
-			ntfs_log_debug("Before inner for loop: size 0x%x, "
-					"data_pos 0x%llx, bit 0x%llx, "
-					"*byte 0x%hhx, b %u.\n", size,
-					(long long)data_pos, (long long)bit,
-					(u8) (byte ? *byte : -1), b);
-			for (; bit < size && data_pos + bit < pass_end;
-					bit &= ~7ull, bit += 8) {
-				/* 
-				 * If we're extending $MFT and running out of the first
-				 * mft record (base record) then give up searching since
-				 * no guarantee that the found record will be accessible.
-				 */
-				if (ntfs_is_mft(base_ni) && bit > 400)
+			/* Search the bytes starting before the end of the pass. */
+			end = (pass_end - data_pos + 7) & ~7ull;
+			if (end > size)
+				end = size;
+			/* 
+			 * If we're extending $MFT and running out of the first
+			 * mft record (base record) then give up searching since
+			 * no guarantee that the found record will be accessible.
+			 */
+			if (ntfs_is_mft(base_ni) && end > 408) {
+				bit = ntfs_bits_find_zero(buf, bit, 408);
+				if (bit < 0)
 					goto out;
-				
-				byte = buf + (bit >> 3);
-				if (*byte == 0xff)
-					continue;
-				
-				/* Note: ffz() result must be zero based. */
-				b = ntfs_ffz((unsigned long)*byte);
-				if (b < 8 && b >= (bit & 7)) {
-					free(buf);
-					ret = data_pos + (bit & ~7ull) + b;
-					goto leave;
-				}
+			} else
+				bit = ntfs_bits_find_zero(buf, bit, end);
+			ntfs_log_debug("Searched size 0x%x, data_pos 0x%llx, "
+					"end 0x%llx, found bit 0x%llx.\n",
+					size, (long long)data_pos,
+					(long long)end, (long long)bit);
+			if (bit >= 0) {
+				free(buf);
+				ret = data_pos + bit;
+				goto leave;
 			}
-			ntfs_log_debug("After inner for loop: size 0x%x, "
-					"data_pos 0x%llx, bit 0x%llx, "
-					"*byte 0x%hhx, b %u.\n", size,
-					(long long)data_pos, (long long)bit,
-					(u8) (byte ? *byte : -1), b);
 			data_pos += size;
 			/*
 			 * If the end of the pass has not been reached yet,
@@ -694,6 +842,7 @@ static int ntfs_mft_bitmap_extend_allocation_i(ntfs_volume *vol)
 		return STATUS_ERROR;
 	}
 	mftbmp_na->rl = rl;
+	ntfs_attr_rl_changed(mftbmp_na);
 	ntfs_log_debug("Adding one run to mft bitmap.\n");
 	/* Find the last run in the new runlist. */
 	for (; rl[1].length; rl++)
@@ -810,6 +959,7 @@ undo_alloc:
 	lcn = rl->lcn;
 	rl->lcn = rl[1].lcn;
 	rl->length = 0;
+	ntfs_attr_rl_changed(mftbmp_na);
 	
 	/* FIXME: use an ntfs_cluster_free_* function */
 	if (ntfs_bitmap_clear_bit(vol->lcnbmp_na, lcn))
@@ -1046,6 +1196,7 @@ static int ntfs_mft_data_extend_allocation(ntfs_volume *vol)
 		goto out;
 	}
 	mft_na->rl = rl;
+	ntfs_attr_rl_changed(mft_na);
 	
 	/* Find the last run in the new runlist. */
 	for (; rl[1].length; rl++)
@@ -1164,6 +1315,7 @@ undo_alloc:
 	if (ntfs_cluster_free(vol, mft_na, old_last_vcn, -1) < 0)
 		ntfs_log_error("Failed to free clusters from mft data "
 				"attribute.%s\n", es);
+	ntfs_attr_rl_changed(mft_na);
 	if (ntfs_rl_truncate(&mft_na->rl, old_last_vcn))
 		ntfs_log_error("Failed to truncate mft data attribute "
 				"runlist.%s\n", es);
@@ -1531,6 +1683,7 @@ found_free_rec:
 	/* Return the opened, allocated inode of the allocated mft record. */
 	ntfs_log_error("allocated %sinode %lld\n",
 			base_ni ? "extent " : "", (long long)bit);
+	vol->free_mft_records--;
 out:
 	ntfs_log_leave("\n");	
 	return ni;
@@ -85,18 +85,39 @@ static void ntfs_rl_mc(runlist_element *dstbase, int dst,
 		memcpy(dstbase + dst, srcbase + src, size * sizeof(*dstbase));
 }
 
+/**
+ * ntfs_rl_block_size - size of the memory block of a runlist
+ * @count:	number of runlist elements
+ *
+ * Return the size of the block holding @count runlist elements, which is
+ * the smallest power of two of at least 4kiB they fit in, or 0 if @count
+ * is 0. Every runlist which may be passed to ntfs_rl_realloc() must have
+ * been allocated with at least this size.
+ */
+static size_t ntfs_rl_block_size(int count)
+{
+	size_t size;
+
+	if (count <= 0)
+		return 0;
+	for (size = 0x1000; size < count * sizeof(runlist_element); size <<= 1)
+		;
+	return size;
+}
+
 /**
  * ntfs_rl_realloc - Reallocate memory for runlists
  * @rl:		original runlist
  * @old_size:	number of runlist elements in the original runlist @rl
  * @new_size:	number of runlist elements we need space for
  *
- * As the runlists grow, more memory will be required. To prevent large
- * numbers of small reallocations of memory, this function returns a 4kiB block
- * of memory.
+ * As the runlists grow, more memory will be required. A reallocation copies
+ * the whole runlist, so to keep growing a long runlist linear, runlists are
+ * kept in blocks of memory of a power of two size, starting at 4kiB (see
+ * ntfs_rl_block_size()), and a block is only replaced by a twice larger one.
  *
- * N.B.	If the new allocation doesn't require a different number of 4kiB
- *	blocks in memory, the function will return the original pointer.
+ * N.B.	If the new allocation fits in the block of the original one, the
+ *	function will return the original pointer. Blocks are never shrunk.
  *
  * On success, return a pointer to the newly allocated, or recycled, memory.
  * On error, return NULL with errno set to the error code.
@@ -104,11 +125,13 @@ static void ntfs_rl_mc(runlist_element *dstbase, int dst,
 static runlist_element *ntfs_rl_realloc(runlist_element *rl, int old_size, 
 					int new_size)
 {
-	old_size = (old_size * sizeof(runlist_element) + 0xfff) & ~0xfff;
-	new_size = (new_size * sizeof(runlist_element) + 0xfff) & ~0xfff;
-	if (old_size == new_size)
+	size_t old_block, new_block;
+
+	old_block = ntfs_rl_block_size(old_size);
+	new_block = ntfs_rl_block_size(new_size);
+	if (new_block <= old_block)
 		return rl;
-	return realloc(rl, new_size);
+	return realloc(rl, new_block);
 }
 
 /*
@@ -130,6 +153,9 @@ runlist_element *ntfs_rl_extend(ntfs_attr *na, runlist_element *rl,
 	if (na->rl && rl) {
 		irl = (int)(rl - na->rl);
 		last = irl;
+			/* the counted elements are not beyond the end */
+		if (na->rl_count > last)
+			last = na->rl_count;
 		while (na->rl[last].length)
 			last++;
 		newrl = ntfs_rl_realloc(na->rl,last+1,last+more_entries+1);
@@ -138,6 +164,8 @@ runlist_element *ntfs_rl_extend(ntfs_attr *na, runlist_element *rl,
 			rl = (runlist_element*)NULL;
 		} else {
 			na->rl = newrl;
+				/* the elements are kept, only count the new ones */
+			na->rl_count = last;
 			rl = &newrl[irl];
 		}
 	} else {
@@ -815,7 +843,10 @@ static runlist_element *ntfs_mapping_pairs_decompress_i(const ntfs_volume *vol,
 	}
 	/* Current position in runlist array. */
 	rlpos = 0;
-	/* Allocate first 4kiB block and set current runlist size to 4kiB. */
+	/*
+	 * Allocate first 4kiB block and set current runlist size to 4kiB,
+	 * it is doubled as needed so ntfs_rl_realloc() can grow the runlist.
+	 */
 	rlsize = 0x1000;
 	rl = ntfs_malloc(rlsize);
 	if (!rl)
@@ -835,7 +866,8 @@ static runlist_element *ntfs_mapping_pairs_decompress_i(const ntfs_volume *vol,
 		if ((int)((rlpos + 3) * sizeof(*old_rl)) > rlsize) {
 			runlist_element *rl2;
 
-			rlsize += 0x1000;
+			/* Double the block, see ntfs_rl_block_size(). */
+			rlsize <<= 1;
 			rl2 = realloc(rl, rlsize);
 			if (!rl2) {
 				int eo = errno;
@@ -28,6 +28,527 @@
 
 #include "Ntfs.h"
 #include "device.h"
+#include "misc.h"
+
+/*
+ *		Volume block cache
+ *
+ * Blocks of the device are cached in a fixed memory budget, organized as
+ * a set-associative cache with UEFI_CACHE_WAYS blocks per set and an LRU
+ * replacement within the set. The block size is the cluster size once the
+ * volume is mounted.
+ *
+ * Writes are kept in the cache until the device is synced, the dirty
+ * block is evicted or the device is closed. On sync and close the dirty
+ * blocks are written in device order, runs of adjacent blocks being
+ * gathered into single requests, then the device is asked to flush its
+ * own write cache. Requests of at least
+ * UEFI_CACHE_BYPASS bytes go straight to the disk, keeping the cached
+ * copies of the blocks they overlap coherent.
+ *
+ * The cache is dropped when the media id of the device changes.
+ */
+
+#define UEFI_CACHE_BUDGET	(4*1024*1024)	/* bytes of cached data */
+#define UEFI_CACHE_WAYS		8
+#define UEFI_CACHE_BLOCK	4096		/* block size before mount */
+#define UEFI_CACHE_BYPASS	(64*1024)
+
+struct UEFI_CACHED_BLOCK {
+	s64 offset;		/* device offset of the block, -1 if free */
+	u64 stamp;		/* last use, for LRU within the set */
+	BOOL dirty;
+	u8 *data;
+} ;
+
+struct _NTFS_BLOCK_CACHE {
+	u32 block_size;
+	u32 block_bits;
+	u32 set_mask;
+	u32 media_id;
+	s64 dev_size;
+	u64 stamp;
+	struct UEFI_CACHED_BLOCK *blocks;
+	struct UEFI_CACHED_BLOCK **dirty;	/* room for sorting at flush */
+	u8 *data;
+} ;
+
+/*
+ *		Raw disk accesses, bypassing the cache
+ *
+ * Transfers which are aligned to the device blocks in offset and length
+ * are sent to BlockIo directly, saving the DiskIo layer. When the buffer
+ * does not meet Media->IoAlign, the data goes through a staging buffer
+ * of UEFI_STAGING_SIZE bytes kept by the volume. Other transfers, and
+ * misaligned buffers when no staging buffer could be allocated, go to
+ * DiskIo, which splits and bounces them.
+ */
+
+#define UEFI_STAGING_SIZE	(256*1024)
+
+static BOOL uefi_blocks_aligned(NTFS_VOLUME *Volume, s64 offset, s64 count)
+{
+	u32 bsize;
+
+	bsize = Volume->BlockIo->Media->BlockSize;
+	return (bsize
+		&& !(offset % bsize)
+		&& !(count % bsize)
+		&& !(UEFI_STAGING_SIZE % bsize));
+}
+
+static BOOL uefi_buffer_aligned(NTFS_VOLUME *Volume, const void *b)
+{
+	u32 align;
+
+	align = Volume->BlockIo->Media->IoAlign;
+	return ((align <= 1) || !((UINTN)b & (align - 1)));
+}
+
+static u8 *uefi_staging_buffer(NTFS_VOLUME *Volume)
+{
+	u32 align;
+
+	if (!Volume->StagingBuffer) {
+		align = Volume->BlockIo->Media->IoAlign;
+		Volume->StagingBuffer = (u8*)AllocateAlignedPages(
+				EFI_SIZE_TO_PAGES(UEFI_STAGING_SIZE),
+				(align > EFI_PAGE_SIZE ? align : 0));
+	}
+	return (Volume->StagingBuffer);
+}
+
+static EFI_STATUS uefi_blocks_xfer(NTFS_VOLUME *Volume, s64 offset,
+		s64 count, void *b, BOOL towrite)
+{
+	EFI_BLOCK_IO_PROTOCOL *BlockIo;
+	EFI_LBA lba;
+
+	BlockIo = Volume->BlockIo;
+	lba = offset / BlockIo->Media->BlockSize;
+	if (towrite)
+		return (BlockIo->WriteBlocks(BlockIo, Volume->MediaId, lba,
+				count, b));
+	return (BlockIo->ReadBlocks(BlockIo, Volume->MediaId, lba,
+				count, b));
+}
+
+static int uefi_disk_xfer(NTFS_VOLUME *Volume, s64 offset, s64 count,
+		void *b, BOOL towrite)
+{
+	EFI_STATUS Status;
+	u8 *staging;
+	s64 done;
+	s64 size;
+
+	staging = (u8*)NULL;
+	if (uefi_blocks_aligned(Volume, offset, count)
+	    && !uefi_buffer_aligned(Volume, b))
+		staging = uefi_staging_buffer(Volume);
+	if (staging) {
+		Status = EFI_SUCCESS;
+		for (done=0; (done<count) && !EFI_ERROR(Status);
+				done+=size) {
+			size = min(count - done, UEFI_STAGING_SIZE);
+			if (towrite)
+				memcpy(staging, (u8*)b + done, size);
+			Status = uefi_blocks_xfer(Volume, offset + done,
+					size, staging, towrite);
+			if (!towrite && !EFI_ERROR(Status))
+				memcpy((u8*)b + done, staging, size);
+		}
+	} else if (uefi_blocks_aligned(Volume, offset, count)
+		   && uefi_buffer_aligned(Volume, b))
+		Status = uefi_blocks_xfer(Volume, offset, count, b, towrite);
+	else if (towrite)
+		Status = Volume->DiskIo->WriteDisk(Volume->DiskIo,
+				Volume->MediaId, offset, count, b);
+	else
+		Status = Volume->DiskIo->ReadDisk(Volume->DiskIo,
+				Volume->MediaId, offset, count, b);
+	if (EFI_ERROR(Status)) {
+		errno = EIO;
+		return -1;
+	}
+	if (towrite) {
+		Volume->Counters.DeviceWrites++;
+		Volume->Counters.DeviceBytesWritten += count;
+	} else {
+		Volume->Counters.DeviceReads++;
+		Volume->Counters.DeviceBytesRead += count;
+	}
+	return 0;
+}
+
+static int uefi_disk_read(NTFS_VOLUME *Volume, s64 offset, s64 count,
+		void *b)
+{
+	return (uefi_disk_xfer(Volume, offset, count, b, FALSE));
+}
+
+static int uefi_disk_write(NTFS_VOLUME *Volume, s64 offset, s64 count,
+		const void *b)
+{
+	return (uefi_disk_xfer(Volume, offset, count, (void*)b, TRUE));
+}
+
+/*
+ *		Write back a dirty block
+ */
+
+static int uefi_cache_writeback(NTFS_VOLUME *Volume,
+		struct UEFI_CACHED_BLOCK *blk)
+{
+	if (blk->dirty) {
+		if (uefi_disk_write(Volume, blk->offset,
+				Volume->BlockCache->block_size, blk->data))
+			return -1;
+		blk->dirty = FALSE;
+	}
+	return 0;
+}
+
+/*
+ *		Sort blocks by device offset (Shell sort, no recursion)
+ */
+
+static void uefi_cache_sort(struct UEFI_CACHED_BLOCK **blks, u32 count)
+{
+	struct UEFI_CACHED_BLOCK *blk;
+	u32 gap;
+	u32 i;
+	u32 j;
+
+	for (gap=count/2; gap; gap/=2)
+		for (i=gap; i<count; i++) {
+			blk = blks[i];
+			for (j=i; (j>=gap) && (blks[j-gap]->offset > blk->offset);
+					j-=gap)
+				blks[j] = blks[j-gap];
+			blks[j] = blk;
+		}
+}
+
+/*
+ *		Write back a run of dirty blocks adjacent on the device
+ *
+ * The blocks are gathered in the staging buffer so that the run goes
+ * in a single request, one by one if there is no staging buffer.
+ */
+
+static int uefi_cache_writeback_run(NTFS_VOLUME *Volume,
+		struct UEFI_CACHED_BLOCK **blks, u32 count)
+{
+	u32 block_size;
+	u8 *staging;
+	u32 i;
+	int ret;
+
+	block_size = Volume->BlockCache->block_size;
+	staging = (u8*)NULL;
+	if (count > 1)
+		staging = uefi_staging_buffer(Volume);
+	if (!staging) {
+		ret = 0;
+		for (i=0; i<count; i++)
+			if (uefi_cache_writeback(Volume, blks[i]))
+				ret = -1;
+		return (ret);
+	}
+	for (i=0; i<count; i++)
+		memcpy(staging + i*block_size, blks[i]->data, block_size);
+	if (uefi_disk_write(Volume, blks[0]->offset,
+			(s64)count*block_size, staging))
+		return (-1);
+	for (i=0; i<count; i++)
+		blks[i]->dirty = FALSE;
+	return (0);
+}
+
+/*
+ *		Write back the dirty blocks overlapping a device range
+ *
+ * The blocks are written in device order, runs of adjacent blocks
+ * (up to UEFI_STAGING_SIZE bytes) in a single request.
+ *
+ * Returns 0 if all were written, -1 otherwise (the failed ones are
+ *	kept dirty)
+ */
+
+static int uefi_cache_flush_range(NTFS_VOLUME *Volume, s64 offset,
+		s64 size)
+{
+	NTFS_BLOCK_CACHE *cache;
+	struct UEFI_CACHED_BLOCK **dirty;
+	struct UEFI_CACHED_BLOCK *blk;
+	u32 count;
+	u32 start;
+	u32 i;
+	int ret;
+
+	ret = 0;
+	cache = Volume->BlockCache;
+	if (cache) {
+		dirty = cache->dirty;
+		count = 0;
+		for (i=0; i<=cache->set_mask*UEFI_CACHE_WAYS
+				+ UEFI_CACHE_WAYS - 1; i++) {
+			blk = &cache->blocks[i];
+			if (blk->dirty
+			    && (blk->offset + cache->block_size > offset)
+			    && (blk->offset < offset + size))
+				dirty[count++] = blk;
+		}
+		uefi_cache_sort(dirty, count);
+		for (start=0; start<count; start=i) {
+			for (i=start+1; (i<count)
+			    && (dirty[i]->offset == dirty[i-1]->offset
+						+ cache->block_size)
+			    && ((i - start + 1)*cache->block_size
+						<= UEFI_STAGING_SIZE); i++) { }
+			if (uefi_cache_writeback_run(Volume, &dirty[start],
+					i - start))
+				ret = -1;
+		}
+	}
+	return (ret);
+}
+
+/*
+ *		Write back all dirty blocks
+ */
+
+static int uefi_cache_flush(NTFS_VOLUME *Volume)
+{
+	if (!Volume->BlockCache)
+		return (0);
+	return (uefi_cache_flush_range(Volume, 0,
+			Volume->BlockCache->dev_size));
+}
+
+/*
+ *		Write back all dirty blocks, then flush the device
+ *
+ * Returns 0 if the data is on the media, -1 otherwise with errno set
+ */
+
+static int uefi_cache_sync(NTFS_VOLUME *Volume)
+{
+	EFI_STATUS Status;
+
+	if (uefi_cache_flush(Volume))
+		return (-1);
+	Status = Volume->BlockIo->FlushBlocks(Volume->BlockIo);
+	if (EFI_ERROR(Status) && (Status != EFI_NO_MEDIA)) {
+		errno = EIO;
+		return (-1);
+	}
+	return (0);
+}
+
+static void uefi_cache_free(NTFS_VOLUME *Volume)
+{
+	if (Volume->BlockCache) {
+		if (Volume->BlockCache->data)
+			FreePages(Volume->BlockCache->data,
+				EFI_SIZE_TO_PAGES(UEFI_CACHE_BUDGET));
+		free(Volume->BlockCache->blocks);
+		free(Volume->BlockCache->dirty);
+		free(Volume->BlockCache);
+		Volume->BlockCache = (NTFS_BLOCK_CACHE*)NULL;
+	}
+}
+
+/*
+ *		Forget all blocks, dirty ones are lost
+ */
+
+static void uefi_cache_invalidate(NTFS_BLOCK_CACHE *cache)
+{
+	u32 i;
+
+	for (i=0; i<=cache->set_mask*UEFI_CACHE_WAYS
+			+ UEFI_CACHE_WAYS - 1; i++) {
+		cache->blocks[i].offset = -1;
+		cache->blocks[i].dirty = FALSE;
+	}
+}
+
+/**
+ * ntfs_device_uefi_cache_setup - (re)build the block cache of a volume
+ * @Volume:	the volume owning the cache
+ * @block_size:	size of a cache block, a power of two
+ *
+ * The current cache, if any, is written back and released. Failing to
+ * allocate a new cache is not an error, the device is then accessed
+ * directly.
+ *
+ * Return 0 if o.k.
+ *	 -1 if dirty blocks could not be written back, and errno set.
+ */
+int ntfs_device_uefi_cache_setup(NTFS_VOLUME *Volume, u32 block_size)
+{
+	NTFS_BLOCK_CACHE *cache;
+	u32 sets;
+	u32 i;
+
+	if (Volume->BlockCache
+	    && (Volume->BlockCache->block_size == block_size))
+		return (0);
+	if (uefi_cache_flush(Volume))
+		return (-1);
+	uefi_cache_free(Volume);
+
+	if ((block_size < NTFS_BLOCK_SIZE)
+	    || (block_size & (block_size - 1))
+	    || (block_size > UEFI_CACHE_BUDGET/UEFI_CACHE_WAYS))
+		return (0);
+	sets = UEFI_CACHE_BUDGET/UEFI_CACHE_WAYS/block_size;
+	cache = (NTFS_BLOCK_CACHE*)ntfs_calloc(sizeof(NTFS_BLOCK_CACHE));
+	if (!cache)
+		return (0);
+	cache->blocks = (struct UEFI_CACHED_BLOCK*)ntfs_calloc(sets
+			*UEFI_CACHE_WAYS*sizeof(struct UEFI_CACHED_BLOCK));
+	cache->dirty = (struct UEFI_CACHED_BLOCK**)ntfs_malloc(sets
+			*UEFI_CACHE_WAYS*sizeof(struct UEFI_CACHED_BLOCK*));
+	/* Page aligned, so that blocks can go to BlockIo directly */
+	cache->data = (u8*)AllocatePages(EFI_SIZE_TO_PAGES(UEFI_CACHE_BUDGET));
+	if (!cache->blocks || !cache->dirty || !cache->data) {
+		free(cache->blocks);
+		free(cache->dirty);
+		if (cache->data)
+			FreePages(cache->data,
+				EFI_SIZE_TO_PAGES(UEFI_CACHE_BUDGET));
+		free(cache);
+		return (0);
+	}
+	cache->block_size = block_size;
+	cache->block_bits = ffs(block_size) - 1;
+	cache->set_mask = sets - 1;
+	cache->media_id = Volume->BlockIo->Media->MediaId;
+	cache->dev_size = (Volume->BlockIo->Media->LastBlock + 1)
+			* (s64)Volume->BlockIo->Media->BlockSize;
+	for (i=0; i<sets*UEFI_CACHE_WAYS; i++) {
+		cache->blocks[i].offset = -1;
+		cache->blocks[i].data = &cache->data[i*block_size];
+	}
+	Volume->BlockCache = cache;
+	return (0);
+}
+
+/*
+ *		Get the cache of a volume, checking the media has not changed
+ */
+
+static NTFS_BLOCK_CACHE *uefi_cache_get(NTFS_VOLUME *Volume)
+{
+	NTFS_BLOCK_CACHE *cache;
+
+	if (!Volume->BlockCache)
+		ntfs_device_uefi_cache_setup(Volume, UEFI_CACHE_BLOCK);
+	cache = Volume->BlockCache;
+	if (cache && (cache->media_id != Volume->BlockIo->Media->MediaId)) {
+		uefi_cache_invalidate(cache);
+		cache->media_id = Volume->BlockIo->Media->MediaId;
+	}
+	return (cache);
+}
+
+/*
+ *		Find the cached copy of the block at a device offset
+ */
+
+static struct UEFI_CACHED_BLOCK *uefi_cache_lookup(NTFS_BLOCK_CACHE *cache,
+		s64 offset)
+{
+	struct UEFI_CACHED_BLOCK *set;
+	int i;
+
+	set = &cache->blocks[((offset >> cache->block_bits) & cache->set_mask)
+			* UEFI_CACHE_WAYS];
+	for (i=0; i<UEFI_CACHE_WAYS; i++)
+		if (set[i].offset == offset)
+			return (&set[i]);
+	return ((struct UEFI_CACHED_BLOCK*)NULL);
+}
+
+/*
+ *		Get a block for a device offset, loading it from disk if
+ *	it is not cached and @load is set.
+ *
+ * The least recently used block of the set is recycled, after being
+ * written back if it is dirty.
+ */
+
+static struct UEFI_CACHED_BLOCK *uefi_cache_block(NTFS_VOLUME *Volume,
+		s64 offset, BOOL load)
+{
+	NTFS_BLOCK_CACHE *cache;
+	struct UEFI_CACHED_BLOCK *set;
+	struct UEFI_CACHED_BLOCK *blk;
+	int i;
+
+	cache = Volume->BlockCache;
+	blk = uefi_cache_lookup(cache, offset);
+	if (blk)
+		Volume->Counters.CacheHits++;
+	else {
+		Volume->Counters.CacheMisses++;
+		set = &cache->blocks[((offset >> cache->block_bits)
+				& cache->set_mask) * UEFI_CACHE_WAYS];
+		blk = set;
+		for (i=1; (i<UEFI_CACHE_WAYS) && (blk->offset >= 0); i++)
+			if ((set[i].offset < 0)
+			    || (set[i].stamp < blk->stamp))
+				blk = &set[i];
+		if (uefi_cache_writeback(Volume, blk))
+			return ((struct UEFI_CACHED_BLOCK*)NULL);
+		blk->offset = -1;
+		if (load && uefi_disk_read(Volume, offset,
+				cache->block_size, blk->data))
+			return ((struct UEFI_CACHED_BLOCK*)NULL);
+		blk->offset = offset;
+	}
+	blk->stamp = ++cache->stamp;
+	return (blk);
+}
+
+/*
+ *		Merge the cached copies of the blocks overlapping a direct
+ *	access into the caller's buffer (@towrite clear) or into the
+ *	cache (@towrite set).
+ */
+
+static void uefi_cache_merge(NTFS_BLOCK_CACHE *cache, u8 *b, s64 count,
+		s64 offset, BOOL towrite)
+{
+	struct UEFI_CACHED_BLOCK *blk;
+	s64 blkofs;
+	s64 start;
+	s64 end;
+
+	blkofs = offset & ~(s64)(cache->block_size - 1);
+	for ( ; blkofs<offset+count; blkofs+=cache->block_size) {
+		blk = uefi_cache_lookup(cache, blkofs);
+		if (!blk)
+			continue;
+		start = (blkofs > offset ? blkofs : offset);
+		end = blkofs + cache->block_size;
+		if (end > offset + count)
+			end = offset + count;
+		if (towrite) {
+			memcpy(blk->data + start - blkofs,
+				b + start - offset, end - start);
+			if ((start == blkofs)
+			    && (end == blkofs + cache->block_size))
+				blk->dirty = FALSE;
+		} else
+			if (blk->dirty)
+				memcpy(b + start - offset,
+					blk->data + start - blkofs,
+					end - start);
+	}
+}
 
 /**
  * ntfs_device_uefi_open - open a device
@@ -122,14 +643,30 @@ static s64 ntfs_device_uefi_read(struct ntfs_device *dev, void *b, s64 count)
  * ntfs_device_uefi_close - close an open ntfs deivce
  * @dev:	ntfs device obtained via ->open
  *
+ * The volume cache is written back and released, and the device is
+ * flushed.
+ *
  * Return 0 if o.k.
- *	 -1 if not, and errno set.  Note if error fd->vol_handle is trashed.
+ *	 -1 if not, and errno set.
  */
 static int ntfs_device_uefi_close(struct ntfs_device *dev)
 {
+	NTFS_VOLUME           *Volume = (NTFS_VOLUME *)dev->d_private;
+	int ret;
+
 	//Print(L"ntfs_device_uefi_close\n");
 
-	return 0;
+	ret = 0;
+	if (Volume) {
+		ret = uefi_cache_sync(Volume);
+		uefi_cache_free(Volume);
+		if (Volume->StagingBuffer) {
+			FreeAlignedPages(Volume->StagingBuffer,
+				EFI_SIZE_TO_PAGES(UEFI_STAGING_SIZE));
+			Volume->StagingBuffer = (UINT8*)NULL;
+		}
+	}
+	return (ret);
 }
 
 /**
@@ -139,13 +676,18 @@ static int ntfs_device_uefi_close(struct ntfs_device *dev)
  * Return 0 if o.k.
  *	 -1 if not, and errno set.
  *
- * Note: Volume syncing works differently in windows.
- *	 Disk cannot be synced in windows.
+ * The dirty blocks of the volume cache are written back, then the device
+ * is flushed so that the data is on the media.
  */
 static int ntfs_device_uefi_sync(struct ntfs_device *dev)
 {
+	NTFS_VOLUME           *Volume = (NTFS_VOLUME *)dev->d_private;
+
 	//Print(L"ntfs_device_uefi_sync\n");
 
+	if (Volume && uefi_cache_sync(Volume))
+		return -1;
+	NDevClearDirty(dev);
 	return 0;
 }
 
@@ -241,31 +783,105 @@ static int ntfs_device_uefi_ioctl(struct ntfs_device *dev, int request,
 }
 
 
+/**
+ * ntfs_device_uefi_cache_writeback - write cached changes of a range
+ * @Volume:	the volume owning the cache
+ * @offset:	device offset of the range
+ * @count:	size of the range
+ *
+ * Write to the disk the dirty cached blocks overlapping the range, before
+ * it is read by other means than ntfs_device_uefi_pread(), such as
+ * DiskIo2. The device is not flushed, the data only has to reach it.
+ *
+ * Return 0 if o.k.
+ *	 -1 if not, and errno set.
+ */
+int ntfs_device_uefi_cache_writeback(NTFS_VOLUME *Volume, s64 offset,
+		s64 count)
+{
+	return (uefi_cache_flush_range(Volume, offset, count));
+}
+
+/*
+ *		Check whether a request has to bypass the cache
+ */
+
+static BOOL uefi_cache_bypass(NTFS_BLOCK_CACHE *cache, s64 count,
+		s64 offset)
+{
+	return (!cache
+		|| (count >= UEFI_CACHE_BYPASS)
+		|| (((offset + count + cache->block_size - 1)
+			& ~(s64)(cache->block_size - 1)) > cache->dev_size));
+}
+
 static s64 ntfs_device_uefi_pread(struct ntfs_device *dev, void *b,
 		s64 count, s64 offset)
 {
-	EFI_STATUS			  Status;
 	NTFS_VOLUME           *Volume = (NTFS_VOLUME *)dev->d_private;
+	NTFS_BLOCK_CACHE *cache;
+	struct UEFI_CACHED_BLOCK *blk;
+	s64 blkofs;
+	s64 done;
+	s64 size;
 
-	Status	  = Volume->DiskIo->ReadDisk (Volume->DiskIo, Volume->MediaId, offset, count, b);
-	if (EFI_ERROR (Status)) {
-	  return -1;
+	cache = uefi_cache_get(Volume);
+	if (uefi_cache_bypass(cache, count, offset)) {
+		if (uefi_disk_read(Volume, offset, count, b))
+			return -1;
+		if (cache)
+			uefi_cache_merge(cache, (u8*)b, count, offset, FALSE);
+		return count;
+	}
+
+	for (done=0; done<count; done+=size) {
+		blkofs = (offset + done) & ~(s64)(cache->block_size - 1);
+		size = blkofs + cache->block_size - offset - done;
+		if (size > count - done)
+			size = count - done;
+		blk = uefi_cache_block(Volume, blkofs, TRUE);
+		if (!blk)
+			return -1;
+		memcpy((u8*)b + done, blk->data + offset + done - blkofs,
+				size);
 	}
-	
 	return count;
 }
 
 static s64 ntfs_device_uefi_pwrite(struct ntfs_device *dev, const void *b,
 		s64 count, s64 offset)
 {
-	EFI_STATUS			  Status;
 	NTFS_VOLUME           *Volume = (NTFS_VOLUME *)dev->d_private;
+	NTFS_BLOCK_CACHE *cache;
+	struct UEFI_CACHED_BLOCK *blk;
+	s64 blkofs;
+	s64 done;
+	s64 size;
+
+	Volume->WriteGeneration++;
+	cache = uefi_cache_get(Volume);
+	if (uefi_cache_bypass(cache, count, offset)) {
+		if (uefi_disk_write(Volume, offset, count, b))
+			return -1;
+		if (cache)
+			uefi_cache_merge(cache, (u8*)b, count, offset, TRUE);
+		return count;
+	}
 
-	Status	  = Volume->DiskIo->WriteDisk (Volume->DiskIo, Volume->MediaId, offset, count, (VOID *)b);
-	if (EFI_ERROR (Status)) {
-	  return -1;
+	for (done=0; done<count; done+=size) {
+		blkofs = (offset + done) & ~(s64)(cache->block_size - 1);
+		size = blkofs + cache->block_size - offset - done;
+		if (size > count - done)
+			size = count - done;
+		/* No need to read a block which is fully overwritten */
+		blk = uefi_cache_block(Volume, blkofs,
+				size < cache->block_size);
+		if (!blk)
+			return (done ? done : -1);
+		memcpy(blk->data + offset + done - blkofs,
+				(const u8*)b + done, size);
+		blk->dirty = TRUE;
 	}
-	
 	return count;
 }
 
@@ -242,6 +242,84 @@ int ntfs_names_full_collate(const ntfschar *name1, const u32 name1_len,
 	return 0;
 }
 
+/*
+ * ntfs_names_upcased_collate() collate a name against an upcased key
+ *
+ * @key:	Unicode name looked for, already upcased
+ * @key_len:	length of @key
+ * @name:	Unicode name to compare, as found in an index
+ * @name_len:	length of @name
+ * @upcase:	upcase table
+ * @upcase_len:	upcase table size
+ *
+ * Same as ntfs_names_full_collate() with IGNORE_CASE, for a key which is
+ * upcased once for a whole lookup instead of for every comparison.
+ * Printable ASCII characters of @name are upcased without the table, the
+ * mapping of which is checked at mount time, and on little endian hosts
+ * they are compared four at a time. The table is only used for other
+ * characters.
+ *
+ * Returns:
+ *  -1 if the key collates before the name,
+ *   0 if they match ignoring case, or
+ *   1 if the name collates before the key
+ */
+int ntfs_names_upcased_collate(const ntfschar *key, const u32 key_len,
+		const ntfschar *name, const u32 name_len,
+		const ntfschar *upcase, const u32 upcase_len)
+{
+	u32 cnt;
+	u32 i;
+	u16 u1, u2;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	u64 k, n, lower;
+#endif
+
+	cnt = min(key_len, name_len);
+	i = 0;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	/*
+	 * Four characters in a word : a character c is printable ASCII
+	 * when c < 0x80 and c + 0x60 >= 0x80 and c + 0x01 < 0x80, and
+	 * a lower case letter when c + 0x1f >= 0x80 and c + 0x05 < 0x80.
+	 */
+	while ((i + 4) <= cnt) {
+		memcpy(&k, &key[i], sizeof(k));
+		memcpy(&n, &name[i], sizeof(n));
+		if ((n & 0xff80ff80ff80ff80ULL)
+		    || ((((n + 0x0060006000600060ULL)
+				& ~(n + 0x0001000100010001ULL))
+			& 0x0080008000800080ULL) != 0x0080008000800080ULL))
+			break;
+		lower = (n + 0x001f001f001f001fULL)
+				& ~(n + 0x0005000500050005ULL)
+				& 0x0080008000800080ULL;
+		if ((n - (lower >> 2)) != k)
+			break;
+		i += 4;
+	}
+#endif
+	for (; i<cnt; i++) {
+		u1 = le16_to_cpu(key[i]);
+		u2 = le16_to_cpu(name[i]);
+		if ((u2 >= 0x20) && (u2 < 0x7f)) {
+			if ((u2 >= 'a') && (u2 <= 'z'))
+				u2 += 'A' - 'a';
+		} else
+			if (u2 < upcase_len)
+				u2 = le16_to_cpu(upcase[u2]);
+		if (u1 < u2)
+			return -1;
+		if (u1 > u2)
+			return 1;
+	}
+	if (key_len < name_len)
+		return -1;
+	if (key_len > name_len)
+		return 1;
+	return 0;
+}
+
 /**
  * ntfs_ucsncmp - compare two little endian Unicode strings
  * @s1:		first string
@@ -356,6 +356,7 @@ mft_has_no_attr_list:
 			goto error_exit;
 		}
 		vol->mft_na->rl = nrl;
+		ntfs_attr_rl_changed(vol->mft_na);
 
 		/* Get the lowest vcn for the next extent. */
 		highest_vcn = sle64_to_cpu(a->highest_vcn);
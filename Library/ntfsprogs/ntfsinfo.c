@@ -81,6 +81,7 @@
 /* #include "version.h" */
 #include "support.h"
 #include "misc.h"
+#include "cache.h"
 
 static const char *EXEC_NAME = "ntfsinfo";
 
@@ -93,6 +94,7 @@ static struct options {
 	int	 force;		/* Override common sense */
 	int	 notime;	/* Don't report timestamps at all */
 	int	 mft;		/* Dump information about the volume as well */
+	int	 caches;	/* Report the hit ratios of the caches */
 } opts;
 
 struct RUNCOUNT {
@@ -136,6 +138,7 @@ static void usage(void)
 		"    -i, --inode NUM  Display information about this inode\n"
 		"    -F, --file FILE  Display information about this file (absolute path)\n"
 		"    -m, --mft        Dump information about the volume\n"
+		"    -c, --caches     Report the hit ratios of the caches\n"
 		"    -t, --notime     Don't report timestamps\n"
 		"\n"
 		"    -f, --force      Use less caution\n"
@@ -159,7 +162,7 @@ static void usage(void)
  */
 static int parse_options(int argc, char *argv[])
 {
-	static const char *sopt = "-:dfhi:F:mqtTvV";
+	static const char *sopt = "-:cdfhi:F:mqtTvV";
 	static const struct option lopt[] = {
 		{ "force",	 no_argument,		NULL, 'f' },
 		{ "help",	 no_argument,		NULL, 'h' },
@@ -170,6 +173,7 @@ static int parse_options(int argc, char *argv[])
 		{ "version",	 no_argument,		NULL, 'V' },
 		{ "notime",	 no_argument,		NULL, 'T' },
 		{ "mft",	 no_argument,		NULL, 'm' },
+		{ "caches",	 no_argument,		NULL, 'c' },
 		{ NULL,		 0,			NULL,  0  }
 	};
 
@@ -237,6 +241,9 @@ static int parse_options(int argc, char *argv[])
 		case 'm':
 			opts.mft++;
 			break;
+		case 'c':
+			opts.caches++;
+			break;
 		case '?':
 			if (optopt=='?') {
 				help++;
@@ -447,6 +454,30 @@ static const char *reparse_type_name(le32 tag)
 }
 
 /* *************** functions for dumping global info ******************** */
+/**
+ * ntfs_dump_caches - dump the hit ratios of the caches of the volume
+ */
+static void ntfs_dump_caches(const ntfs_volume *vol)
+{
+	struct CACHE_STATS stats[LRU_COUNT];
+	int count;
+	int i;
+
+	count = ntfs_lru_cache_stats(vol, stats);
+	printf("Cache Information \n");
+	for (i=0; i<count; i++) {
+		if (!stats[i].entries)
+			continue;
+		printf("\t%s: %d entries, %lu lookups, %lu hits (%2.1lf%%), "
+				"%lu inserts\n", stats[i].name,
+				stats[i].entries, stats[i].reads,
+				stats[i].hits, (stats[i].reads
+					? 100.0*stats[i].hits/stats[i].reads
+					: 0.0),
+				stats[i].writes);
+	}
+}
+
 /**
  * ntfs_dump_volume - dump information about the volume
  */
@@ -2498,6 +2529,9 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (opts.caches)
+		ntfs_dump_caches(vol);
+
 	ntfs_umount(vol, FALSE);
 	return 0;
 }
@@ -28,7 +28,7 @@ EFI_LOCK NtfsTaskLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 // Filesystem interface functions
 //
 EFI_FILE_PROTOCOL               NtfsFileInterface = {
-  EFI_FILE_PROTOCOL_REVISION,
+  EFI_FILE_PROTOCOL_REVISION2,
   NtfsOpen,
   NtfsClose,
   NtfsDelete,
@@ -39,8 +39,8 @@ EFI_FILE_PROTOCOL               NtfsFileInterface = {
   NtfsGetInfo,
   NtfsSetInfo,
   NtfsFlush,
-  NULL,
-  NULL,
-  NULL,
-  NULL
+  NtfsOpenEx,
+  NtfsReadEx,
+  NtfsWriteEx,
+  NtfsFlushEx
 };
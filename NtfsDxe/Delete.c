@@ -37,8 +37,8 @@ NtfsDelete (
   UINTN          ret;
   ntfs_inode     *dir_ni;
   ntfs_inode     *ni;
-  
-  Print(L"NtfsDelete+\n");
+  NTFS_TRACE_DECLARE (Trace);
+
   IFile = IFILE_FROM_FHAND (FHand);
   Volume = IFile->Volume;
 
@@ -46,6 +46,7 @@ NtfsDelete (
   // Lock the volume
   //
   NtfsAcquireLock ();
+  NTFS_TRACE_BEGIN (Trace, Volume, IFile);
 
   //
   // If the file is read-only, then don't delete it
@@ -63,19 +64,54 @@ NtfsDelete (
     goto Done;
   }
 
-  ni = ntfs_pathname_to_inode(Volume->VolInfo, NULL, IFile->Path);
-  
-  dir_ni = ntfs_dir_parent_inode(ni);
+  //
+  // ntfs_delete() consumes the inode, so take a pinned one out of its pin,
+  // the other handles of the file see it gone. The data still in the
+  // write-behind buffer goes away with the file.
+  //
+  if (IFile->IsDir) {
+    ni = NtfsIFileLoadInode (IFile);
+  } else if (!EFI_ERROR (NtfsIFileOpenInode (IFile))) {
+    ni = NtfsIFileDetachInode (IFile);
+  } else {
+    ni = NULL;
+  }
 
-  ret = ntfs_delete(Volume->VolInfo, IFile->Path, ni, dir_ni, IFile->FileInfo->FileName, StrLen(IFile->FileInfo->FileName));
+  if (ni == NULL) {
+    Status = EFI_DEVICE_ERROR;
+    goto Done;
+  }
+
+  //
+  // Unlink the name the handle was opened by, other hard links remain
+  //
+  dir_ni = ntfs_inode_open(Volume->VolInfo, MREF(IFile->ParentMRef));
+  if (dir_ni == NULL) {
+    ntfs_inode_close(ni);
+    Status = EFI_DEVICE_ERROR;
+    goto Done;
+  }
+
+  ret = ntfs_delete(Volume->VolInfo, NULL, ni, dir_ni, IFile->Name, StrLen(IFile->Name));
   if (ret) {
   	Status = EFI_DEVICE_ERROR;
   }
+  ntfs_inode_close(dir_ni);
+
+  //
+  // Write the records and blocks freed by the deletion out of the block cache
+  //
+  if (ntfs_device_sync(Volume->VolInfo->dev)) {
+    Status = EFI_DEVICE_ERROR;
+  }
 Done:
   //
   // Always close the handle
   //
   NtfsIFileClose (IFile);
+
+  Volume->RefCount--;
+  NTFS_TRACE_END (Trace, Volume, NtfsTraceDelete, 0);
   //
   // Done
   //
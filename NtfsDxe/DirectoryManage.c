@@ -37,76 +37,115 @@ IsParentRecur(
   return IsParentRecur(dir_ni, CurStr);
 }*/
 
-/*BOOL 
-IsDuplicate(
-  NTFS_IFILE  *IFile, 
-  CHAR8       *CurStr
-  )
-{
-  LIST_ENTRY     *Link;
-  NTFS_IFILE     *SubFile;
-  CHAR8 		 TempStr[PATH_MAX];
-
-  for ( Link = GetFirstNode (&IFile->SubFIleHead)
-    ; !IsNull (&IFile->SubFIleHead, Link)
-    ; Link = GetNextNode (&IFile->SubFIleHead, Link)
-    ) {
-    
-    SubFile = IFILE_FROM_LINK (Link);
-	utils_inode_get_name(SubFile->ni, TempStr, PATH_MAX);
-	if (strcmp(TempStr, CurStr) == 0) {
-  	  return TRUE;
-    }
-  }
-
-  return FALSE;
-}*/
-
-static int NtfsFiller(NTFS_IFILE *IFile,
-		const ntfschar *name, const int name_len, const int name_type,
+//
+// One directory entry captured by NtfsFiller during a cursor step
+//
+typedef struct {
+  BOOLEAN         Found;
+  BOOLEAN         Stopped;
+  MFT_REF         MRef;
+  BOOLEAN         IsDir;
+  FILE_NAME_ATTR  Key;
+  UINTN           NameLen;
+  CHAR16          Name[EFI_FILE_STRING_LENGTH + 1];
+} NTFS_DIR_ENTRY;
+
+static int NtfsFiller(NTFS_DIR_ENTRY *Entry, const FILE_NAME_ATTR *fn,
 		const s64 pos __attribute__((unused)), const MFT_REF mref,
-		const unsigned dt_type __attribute__((unused)))
+		const unsigned dt_type)
 {
-  EFI_STATUS     Status;
-  NTFS_IFILE     *SubFile;
   int            i;
-  ntfs_inode     *ni;
+  const ntfschar *name = fn->file_name;
+  const int      name_len = fn->file_name_length;
   const CHAR16   *ESTR[] = { L"$MFT", L"$MFTMirr", L"$LogFile",
 			  L"$Volume", L"$AttrDef", L"root directory", L"$Bitmap",
-			  L"$Boot", L"$BadClus", L"$Secure", L"$UpCase", L"$Extend", L".." };
+			  L"$Boot", L"$BadClus", L"$Secure", L"$UpCase", L"$Extend" };
+
+  if (fn->file_name_type == FILE_NAME_DOS) {
+  	return 0;
+  }
 
   for (i = 0; i < ARRAY_COUNT(ESTR); i++) {
-  	if (!StrnCmp(name, ESTR[i], name_len)) {
+  	if (StrLen(ESTR[i]) == (UINTN)name_len && !StrnCmp(name, ESTR[i], name_len)) {
 	  return 0;
   	}
   }
 
-  //Print(L"NtfsFiller %s %d %d %d %d\n", name, name_len, mref, dt_type, name_type);
-
-  if (name_type == FILE_NAME_DOS) {
-  	return 0;
+  //
+  // One entry per step: stop at the next one, ntfs_readdir_fn() leaves the
+  // cursor on it so that the following Read() returns it.
+  //
+  if (Entry->Found) {
+  	Entry->Stopped = TRUE;
+  	return 1;
   }
 
-  Status = NtfsAllocateIFile (IFile->Volume, &SubFile);
-  if (EFI_ERROR (Status)) {
-  	return -1;
-  }
+  Entry->Found   = TRUE;
+  Entry->MRef    = mref;
+  Entry->IsDir   = (BOOLEAN) (dt_type == NTFS_DT_DIR);
+  CopyMem (&Entry->Key, fn, sizeof (FILE_NAME_ATTR));
+  Entry->NameLen = MIN (name_len, EFI_FILE_STRING_LENGTH);
+  CopyMem (Entry->Name, name, Entry->NameLen * sizeof (CHAR16));
+  Entry->Name[Entry->NameLen] = L'\0';
+
+  return 0;
+}
+
+/**
 
-  ni = ntfs_inode_open(IFile->Volume->VolInfo, mref);
-  if (ni == NULL) {
-  	FreePool(SubFile);
-    return -1;
+  Fill the times, sizes and attributes of an EFI_FILE_INFO from an inode.
+
+  @param  ni                    - The inode of the file.
+  @param  Info                  - The file info to fill.
+
+**/
+STATIC
+VOID
+NtfsInodeToFileInfo (
+  IN  ntfs_inode         *ni,
+  OUT EFI_FILE_INFO      *Info
+  )
+{
+  NtfsTime2EfiTime(ni->last_access_time, &Info->LastAccessTime);
+  NtfsTime2EfiTime(ni->creation_time, &Info->CreateTime);
+  NtfsTime2EfiTime(ni->last_data_change_time, &Info->ModificationTime);
+
+  Info->Attribute     = ni->flags & EFI_FILE_VALID_ATTR;
+  Info->FileSize      = ni->data_size;
+  Info->PhysicalSize  = ni->allocated_size;
+
+  if (ni->mrec->flags & MFT_RECORD_IS_DIRECTORY) {
+    Info->Attribute |= EFI_FILE_DIRECTORY;
   }
-  utils_inode_get_name(ni, SubFile->Path, PATH_MAX);
-  ntfs_inode_close(ni);
+}
 
-  SubFile->IsDir = ((dt_type & NTFS_DT_DIR) == NTFS_DT_DIR);
-  SubFile->FileInfoSize = SIZE_OF_EFI_FILE_INFO + (name_len + 1) * 2;
-  InsertTailList (&IFile->SubFIleHead, &SubFile->LinkNode);
-  
-  IFile->FileInfo->FileSize += SubFile->FileInfoSize;
+/**
 
-  return 0;
+  Fill the times, sizes and attributes of an EFI_FILE_INFO from the
+  FILE_NAME_ATTR key of a directory index entry.
+
+  @param  Entry                 - The captured directory entry.
+  @param  Info                  - The file info to fill.
+
+**/
+STATIC
+VOID
+NtfsIndexKeyToFileInfo (
+  IN  NTFS_DIR_ENTRY     *Entry,
+  OUT EFI_FILE_INFO      *Info
+  )
+{
+  NtfsTime2EfiTime(Entry->Key.last_access_time, &Info->LastAccessTime);
+  NtfsTime2EfiTime(Entry->Key.creation_time, &Info->CreateTime);
+  NtfsTime2EfiTime(Entry->Key.last_data_change_time, &Info->ModificationTime);
+
+  Info->Attribute     = le32_to_cpu(Entry->Key.file_attributes) & EFI_FILE_VALID_ATTR;
+  Info->FileSize      = sle64_to_cpu(Entry->Key.data_size);
+  Info->PhysicalSize  = sle64_to_cpu(Entry->Key.allocated_size);
+
+  if (Entry->IsDir) {
+    Info->Attribute |= EFI_FILE_DIRECTORY;
+  }
 }
 
 /**
@@ -127,8 +166,7 @@ NtfsGetDirEntInfo (
   IN     NTFS_VOLUME        *Volume,
   IN     NTFS_IFILE         *IFile,
   IN OUT UINTN              *BufferSize,
-    OUT VOID                *Buffer,
-  IN     BOOL               IsCountDirSize
+    OUT VOID                *Buffer
   )
 {
   UINTN               Size;
@@ -136,18 +174,10 @@ NtfsGetDirEntInfo (
   UINTN               ResultSize;
   EFI_STATUS          Status;
   EFI_FILE_INFO       *Info;
-  //CHAR8               AsciiStr[PATH_MAX];
-  CHAR16              *UnicodeStr;
   CHAR16              *FileName;
   ntfs_inode          *ni;
 
-  //utils_inode_get_name(IFile->ni, AsciiStr, PATH_MAX);
-  UnicodeStr = (CHAR16 *) AllocateZeroPool (AsciiStrSize(IFile->Path) * 2);
-  Ascii2Unicode(UnicodeStr, IFile->Path);
-  //Print(L"%s\n", UnicodeStr);
-  //Ascii2Unicode(UnicodeStr, AsciiStr);
-  //Print(L"%s\n", UnicodeStr);
-  FileName = GetFileNameFromPathW(UnicodeStr);
+  FileName = IFile->Name;
 
   ASSERT_VOLUME_LOCKED (Volume);
 
@@ -161,43 +191,139 @@ NtfsGetDirEntInfo (
     Info        = Buffer;
     Info->Size  = ResultSize;
 
-    ni = ntfs_pathname_to_inode(Volume->VolInfo, NULL, IFile->Path);
-	
-	NtfsTime2EfiTime(ni->last_access_time, &Info->LastAccessTime);
-	NtfsTime2EfiTime(ni->creation_time, &Info->CreateTime);
-	NtfsTime2EfiTime(ni->last_data_change_time, &Info->ModificationTime);
-	
-    Info->Attribute = ni->flags & EFI_FILE_VALID_ATTR;
-	
-	if (IFile->IsDir) {
-	  IFile->FileInfo->FileSize = 0;
-	
-	  if (IsCountDirSize) {
-	  	INT64 Pos = 0;
-	    ntfs_readdir(ni, &Pos, IFile, (ntfs_filldir_t)NtfsFiller);
-	  }
-	  
-	  Info->FileSize = IFile->FileInfo->FileSize;
-	  Info->PhysicalSize = Info->FileSize;
-	  Info->Attribute |= EFI_FILE_DIRECTORY;
-	}
-	else {
-      Info->FileSize      = ni->data_size;
-      Info->PhysicalSize  = ni->allocated_size;
-	}
-
-    ntfs_inode_close(ni);
-	
-    CopyMem ((CHAR8 *) Buffer + Size, FileName, NameSize);
-    //Print(L"NtfsGetDirEntInfo %d %d %t %t %t 0x%x %s\n", Info->FileSize, Info->PhysicalSize, Info->LastAccessTime, Info->CreateTime, Info->ModificationTime, Info->Attribute, (Buffer + Size));
-  }
-
-  FreePool(UnicodeStr);
+    ni = (IFile->Pin != NULL) ? IFile->Pin->Ni : NULL;
+    if (ni == NULL) {
+      ni = NtfsIFileLoadInode (IFile);
+    }
+
+    if (ni == NULL) {
+      Status = EFI_DEVICE_ERROR;
+    } else {
+      NtfsInodeToFileInfo (ni, Info);
+      if (IFile->Pin == NULL || ni != IFile->Pin->Ni) {
+        ntfs_inode_close(ni);
+      } else {
+        Info->PhysicalSize = NtfsPinPhysicalSize (IFile->Pin);
+      }
+      CopyMem ((CHAR8 *) Buffer + Size, FileName, NameSize);
+    }
+  }
+
   *BufferSize = ResultSize;
 
   return Status;
 }
 
+/**
+
+  Read the next entry of a directory into Buffer and advance the cursor.
+  Entries are produced one index entry at a time, so memory use does not
+  depend on the size of the directory. The file info is built from the
+  index key, no MFT record of the entries is read.
+
+  @param  IFile                 - The open directory instance.
+  @param  BufferSize            - Size of Buffer, set to 0 at end of directory.
+  @param  Buffer                - Buffer receiving the EFI_FILE_INFO.
+
+  @retval EFI_SUCCESS           - The entry is read, or the end was reached.
+  @retval EFI_BUFFER_TOO_SMALL  - The buffer is too small, the cursor is kept.
+  @retval EFI_DEVICE_ERROR      - The directory can not be read.
+
+**/
+EFI_STATUS
+NtfsReadDirEntry (
+  IN     NTFS_IFILE         *IFile,
+  IN OUT UINTN              *BufferSize,
+     OUT VOID               *Buffer
+  )
+{
+  NTFS_VOLUME         *Volume;
+  EFI_STATUS          Status;
+  EFI_FILE_INFO       *Info;
+  NTFS_DIR_ENTRY      *Entry;
+  UINTN               ResultSize;
+  ntfs_inode          *dir_ni;
+  s64                 Pos;
+  LIST_ENTRY          *Link;
+  NTFS_PINNED_INODE   *Pin;
+
+  Volume = IFile->Volume;
+
+  ASSERT_VOLUME_LOCKED (Volume);
+
+  Entry = AllocatePool (sizeof (NTFS_DIR_ENTRY));
+  if (Entry == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Entry->Found   = FALSE;
+  Entry->Stopped = FALSE;
+
+  dir_ni = NtfsIFileLoadInode (IFile);
+  if (dir_ni == NULL) {
+    FreePool (Entry);
+    return EFI_DEVICE_ERROR;
+  }
+
+  //
+  // ntfs_readdir_fn() also fails when NtfsFiller stops it on the next
+  // entry, that is the only failure which is not an error
+  //
+  Pos = IFile->DirPos;
+  if (ntfs_readdir_fn(dir_ni, &Pos, Entry, (ntfs_fnfilldir_t)NtfsFiller) && !Entry->Stopped) {
+    Status = EFI_DEVICE_ERROR;
+    goto Done;
+  }
+
+  if (!Entry->Found) {
+    IFile->DirPos = Pos;
+    *BufferSize   = 0;
+    Status        = EFI_SUCCESS;
+    goto Done;
+  }
+
+  ResultSize = SIZE_OF_EFI_FILE_INFO + (Entry->NameLen + 1) * sizeof (CHAR16);
+  if (*BufferSize < ResultSize) {
+    *BufferSize = ResultSize;
+    Status      = EFI_BUFFER_TOO_SMALL;
+    goto Done;
+  }
+
+  //
+  // The index key is refreshed on inode sync only, an open file may hold
+  // newer times and sizes in its pinned inode
+  //
+  Pin = NULL;
+  for (Link = GetFirstNode (&Volume->PinnedFiles)
+    ; !IsNull (&Volume->PinnedFiles, Link)
+    ; Link = GetNextNode (&Volume->PinnedFiles, Link)
+    ) {
+    if (PIN_FROM_LINK (Link)->Ni->mft_no == MREF (Entry->MRef)) {
+      Pin = PIN_FROM_LINK (Link);
+      break;
+    }
+  }
+
+  Info = Buffer;
+  if (Pin != NULL) {
+    NtfsInodeToFileInfo (Pin->Ni, Info);
+    Info->PhysicalSize = NtfsPinPhysicalSize (Pin);
+  } else {
+    NtfsIndexKeyToFileInfo (Entry, Info);
+  }
+
+  Info->Size = ResultSize;
+  CopyMem (Info->FileName, Entry->Name, (Entry->NameLen + 1) * sizeof (CHAR16));
+
+  IFile->DirPos = Pos;
+  *BufferSize   = ResultSize;
+  Status        = EFI_SUCCESS;
+
+Done:
+  ntfs_inode_close(dir_ni);
+  FreePool (Entry);
+  return Status;
+}
+
 /**
 
   Set the relevant directory entry into disk for the volume.
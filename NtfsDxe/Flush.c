@@ -32,12 +32,36 @@ EFIAPI
 NtfsFlush (
   IN EFI_FILE_PROTOCOL  *FHand
   )
+{
+  return NtfsFlushEx (FHand, NULL);
+}
+
+/**
+
+  Flushes all data associated with the file handle. The flush is done
+  synchronously, a non-blocking request is completed through its token.
+
+  @param  FHand                 - Handle to file to flush.
+  @param  Token                 - A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS           - Flushed the file successfully.
+  @retval EFI_WRITE_PROTECTED   - The volume is read only.
+  @retval EFI_ACCESS_DENIED     - The file is read only.
+  @return Others                - Flushing of the file failed.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsFlushEx (
+  IN EFI_FILE_PROTOCOL  *FHand,
+  IN EFI_FILE_IO_TOKEN  *Token
+  )
 {
   NTFS_IFILE   *IFile;
   NTFS_VOLUME  *Volume;
   EFI_STATUS   Status = EFI_SUCCESS;
   UINTN        ret;
-  Print(L"NtfsFlushEx+\n");
+  NTFS_TRACE_DECLARE (Trace);
 
   IFile   = IFILE_FROM_FHAND (FHand);
   Volume  = IFile->Volume;
@@ -57,15 +81,26 @@ NtfsFlush (
   // Flush the OFile
   //
   NtfsAcquireLock ();
-  ret = ntfs_device_sync(Volume->VolInfo->dev);
+  NTFS_TRACE_BEGIN (Trace, Volume, IFile);
+  ret = 0;
+  if (EFI_ERROR (NtfsIFileFlushWriteBehind (IFile, FALSE))) {
+    ret = 1;
+  }
+  if (!ret && IFile->Pin != NULL && IFile->Pin->Ni != NULL) {
+    ret = ntfs_inode_sync(IFile->Pin->Ni);
+  }
+  if (!ret) {
+    ret = ntfs_device_sync(Volume->VolInfo->dev);
+  }
   
   if (ret) {
     Status = EFI_DEVICE_ERROR;
   }
+  NTFS_TRACE_END (Trace, Volume, NtfsTraceFlush, 0);
   NtfsCleanupVolume (Volume);
   NtfsReleaseLock ();
 
-  return Status;
+  return NtfsCompleteToken (Token, Status);
 }
 
 
@@ -86,16 +121,39 @@ NtfsClose (
 {
   NTFS_IFILE   *IFile;
   NTFS_VOLUME  *Volume;
+  UINT64       Generation;
+  NTFS_TRACE_DECLARE (Trace);
 
   IFile   = IFILE_FROM_FHAND (FHand);
   Volume  = IFile->Volume;
-  
-  Print(L"NtfsClose %s\n", IFile->FileInfo->FileName);
 
   //
   // Lock the volume
   //
   NtfsAcquireLock ();
+  NTFS_TRACE_BEGIN (Trace, Volume, IFile);
+
+  if (!IFile->ReadOnly && !Volume->ReadOnly) {
+    NtfsIFileFlushWriteBehind (IFile, TRUE);
+    if (IFile->Pin != NULL && IFile->Pin->Ni != NULL) {
+      ntfs_inode_sync(IFile->Pin->Ni);
+    }
+  }
+
+  //
+  // Releasing the last reference of a dirty inode writes its record, even
+  // for a read-only handle
+  //
+  Generation = Volume->WriteGeneration;
+  NtfsIFileReleaseInode (IFile);
+
+  //
+  // Write back what the handle left in the block cache
+  //
+  if (!Volume->ReadOnly &&
+      (!IFile->ReadOnly || Generation != Volume->WriteGeneration)) {
+    ntfs_device_sync(Volume->VolInfo->dev);
+  }
 
   //
   // Close the file instance handle
@@ -103,6 +161,7 @@ NtfsClose (
   NtfsIFileClose (IFile);
 
   Volume->RefCount--;
+  NTFS_TRACE_END (Trace, Volume, NtfsTraceClose, 0);
 
   //
   // Done. Unlock the volume
@@ -128,22 +187,17 @@ NtfsIFileClose (
   )
 {
   NTFS_VOLUME    *Volume;
-  LIST_ENTRY     *Link;
-  NTFS_IFILE     *SubFile;
 
   Volume  = IFile->Volume;
 
   ASSERT_VOLUME_LOCKED (Volume);
 
+  NtfsIFileFreeReadAhead (IFile);
+  NtfsIFileReleaseInode (IFile);
+
   FreePool (IFile->FileInfo);
+  FreePool (IFile->Name);
 
-  while (!IsListEmpty (&IFile->SubFIleHead)) {
-    Link = GetFirstNode (&IFile->SubFIleHead);
-    RemoveEntryList (Link);
-    SubFile = IFILE_FROM_LINK (Link);
-    FreePool(SubFile);
-  }
-  
   //
   // Done. Free the open instance structure
   //
@@ -178,7 +232,13 @@ NtfsCleanupVolume (
   // The only time volume be invalidated is in DriverBindingStop.
   //
   if (Volume->RefCount == 0 && !Volume->Valid) {
-  	ntfs_umount(Volume->VolInfo, FALSE);
+    //
+    // The file system is mounted once, by the first OpenVolume()
+    //
+    if (Volume->VolInfo != NULL) {
+      ntfs_umount(Volume->VolInfo, FALSE);
+      Volume->VolInfo = NULL;
+    }
     //
     // Free the volume structure
     //
@@ -109,6 +109,14 @@ NtfsGetFileInfo (
 	Info        = Buffer;
 	
     CopyMem ((CHAR8 *) Buffer, (CHAR8 *)IFile->FileInfo, IFile->FileInfoSize);
+
+    //
+    // The other handles sharing the pinned inode may have written to it
+    //
+    if (IFile->Pin != NULL && IFile->Pin->Ni != NULL) {
+      Info->FileSize     = MAX (Info->FileSize, (UINT64) IFile->Pin->DataAttr->data_size);
+      Info->PhysicalSize = NtfsPinPhysicalSize (IFile->Pin);
+    }
   }
 
   *BufferSize = IFile->FileInfoSize;
@@ -150,11 +158,6 @@ NtfsGetVolumeInfo (
   ResultSize        = Size + NameSize;
   ClusterAlignment  = Volume->VolInfo->cluster_size_bits;
 
-  //
-  // If we don't have valid info, compute it now
-  //
-  //FatComputeFreeInfo (Volume);
-
   Status = EFI_BUFFER_TOO_SMALL;
   if (*BufferSize >= ResultSize) {
     Status  = EFI_SUCCESS;
@@ -166,8 +169,12 @@ NtfsGetVolumeInfo (
     Info->ReadOnly    = Volume->ReadOnly;
     Info->BlockSize   = (UINT32) Volume->VolInfo->cluster_size;
     Info->VolumeSize  = LShiftU64 (Volume->VolInfo->nr_clusters, ClusterAlignment);
-	ntfs_volume_get_free_space(Volume->VolInfo);
-    Info->FreeSpace   = LShiftU64 (Volume->VolInfo->free_clusters, ClusterAlignment);
+    //
+    // Counted at mount time, then maintained by the cluster allocator
+    //
+    if (Volume->VolInfo->free_clusters > 0) {
+      Info->FreeSpace = LShiftU64 (Volume->VolInfo->free_clusters, ClusterAlignment);
+    }
     CopyMem ((CHAR8 *) Buffer + Size, Name, NameSize);
   }
 
@@ -318,6 +325,9 @@ NtfsSetFileInfo (
   EFI_FILE_INFO  *NewInfo;
   EFI_TIME       ZeroTime;
   UINT8          NewAttribute;
+  FILE_ATTR_FLAGS NewFlags;
+  ntfs_time      Time;
+  BOOLEAN        Dirty;
   BOOLEAN        ReadOnly;
   ntfs_inode     *ni;
 
@@ -337,8 +347,16 @@ NtfsSetFileInfo (
   }
 
   ReadOnly = IFile->ReadOnly;
+  Dirty    = FALSE;
 
-  ni =ntfs_pathname_to_inode(Volume->VolInfo, NULL, IFile->Path);
+  if (IFile->IsDir) {
+    ni = NtfsIFileLoadInode (IFile);
+  } else {
+    ni = EFI_ERROR (NtfsIFileOpenInode (IFile)) ? NULL : IFile->Pin->Ni;
+  }
+  if (ni == NULL) {
+    return EFI_DEVICE_ERROR;
+  }
   
   //
   // if a zero time is specified, then the original time is preserved
@@ -350,7 +368,9 @@ NtfsSetFileInfo (
     }
 
     if (!ReadOnly) {
+      Time = ni->creation_time;
       EfiTime2NtfsTime(&NewInfo->CreateTime, &ni->creation_time);
+      Dirty = (BOOLEAN) (Dirty || ni->creation_time != Time);
     }
   }
 
@@ -361,7 +381,9 @@ NtfsSetFileInfo (
     }
 
     if (!ReadOnly) {
+      Time = ni->last_data_change_time;
       EfiTime2NtfsTime(&NewInfo->ModificationTime, &ni->last_data_change_time);
+      Dirty = (BOOLEAN) (Dirty || ni->last_data_change_time != Time);
     }
   }
 
@@ -380,12 +402,36 @@ NtfsSetFileInfo (
   }
   
   //
-  // Set the current attributes even if the IFile->ReadOnly is TRUE
+  // Set the current attributes even if the IFile->ReadOnly is TRUE. Only
+  // the low bits are EFI ones, the others (sparse, compressed, index...)
+  // belong to NTFS and are kept.
   //
-  ni->flags = (UINT8) ((ni->flags &~EFI_FILE_VALID_ATTR) | NewAttribute);
+  NewFlags = (ni->flags & ~cpu_to_le32 (EFI_FILE_VALID_ATTR & ~EFI_FILE_DIRECTORY)) |
+             cpu_to_le32 (NewAttribute & ~EFI_FILE_DIRECTORY);
+  if (NewFlags != ni->flags) {
+    ni->flags = NewFlags;
+    Dirty     = TRUE;
+  }
 
 Done:
-  ntfs_inode_close(ni);
+  //
+  // Only a record that changed is written back
+  //
+  if (Dirty) {
+    ntfs_inode_mark_dirty(ni);
+  }
+  if (!IFile->IsDir) {
+    //
+    // Write the record back and drop the pin, the next access reloads it
+    // unless another handle shares the inode
+    //
+    if (Dirty) {
+      ntfs_inode_sync (ni);
+    }
+    NtfsIFileReleaseInode (IFile);
+  } else {
+    ntfs_inode_close(ni);
+  }
   return Status;
 }
 
@@ -415,6 +461,7 @@ NtfsSetOrGetInfo (
   NTFS_IFILE   *IFile;
   NTFS_VOLUME  *Volume;
   EFI_STATUS  Status;
+  NTFS_TRACE_DECLARE (Trace);
 
   IFile   = IFILE_FROM_FHAND (FHand);
   Volume  = IFile->Volume;
@@ -422,6 +469,7 @@ NtfsSetOrGetInfo (
   Status = EFI_SUCCESS;
 
   NtfsAcquireLock ();
+  NTFS_TRACE_BEGIN (Trace, Volume, IFile);
 
   //
   // Verify the file handle isn't in an error state
@@ -458,6 +506,7 @@ NtfsSetOrGetInfo (
     }
   }
 
+  NTFS_TRACE_END (Trace, Volume, IsSet ? NtfsTraceSetInfo : NtfsTraceGetInfo, 0);
   NtfsCleanupVolume (Volume);
 
   NtfsReleaseLock ();
@@ -487,8 +536,6 @@ NtfsGetInfo (
      OUT VOID                *Buffer
   )
 {
-  Print(L"NtfsGetInfo+\n");
-
   return NtfsSetOrGetInfo (FALSE, FHand, Type, BufferSize, Buffer);
 }
 
@@ -514,7 +561,5 @@ NtfsSetInfo (
   IN VOID               *Buffer
   )
 {
-  Print(L"NtfsSetInfo+\n");
-
   return NtfsSetOrGetInfo (TRUE, FHand, Type, &BufferSize, Buffer);
 }
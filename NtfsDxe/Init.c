@@ -33,6 +33,7 @@ EFI_STATUS
 NtfsAllocateVolume (
   IN  EFI_HANDLE                Handle,
   IN  EFI_DISK_IO_PROTOCOL      *DiskIo,
+  IN  EFI_DISK_IO2_PROTOCOL     *DiskIo2,
   IN  EFI_BLOCK_IO_PROTOCOL     *BlockIo
   )
 {
@@ -53,12 +54,27 @@ NtfsAllocateVolume (
   Volume->Signature                   = NTFS_VOLUME_SIGNATURE;
   Volume->Handle                      = Handle;
   Volume->DiskIo                      = DiskIo;
+  Volume->DiskIo2                     = DiskIo2;
   Volume->BlockIo                     = BlockIo;
   Volume->MediaId                     = BlockIo->Media->MediaId;
   Volume->ReadOnly                    = BlockIo->Media->ReadOnly;
   Volume->VolumeInterface.Revision    = EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION;
   Volume->VolumeInterface.OpenVolume  = NtfsOpenVolume;
   Volume->RefCount                    = 0;
+  Volume->TraceInterface.Revision     = NTFS_TRACE_PROTOCOL_REVISION;
+  Volume->TraceInterface.GetCounters  = NtfsTraceGetCounters;
+  Volume->TraceInterface.GetEvents    = NtfsTraceGetEvents;
+  Volume->TraceInterface.Reset        = NtfsTraceReset;
+  Volume->TraceInterface.GetCacheStats = NtfsTraceGetCacheStats;
+  InitializeListHead (&Volume->PinnedFiles);
+
+#ifdef NTFS_TRACE
+  Volume->TraceEvents = AllocateZeroPool (NTFS_TRACE_EVENTS * sizeof (NTFS_TRACE_EVENT));
+  if (Volume->TraceEvents == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+#endif
 
   //
   // Check to see if there's a file system on the volume
@@ -75,6 +91,8 @@ NtfsAllocateVolume (
                   &Volume->Handle,
                   &gEfiSimpleFileSystemProtocolGuid,
                   &Volume->VolumeInterface,
+                  &gNtfsTraceProtocolGuid,
+                  &Volume->TraceInterface,
                   NULL
                   );
   if (EFI_ERROR (Status)) {
@@ -120,6 +138,8 @@ NtfsAbandonVolume (
                     Volume->Handle,
                     &gEfiSimpleFileSystemProtocolGuid,
                     &Volume->VolumeInterface,
+                    &gNtfsTraceProtocolGuid,
+                    &Volume->TraceInterface,
                     NULL
                     );
     if (EFI_ERROR (Status)) {
@@ -153,6 +173,7 @@ NtfsAbandonVolume (
   //
   if (LockedByMe) {
     NtfsCleanupVolume (Volume);
+    NtfsReleaseLock ();
   }
 
   return EFI_SUCCESS;
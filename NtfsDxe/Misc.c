@@ -59,6 +59,33 @@ NtfsReleaseLock (
   EfiReleaseLock (&NtfsFsLock);
 }
 
+/**
+
+  Complete a request that was served synchronously. A non-blocking
+  request gets its status in the token, whose event is signaled.
+
+  @param  Token                 - The token of the request, may be NULL.
+  @param  Status                - The status of the request.
+
+  @retval EFI_SUCCESS           - The token is signaled.
+  @return Others                - Status of a blocking request.
+
+**/
+EFI_STATUS
+NtfsCompleteToken (
+  IN EFI_FILE_IO_TOKEN  *Token,
+  IN EFI_STATUS         Status
+  )
+{
+  if (Token == NULL || Token->Event == NULL) {
+    return Status;
+  }
+
+  Token->Status = Status;
+  gBS->SignalEvent (Token->Event);
+  return EFI_SUCCESS;
+}
+
 /**
 
   Free volume structure (including the contents of directory cache and disk cache).
@@ -71,6 +98,9 @@ NtfsFreeVolume (
   IN NTFS_VOLUME       *Volume
   )
 {
+  if (Volume->TraceEvents != NULL) {
+    FreePool (Volume->TraceEvents);
+  }
   FreePool (Volume);
 }
 
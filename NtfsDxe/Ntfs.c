@@ -360,6 +360,7 @@ NtfsDriverBindingStart (
   EFI_STATUS            Status;
   EFI_BLOCK_IO_PROTOCOL *BlockIo;
   EFI_DISK_IO_PROTOCOL  *DiskIo;
+  EFI_DISK_IO2_PROTOCOL *DiskIo2;
   BOOLEAN               LockedByMe;
 
   LockedByMe = FALSE;
@@ -403,11 +404,28 @@ NtfsDriverBindingStart (
     goto Exit;
   }
 
+  //
+  // DiskIo2 is optional. It is used for read-ahead and for non-blocking
+  // ReadEx() requests, without it ReadEx() reads synchronously and
+  // completes the request through its token.
+  //
+  Status = gBS->OpenProtocol (
+                  ControllerHandle,
+                  &gEfiDiskIo2ProtocolGuid,
+                  (VOID **) &DiskIo2,
+                  This->DriverBindingHandle,
+                  ControllerHandle,
+                  EFI_OPEN_PROTOCOL_BY_DRIVER
+                  );
+  if (EFI_ERROR (Status)) {
+    DiskIo2 = NULL;
+  }
+
   //
   // Allocate Volume structure. In FatAllocateVolume(), Resources
   // are allocated with protocol installed and cached initialized
   //
-  Status = NtfsAllocateVolume (ControllerHandle, DiskIo, BlockIo);
+  Status = NtfsAllocateVolume (ControllerHandle, DiskIo, DiskIo2, BlockIo);
 
   //
   // When the media changes on a device it will Reinstall the BlockIo interaface.
@@ -430,6 +448,14 @@ NtfsDriverBindingStart (
              This->DriverBindingHandle,
              ControllerHandle
              );
+      if (DiskIo2 != NULL) {
+        gBS->CloseProtocol (
+               ControllerHandle,
+               &gEfiDiskIo2ProtocolGuid,
+               This->DriverBindingHandle,
+               ControllerHandle
+               );
+      }
     }
   }
 
@@ -42,6 +42,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "cache.h"
 #include "dir.h"
 #include "NtfsFileSystem.h"
+#include "NtfsTrace.h"
 #include "utils.h"
 #include "string.h"
 #include "stdlib.h"
@@ -51,6 +52,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #define NTFS_VOLUME_SIGNATURE         SIGNATURE_32 ('n', 't', 'f', 'V')
 #define NTFS_IFILE_SIGNATURE          SIGNATURE_32 ('n', 't', 'f', 'i')
+#define NTFS_PIN_SIGNATURE            SIGNATURE_32 ('n', 't', 'f', 'p')
 
 #define ASSERT_VOLUME_LOCKED(a)      ASSERT_LOCKED (&NtfsFsLock)
 
@@ -58,7 +60,11 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #define VOLUME_FROM_VOL_INTERFACE(a) CR (a, NTFS_VOLUME, VolumeInterface, NTFS_VOLUME_SIGNATURE);
 
-#define IFILE_FROM_LINK(a)           CR (a, NTFS_IFILE, LinkNode, NTFS_IFILE_SIGNATURE)
+#define PIN_FROM_LINK(a)             CR (a, NTFS_PINNED_INODE, Link, NTFS_PIN_SIGNATURE)
+
+#define NTFS_INODE_MREF(ni)          MK_MREF ((ni)->mft_no, le16_to_cpu ((ni)->mrec->sequence_number))
+
+#define VOLUME_FROM_TRACE_INTERFACE(a) CR (a, NTFS_VOLUME, TraceInterface, NTFS_VOLUME_SIGNATURE)
 
 //
 // Efi Time Definition
@@ -83,10 +89,135 @@ typedef enum {
 
 typedef struct _NTFS_VOLUME NTFS_VOLUME;
 
+//
+// Read-ahead of sequential file reads, see ReadWrite.c
+//
+#define NTFS_READ_AHEAD_WINDOWS     2
+#define NTFS_READ_AHEAD_SIZE        SIZE_256KB
+
+//
+// Reads of at least this size go extent by extent, see ntfs_attr_bulk_read()
+//
+#define NTFS_BULK_READ_SIZE         SIZE_1MB
+
+//
+// Write-behind of small file writes, see ReadWrite.c. Clusters are
+// preallocated ahead of the written data, by as much as the file already
+// holds, within these bounds and within 1/2^NTFS_PREALLOCATE_FREE_SHIFT of
+// the free space.
+//
+#define NTFS_WRITE_BEHIND_SIZE      SIZE_256KB
+#define NTFS_PREALLOCATE_MAX        SIZE_64MB
+#define NTFS_PREALLOCATE_FREE_SHIFT 3
+
+typedef struct {
+  UINT8               *Buffer;
+  s64                 Start;         // File offset of Buffer[0]
+  UINTN               Length;        // 0 if the buffer holds nothing
+} NTFS_WRITE_BEHIND;
+
+//
+// Inode and unnamed $DATA attribute kept open while a handle of the file
+// is, shared by all the handles of the MFT record. Ni is NULL once the
+// file is deleted through one of them.
+//
+typedef struct {
+  UINTN               Signature;
+  LIST_ENTRY          Link;          // In Volume->PinnedFiles
+  UINTN               RefCount;      // Number of handles holding the pin
+  ntfs_inode          *Ni;
+  ntfs_attr           *DataAttr;
+  //
+  // Allocated by the first small write, holds data the library has not
+  // seen yet. Preallocated is set once clusters are reserved past the
+  // end of data, they are given back when the last handle goes.
+  //
+  NTFS_WRITE_BEHIND   *WriteBehind;
+  BOOLEAN             Preallocated;
+} NTFS_PINNED_INODE;
+
+typedef struct _NTFS_READ_AHEAD NTFS_READ_AHEAD;
+
+typedef struct {
+  EFI_DISK_IO2_TOKEN  Token;
+  NTFS_READ_AHEAD     *ReadAhead;
+  UINT8               *Buffer;
+  BOOLEAN             Pending;       // ReadDiskEx issued, data not consumed yet
+  BOOLEAN             Done;          // Set by the notification, under NtfsTaskLock
+  s64                 Start;         // File offset of Buffer[0]
+  UINTN               Length;        // 0 if the window holds nothing
+  s64                 DiskOffset;    // Device offset of Buffer[0]
+  UINT64              Generation;    // Volume->WriteGeneration at issue
+} NTFS_READ_AHEAD_WINDOW;
+
+//
+// InFlight and Orphaned are shared with the notifications and taken under
+// NtfsTaskLock. A handle closed with reads in flight leaves the windows
+// to the last notification, which frees them.
+//
+struct _NTFS_READ_AHEAD {
+  s64                     NextPos;   // Where a sequential read would start
+  UINTN                   InFlight;  // Windows whose read is not signaled yet
+  BOOLEAN                 Orphaned;  // The handle is gone
+  NTFS_READ_AHEAD_WINDOW  Window[NTFS_READ_AHEAD_WINDOWS];
+};
+
+//
+// Non-blocking ReadEx() request, one DiskIo2 subtask per extent
+//
+#define NTFS_TASK_SIGNATURE           SIGNATURE_32 ('n', 't', 'f', 'T')
+
+typedef struct _NTFS_TASK NTFS_TASK;
+
+typedef struct {
+  EFI_DISK_IO2_TOKEN  DiskIo2Token;
+  NTFS_TASK           *Task;
+} NTFS_SUBTASK;
+
+struct _NTFS_TASK {
+  UINTN               Signature;
+  EFI_FILE_IO_TOKEN   *FileIoToken;
+  UINTN               Pending;       // Subtasks in flight, plus one while issuing
+  EFI_STATUS          Status;        // First error reported by a subtask
+  NTFS_SUBTASK        Subtasks[1];
+};
+
+typedef struct _NTFS_BLOCK_CACHE NTFS_BLOCK_CACHE;
+
+//
+// Trace of file operations, see Trace.c. The events are only recorded
+// when the driver is built with NTFS_TRACE defined.
+//
+typedef struct {
+  UINT64              Tick;
+  UINT64              Handle;
+  UINT32              PathHash;
+  UINT64              DeviceReads;
+  UINT64              DeviceWrites;
+} NTFS_TRACE_SCOPE;
+
+#ifdef NTFS_TRACE
+#define NTFS_TRACE_DECLARE(Scope)                NTFS_TRACE_SCOPE Scope
+#define NTFS_TRACE_BEGIN(Scope, Volume, IFile)   NtfsTraceBegin (&(Scope), (Volume), (IFile))
+#define NTFS_TRACE_FILE(Scope, IFile)            NtfsTraceFile (&(Scope), (IFile))
+#define NTFS_TRACE_END(Scope, Volume, Op, Bytes) NtfsTraceEnd (&(Scope), (Volume), (Op), (Bytes))
+#else
+#define NTFS_TRACE_DECLARE(Scope)
+#define NTFS_TRACE_BEGIN(Scope, Volume, IFile)
+#define NTFS_TRACE_FILE(Scope, IFile)
+#define NTFS_TRACE_END(Scope, Volume, Op, Bytes)
+#endif
+
 typedef struct {
   UINTN               Signature;
   EFI_FILE_PROTOCOL   Handle;
-  CHAR8               Path[PATH_MAX];
+  //
+  // The file is identified by its MFT reference, a sequence number of 0
+  // matches any. Name is the link it was opened by in the parent directory.
+  //
+  MFT_REF             MRef;
+  MFT_REF             ParentMRef;
+  CHAR16              *Name;
   INT64               Position;
   BOOLEAN             ReadOnly;
   NTFS_VOLUME         *Volume;
@@ -94,8 +225,18 @@ typedef struct {
   BOOLEAN             IsRoot;
   UINTN               FileInfoSize;
   EFI_FILE_INFO       *FileInfo;
-  LIST_ENTRY          LinkNode;                  
-  LIST_ENTRY          SubFIleHead;             
+  //
+  // ntfs_readdir() cursor of the next entry to return from a directory
+  //
+  s64                 DirPos;
+  //
+  // Pinned inode of a regular file, NULL until the first access needs it
+  //
+  NTFS_PINNED_INODE   *Pin;
+  //
+  // Allocated once the handle is seen reading sequentially
+  //
+  NTFS_READ_AHEAD     *ReadAhead;
 } NTFS_IFILE;
 
 struct _NTFS_VOLUME {
@@ -118,7 +259,33 @@ struct _NTFS_VOLUME {
   UINT32                          MediaId;
   BOOLEAN                         ReadOnly;
 
+  //
+  // Block cache of the device, see uefi_io.c
+  //
+  NTFS_BLOCK_CACHE                *BlockCache;
+  //
+  // Aligned bounce buffer for BlockIo transfers from misaligned buffers
+  //
+  UINT8                           *StagingBuffer;
+  //
+  // Bumped on every device write, stale read-ahead windows are dropped
+  //
+  UINT64                          WriteGeneration;
+
   ntfs_volume                     *VolInfo;
+
+  //
+  // Open file instances currently holding a pinned inode
+  //
+  LIST_ENTRY                      PinnedFiles;
+
+  //
+  // Counters and recorded events, see Trace.c
+  //
+  NTFS_TRACE_PROTOCOL             TraceInterface;
+  NTFS_VOLUME_COUNTERS            Counters;
+  NTFS_TRACE_EVENT                *TraceEvents;
+  UINT64                          TraceHead;
 };
 
 //
@@ -154,6 +321,36 @@ NtfsOpen (
   IN  UINT64            Attributes
   );
 
+/**
+
+  Implements OpenEx() of Simple File System Protocol.
+
+  @param  FHand                 - File handle of the file serves as a starting reference point.
+  @param  NewHandle             - Handle of the file that is newly opened.
+  @param  FileName              - File name relative to FHand.
+  @param  OpenMode              - Open mode.
+  @param  Attributes            - Attributes to set if the file is created.
+  @param  Token                 - A pointer to the token associated with the transaction.
+
+  @retval EFI_INVALID_PARAMETER - The FileName is NULL or the file string is empty.
+                          The OpenMode is not supported.
+                          The Attributes is not the valid attributes.
+  @retval EFI_OUT_OF_RESOURCES  - Can not allocate the memory for file string.
+  @retval EFI_SUCCESS           - Open the file successfully.
+  @return Others                - The status of open file.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsOpenEx (
+  IN  EFI_FILE_PROTOCOL       *FHand,
+  OUT EFI_FILE_PROTOCOL       **NewHandle,
+  IN  CHAR16                  *FileName,
+  IN  UINT64                  OpenMode,
+  IN  UINT64                  Attributes,
+  IN OUT EFI_FILE_IO_TOKEN    *Token
+  );
+
 /**
 
   Get the file's position of the file
@@ -236,6 +433,26 @@ NtfsFlush (
   IN EFI_FILE_PROTOCOL  *FHand
   );
 
+/**
+
+  Flushes all data associated with the file handle.
+
+  @param  FHand                 - Handle to file to flush.
+  @param  Token                 - A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS           - Flushed the file successfully.
+  @retval EFI_WRITE_PROTECTED   - The volume is read only.
+  @retval EFI_ACCESS_DENIED     - The file is read only.
+  @return Others                - Flushing of the file failed.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsFlushEx (
+  IN EFI_FILE_PROTOCOL  *FHand,
+  IN EFI_FILE_IO_TOKEN  *Token
+  );
+
 /**
 
   Flushes & Closes the file handle.
@@ -333,6 +550,94 @@ NtfsWrite (
   IN     VOID                   *Buffer
   );
 
+/**
+
+  Get the file info.
+
+  @param  FHand                 - The handle of the file.
+  @param  Token                 - A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS           - Get the file info successfully.
+  @retval EFI_DEVICE_ERROR      - Can not find the OFile for the file.
+  @retval EFI_VOLUME_CORRUPTED  - The file type of open file is error.
+  @return other                 - An error occurred when operation the disk.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsReadEx (
+  IN     EFI_FILE_PROTOCOL  *FHand,
+  IN OUT EFI_FILE_IO_TOKEN  *Token
+  );
+
+/**
+
+  Write the content of buffer into files.
+
+  @param  FHand                 - The handle of the file.
+  @param  Token                 - A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS           - Set the file info successfully.
+  @retval EFI_WRITE_PROTECTED   - The disk is write protect.
+  @retval EFI_ACCESS_DENIED     - The file is read-only.
+  @retval EFI_DEVICE_ERROR      - The OFile is not valid.
+  @retval EFI_UNSUPPORTED       - The open file is not a file.
+  @return other                 - An error occurred when operation the disk.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsWriteEx (
+  IN     EFI_FILE_PROTOCOL  *FHand,
+  IN OUT EFI_FILE_IO_TOKEN  *Token
+  );
+
+/**
+
+  Release the read-ahead windows of an open file instance. Those with a
+  read in flight are freed by its notification.
+
+  @param  IFile                 - The open file instance.
+
+**/
+VOID
+NtfsIFileFreeReadAhead (
+  IN NTFS_IFILE          *IFile
+  );
+
+/**
+
+  Write the data buffered for the inode pinned by an open file instance.
+
+  @param  IFile                 - The open file instance.
+  @param  Trim                  - Also free the clusters preallocated past
+                                  the end of data.
+
+  @retval EFI_SUCCESS           - Nothing is buffered anymore.
+  @retval EFI_DEVICE_ERROR      - An error occurred when writing the data.
+
+**/
+EFI_STATUS
+NtfsIFileFlushWriteBehind (
+  IN NTFS_IFILE          *IFile,
+  IN BOOLEAN             Trim
+  );
+
+/**
+
+  The physical size of a pinned file. Clusters preallocated past the end
+  of data are not counted, they are given back when the last handle goes.
+
+  @param  Pin                   - The pinned inode.
+
+  @return The physical size in bytes.
+
+**/
+UINT64
+NtfsPinPhysicalSize (
+  IN NTFS_PINNED_INODE   *Pin
+  );
+
 //
 // FileName.c
 //
@@ -417,6 +722,7 @@ EFI_STATUS
 NtfsAllocateVolume (
   IN  EFI_HANDLE                     Handle,
   IN  EFI_DISK_IO_PROTOCOL           *DiskIo,
+  IN  EFI_DISK_IO2_PROTOCOL          *DiskIo2,
   IN  EFI_BLOCK_IO_PROTOCOL          *BlockIo
   );
 
@@ -473,8 +779,27 @@ NtfsGetDirEntInfo (
   IN    NTFS_VOLUME        *Volume,
   IN    NTFS_IFILE         *IFile,
   IN OUT UINTN             *BufferSize,
-    OUT VOID               *Buffer,
-  IN    BOOL               IsCountDirSize
+    OUT VOID               *Buffer
+  );
+
+/**
+
+  Read the next entry of a directory into Buffer and advance the cursor.
+
+  @param  IFile                 - The open directory instance.
+  @param  BufferSize            - Size of Buffer, set to 0 at end of directory.
+  @param  Buffer                - Buffer receiving the EFI_FILE_INFO.
+
+  @retval EFI_SUCCESS           - The entry is read, or the end was reached.
+  @retval EFI_BUFFER_TOO_SMALL  - The buffer is too small, the cursor is kept.
+  @retval EFI_DEVICE_ERROR      - The directory can not be read.
+
+**/
+EFI_STATUS
+NtfsReadDirEntry (
+  IN     NTFS_IFILE         *IFile,
+  IN OUT UINTN              *BufferSize,
+     OUT VOID               *Buffer
   );
 
 /**
@@ -519,6 +844,24 @@ NtfsReleaseLock (
   VOID
   );
 
+/**
+
+  Complete a request that was served synchronously. A non-blocking
+  request gets its status in the token, whose event is signaled.
+
+  @param  Token                 - The token of the request, may be NULL.
+  @param  Status                - The status of the request.
+
+  @retval EFI_SUCCESS           - The token is signaled.
+  @return Others                - Status of a blocking request.
+
+**/
+EFI_STATUS
+NtfsCompleteToken (
+  IN EFI_FILE_IO_TOKEN  *Token,
+  IN EFI_STATUS         Status
+  );
+
 /**
 
   Lock the volume.
@@ -775,6 +1118,87 @@ NtfsAllocateIFile (
   OUT NTFS_IFILE        **PtrIFile
   );
 
+/**
+
+  Attach an already opened inode to the open file instance and keep it,
+  together with its unnamed $DATA attribute, until the instance releases it.
+  If another instance already holds the same MFT record, its pin is shared
+  and Ni is closed, so that only one in-memory copy exists.
+
+  @param  IFile                 - The open file instance.
+  @param  Ni                    - The inode of the file, owned by the callee.
+
+  @retval EFI_SUCCESS           - The inode is pinned on the instance.
+  @retval EFI_OUT_OF_RESOURCES  - Can not allocate the memory.
+  @retval EFI_DEVICE_ERROR      - The $DATA attribute can not be opened.
+
+**/
+EFI_STATUS
+NtfsIFilePinInode (
+  IN NTFS_IFILE         *IFile,
+  IN ntfs_inode         *Ni
+  );
+
+/**
+
+  Make sure the inode of the open file instance is resolved and pinned.
+
+  @param  IFile                 - The open file instance.
+
+  @retval EFI_SUCCESS           - IFile->Pin->Ni and IFile->Pin->DataAttr are valid.
+  @retval EFI_NOT_FOUND         - The file does not exist anymore.
+  @retval EFI_OUT_OF_RESOURCES  - Can not allocate the memory.
+  @retval EFI_DEVICE_ERROR      - The $DATA attribute can not be opened.
+
+**/
+EFI_STATUS
+NtfsIFileOpenInode (
+  IN NTFS_IFILE         *IFile
+  );
+
+/**
+
+  Open the inode of an open file instance by its MFT reference. The
+  caller closes it, regular files use NtfsIFileOpenInode() instead.
+
+  @param  IFile                 - The open file instance.
+
+  @return The inode, or NULL if the MFT record does not hold the file anymore.
+
+**/
+ntfs_inode *
+NtfsIFileLoadInode (
+  IN NTFS_IFILE         *IFile
+  );
+
+/**
+
+  Drop the reference of the open file instance on its pinned inode. The
+  last one writes the inode back and closes it.
+
+  @param  IFile                 - The open file instance.
+
+**/
+VOID
+NtfsIFileReleaseInode (
+  IN NTFS_IFILE         *IFile
+  );
+
+/**
+
+  Take the inode out of the pin of the open file instance, for the caller
+  to consume it. The other instances holding the pin see the file as gone.
+
+  @param  IFile                 - The open file instance, its inode is pinned.
+
+  @return The inode.
+
+**/
+ntfs_inode *
+NtfsIFileDetachInode (
+  IN NTFS_IFILE         *IFile
+  );
+
 //
 // ntfsfix.c
 //
@@ -811,6 +1235,151 @@ NtfsOpenVolume (
   OUT EFI_FILE_PROTOCOL               **File
   );
 
+//
+// uefi_io.c
+//
+int
+ntfs_device_uefi_cache_setup (
+  NTFS_VOLUME         *Volume,
+  u32                 block_size
+  );
+
+int
+ntfs_device_uefi_cache_writeback (
+  NTFS_VOLUME         *Volume,
+  s64                 offset,
+  s64                 count
+  );
+
+//
+// Trace.c
+//
+
+/**
+
+  Implements GetCounters() of the NTFS trace protocol.
+
+  @param  This                  - The protocol instance of the volume.
+  @param  Counters              - The counters of the volume.
+
+  @retval EFI_SUCCESS           - The counters are returned.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsTraceGetCounters (
+  IN  NTFS_TRACE_PROTOCOL   *This,
+  OUT NTFS_VOLUME_COUNTERS  *Counters
+  );
+
+/**
+
+  Implements GetEvents() of the NTFS trace protocol.
+
+  @param  This                  - The protocol instance of the volume.
+  @param  Count                 - On input the number of events Events can hold,
+                                  on output the number of events returned.
+  @param  Events                - The events, oldest first.
+  @param  Dropped               - The number of events overwritten since the last reset.
+
+  @retval EFI_SUCCESS           - The events are returned.
+  @retval EFI_UNSUPPORTED       - The driver is built without NTFS_TRACE.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsTraceGetEvents (
+  IN     NTFS_TRACE_PROTOCOL  *This,
+  IN OUT UINTN                *Count,
+     OUT NTFS_TRACE_EVENT     *Events,
+     OUT UINT64               *Dropped OPTIONAL
+  );
+
+/**
+
+  Implements Reset() of the NTFS trace protocol.
+
+  @param  This                  - The protocol instance of the volume.
+
+  @retval EFI_SUCCESS           - The counters and the events are cleared.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsTraceReset (
+  IN NTFS_TRACE_PROTOCOL  *This
+  );
+
+/**
+
+  Implements GetCacheStats() of the NTFS trace protocol.
+
+  @param  This                  - The protocol instance of the volume.
+  @param  Count                 - On input the number of caches Caches can hold,
+                                  on output the number of caches of the volume.
+  @param  Caches                - The statistics of the caches.
+
+  @retval EFI_SUCCESS           - The statistics are returned.
+  @retval EFI_BUFFER_TOO_SMALL  - Caches is too small, Count is updated.
+  @retval EFI_NOT_READY         - The volume is not mounted.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsTraceGetCacheStats (
+  IN     NTFS_TRACE_PROTOCOL  *This,
+  IN OUT UINTN                *Count,
+     OUT NTFS_CACHE_COUNTERS  *Caches
+  );
+
+/**
+
+  Start timing a file operation, the volume must be locked.
+
+  @param  Scope                 - The state of the operation.
+  @param  Volume                - The volume of the file.
+  @param  IFile                 - The file of the operation, may be NULL.
+
+**/
+VOID
+NtfsTraceBegin (
+  OUT NTFS_TRACE_SCOPE  *Scope,
+  IN  NTFS_VOLUME       *Volume,
+  IN  NTFS_IFILE        *IFile
+  );
+
+/**
+
+  Attribute the event of an operation to another file.
+
+  @param  Scope                 - The state of the operation.
+  @param  IFile                 - The file of the operation.
+
+**/
+VOID
+NtfsTraceFile (
+  IN OUT NTFS_TRACE_SCOPE  *Scope,
+  IN     NTFS_IFILE        *IFile
+  );
+
+/**
+
+  Record the event of a file operation, the volume must still be locked.
+
+  @param  Scope                 - The state of the operation.
+  @param  Volume                - The volume of the file.
+  @param  Op                    - The operation.
+  @param  Bytes                 - The bytes read or written.
+
+**/
+VOID
+NtfsTraceEnd (
+  IN NTFS_TRACE_SCOPE  *Scope,
+  IN NTFS_VOLUME       *Volume,
+  IN NTFS_TRACE_OP     Op,
+  IN UINT64            Bytes
+  );
+
 extern EFI_DRIVER_BINDING_PROTOCOL     gNtfsDriverBinding;
 extern EFI_COMPONENT_NAME_PROTOCOL     gNtfsComponentName;
 extern EFI_COMPONENT_NAME2_PROTOCOL    gNtfsComponentName2;
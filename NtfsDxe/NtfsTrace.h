@@ -0,0 +1,167 @@
+/** @file
+  Trace events and volume counters of the NTFS driver. The driver installs
+  NTFS_TRACE_PROTOCOL on the handle of each volume it manages, the NtfsTrace
+  shell application dumps them.
+
+  The counters are always maintained. Events are only recorded when the
+  driver is built with NTFS_TRACE defined. The statistics of the caches of
+  the NTFS library are counted from the mount of the volume.
+
+**/
+
+#ifndef _NTFS_TRACE_H_
+#define _NTFS_TRACE_H_
+
+#define NTFS_TRACE_PROTOCOL_GUID \
+  { \
+    0xdea8d847, 0xb5c1, 0x4e89, {0x94, 0xea, 0xc2, 0xa1, 0x3d, 0x2a, 0x4d, 0x49 } \
+  }
+
+#define NTFS_TRACE_PROTOCOL_REVISION  0x00010001
+
+//
+// Number of events kept per volume, a power of two
+//
+#define NTFS_TRACE_EVENTS             1024
+
+typedef struct _NTFS_TRACE_PROTOCOL NTFS_TRACE_PROTOCOL;
+
+typedef enum {
+  NtfsTraceOpenVolume,
+  NtfsTraceOpen,
+  NtfsTraceClose,
+  NtfsTraceDelete,
+  NtfsTraceRead,
+  NtfsTraceWrite,
+  NtfsTraceGetInfo,
+  NtfsTraceSetInfo,
+  NtfsTraceFlush,
+  NtfsTraceMaxOp
+} NTFS_TRACE_OP;
+
+//
+// One file operation, timed from the time it takes the volume lock
+//
+typedef struct {
+  UINT64              Tick;           // AsmReadTsc() at start
+  UINT64              Elapsed;        // Ticks spent in the operation
+  UINT64              Handle;         // EFI_FILE_PROTOCOL of the file
+  UINT64              Bytes;          // Bytes read or written
+  UINT32              PathHash;       // FNV-1a hash of the name of the file
+  UINT16              Op;             // NTFS_TRACE_OP
+  UINT16              Reserved;
+  UINT32              DeviceReads;    // Device reads issued by the operation
+  UINT32              DeviceWrites;   // Device writes issued by the operation
+} NTFS_TRACE_EVENT;
+
+typedef struct {
+  UINT64              CacheHits;          // Block cache lookups served from memory
+  UINT64              CacheMisses;        // Block cache lookups that loaded a block
+  UINT64              MftRecordReads;     // MFT records read
+  UINT64              IndexBlockReads;    // Directory index blocks read
+  UINT64              DeviceReads;        // Read requests sent to the device
+  UINT64              DeviceWrites;       // Write requests sent to the device
+  UINT64              DeviceBytesRead;
+  UINT64              DeviceBytesWritten;
+} NTFS_VOLUME_COUNTERS;
+
+//
+// One cache of the NTFS library, since revision 0x00010001
+//
+typedef struct {
+  CHAR8               Name[8];        // Name of the cache
+  UINT32              Entries;        // Entries of the cache, 0 if it is not present
+  UINT32              Reserved;
+  UINT64              Lookups;        // Lookups of an entry
+  UINT64              Hits;           // Lookups which found the entry
+  UINT64              Inserts;        // Entries entered or refreshed
+} NTFS_CACHE_COUNTERS;
+
+/**
+
+  Get the counters of the volume.
+
+  @param  This                  - The protocol instance of the volume.
+  @param  Counters              - The counters of the volume.
+
+  @retval EFI_SUCCESS           - The counters are returned.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *NTFS_TRACE_GET_COUNTERS) (
+  IN  NTFS_TRACE_PROTOCOL   *This,
+  OUT NTFS_VOLUME_COUNTERS  *Counters
+  );
+
+/**
+
+  Get the recorded events of the volume, oldest first.
+
+  @param  This                  - The protocol instance of the volume.
+  @param  Count                 - On input the number of events Events can hold,
+                                  on output the number of events returned.
+  @param  Events                - The events.
+  @param  Dropped               - The number of events overwritten since the last reset.
+
+  @retval EFI_SUCCESS           - The events are returned.
+  @retval EFI_UNSUPPORTED       - The driver is built without NTFS_TRACE.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *NTFS_TRACE_GET_EVENTS) (
+  IN     NTFS_TRACE_PROTOCOL  *This,
+  IN OUT UINTN                *Count,
+     OUT NTFS_TRACE_EVENT     *Events,
+     OUT UINT64               *Dropped OPTIONAL
+  );
+
+/**
+
+  Clear the counters and the recorded events of the volume.
+
+  @param  This                  - The protocol instance of the volume.
+
+  @retval EFI_SUCCESS           - The counters and the events are cleared.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *NTFS_TRACE_RESET) (
+  IN NTFS_TRACE_PROTOCOL  *This
+  );
+
+/**
+
+  Get the statistics of the caches of the NTFS library for the volume.
+
+  @param  This                  - The protocol instance of the volume.
+  @param  Count                 - On input the number of caches Caches can hold,
+                                  on output the number of caches of the volume.
+  @param  Caches                - The statistics of the caches.
+
+  @retval EFI_SUCCESS           - The statistics are returned.
+  @retval EFI_BUFFER_TOO_SMALL  - Caches is too small, Count is updated.
+  @retval EFI_NOT_READY         - The volume is not mounted.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *NTFS_TRACE_GET_CACHE_STATS) (
+  IN     NTFS_TRACE_PROTOCOL  *This,
+  IN OUT UINTN                *Count,
+     OUT NTFS_CACHE_COUNTERS  *Caches
+  );
+
+struct _NTFS_TRACE_PROTOCOL {
+  UINT64                      Revision;
+  NTFS_TRACE_GET_COUNTERS     GetCounters;
+  NTFS_TRACE_GET_EVENTS       GetEvents;
+  NTFS_TRACE_RESET            Reset;
+  NTFS_TRACE_GET_CACHE_STATS  GetCacheStats;
+};
+
+extern EFI_GUID gNtfsTraceProtocolGuid;
+
+#endif
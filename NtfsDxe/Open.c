@@ -48,49 +48,337 @@ NtfsAllocateIFile (
 
   CopyMem (&(IFile->Handle), &NtfsFileInterface, sizeof (EFI_FILE_PROTOCOL));
 
-  IFile->Handle.Revision = EFI_FILE_PROTOCOL_REVISION;
+  IFile->Handle.Revision = EFI_FILE_PROTOCOL_REVISION2;
 
   IFile->Volume = Volume;
 
-  InitializeListHead (&IFile->LinkNode);
-  InitializeListHead (&IFile->SubFIleHead);
-
   *PtrIFile = IFile;
   return EFI_SUCCESS;
 }
 
+/**
+
+  Write back the MFT record of an inode pinned by open file instances, if
+  they left it dirty, before another copy of it is read. A file created
+  through a handle is not even marked in use on disk until then.
+
+  @param  Volume                - The volume.
+  @param  MftNo                 - The MFT record number of the inode.
+
+**/
+STATIC
+VOID
+NtfsSyncPinnedInode (
+  IN NTFS_VOLUME  *Volume,
+  IN u64          MftNo
+  )
+{
+  LIST_ENTRY         *Link;
+  NTFS_PINNED_INODE  *Pin;
+
+  for (Link = GetFirstNode (&Volume->PinnedFiles)
+    ; !IsNull (&Volume->PinnedFiles, Link)
+    ; Link = GetNextNode (&Volume->PinnedFiles, Link)
+    ) {
+    Pin = PIN_FROM_LINK (Link);
+    if (Pin->Ni->mft_no == MftNo) {
+      if (NInoDirty (Pin->Ni) || NInoAttrListDirty (Pin->Ni)) {
+        ntfs_inode_sync (Pin->Ni);
+      }
+      return;
+    }
+  }
+}
+
+/**
+
+  Attach an already opened inode to the open file instance and keep it,
+  together with its unnamed $DATA attribute, until the instance releases it.
+  If another instance already holds the same MFT record, its pin is shared
+  and Ni is closed, so that only one in-memory copy exists.
+
+  @param  IFile                 - The open file instance.
+  @param  Ni                    - The inode of the file, owned by the callee.
+
+  @retval EFI_SUCCESS           - The inode is pinned on the instance.
+  @retval EFI_OUT_OF_RESOURCES  - Can not allocate the memory.
+  @retval EFI_DEVICE_ERROR      - The $DATA attribute can not be opened.
+
+**/
+EFI_STATUS
+NtfsIFilePinInode (
+  IN NTFS_IFILE  *IFile,
+  IN ntfs_inode  *Ni
+  )
+{
+  NTFS_VOLUME        *Volume;
+  LIST_ENTRY         *Link;
+  NTFS_PINNED_INODE  *Pin;
+
+  Volume = IFile->Volume;
+
+  ASSERT_VOLUME_LOCKED (Volume);
+  ASSERT (IFile->Pin == NULL);
+
+  for (Link = GetFirstNode (&Volume->PinnedFiles)
+    ; !IsNull (&Volume->PinnedFiles, Link)
+    ; Link = GetNextNode (&Volume->PinnedFiles, Link)
+    ) {
+    Pin = PIN_FROM_LINK (Link);
+    if (Pin->Ni->mft_no == Ni->mft_no) {
+      //
+      // Never keep two copies of a record open, the pinned one may be newer.
+      // Its record was written back before Ni was read.
+      //
+      ntfs_inode_real_close (Ni);
+
+      Pin->RefCount++;
+      IFile->Pin = Pin;
+      return EFI_SUCCESS;
+    }
+  }
+
+  Pin = AllocateZeroPool (sizeof (NTFS_PINNED_INODE));
+  if (Pin == NULL) {
+    ntfs_inode_close (Ni);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Pin->Signature = NTFS_PIN_SIGNATURE;
+  Pin->RefCount  = 1;
+  Pin->DataAttr  = ntfs_attr_open (Ni, AT_DATA, AT_UNNAMED, 0);
+  if (Pin->DataAttr == NULL) {
+    FreePool (Pin);
+    ntfs_inode_close (Ni);
+    return EFI_DEVICE_ERROR;
+  }
+
+  //
+  // Decode the whole runlist once, reads then only look up the VCN
+  //
+  if (NAttrNonResident (Pin->DataAttr) &&
+      ntfs_attr_map_whole_runlist (Pin->DataAttr) != 0) {
+    ntfs_attr_close (Pin->DataAttr);
+    FreePool (Pin);
+    ntfs_inode_close (Ni);
+    return EFI_DEVICE_ERROR;
+  }
+
+  Pin->Ni = Ni;
+  InsertTailList (&Volume->PinnedFiles, &Pin->Link);
+  IFile->Pin = Pin;
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Make sure the inode of the open file instance is resolved and pinned.
+
+  @param  IFile                 - The open file instance.
+
+  @retval EFI_SUCCESS           - IFile->Pin->Ni and IFile->Pin->DataAttr are valid.
+  @retval EFI_NOT_FOUND         - The file does not exist anymore.
+  @retval EFI_OUT_OF_RESOURCES  - Can not allocate the memory.
+  @retval EFI_DEVICE_ERROR      - The $DATA attribute can not be opened.
+
+**/
+EFI_STATUS
+NtfsIFileOpenInode (
+  IN NTFS_IFILE  *IFile
+  )
+{
+  ntfs_inode  *ni;
+
+  ASSERT (!IFile->IsDir);
+
+  if (IFile->Pin != NULL) {
+    //
+    // The inode is gone from the pin once another instance deleted the file
+    //
+    return (IFile->Pin->Ni != NULL) ? EFI_SUCCESS : EFI_NOT_FOUND;
+  }
+
+  ni = NtfsIFileLoadInode (IFile);
+  if (ni == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  return NtfsIFilePinInode (IFile, ni);
+}
+
+/**
+
+  Open the inode of an open file instance by its MFT reference. The
+  caller closes it, regular files use NtfsIFileOpenInode() instead.
+
+  @param  IFile                 - The open file instance.
+
+  @return The inode, or NULL if the MFT record does not hold the file anymore.
+
+**/
+ntfs_inode *
+NtfsIFileLoadInode (
+  IN NTFS_IFILE  *IFile
+  )
+{
+  ntfs_inode  *ni;
+
+  NtfsSyncPinnedInode (IFile->Volume, MREF (IFile->MRef));
+  ni = ntfs_inode_open (IFile->Volume->VolInfo, MREF (IFile->MRef));
+  if (ni != NULL &&
+      MSEQNO (IFile->MRef) != 0 &&
+      MSEQNO (IFile->MRef) != le16_to_cpu (ni->mrec->sequence_number)) {
+    //
+    // The file was deleted and its record reused
+    //
+    ntfs_inode_close (ni);
+    ni = NULL;
+  }
+
+  return ni;
+}
+
+/**
+
+  Drop the reference of the open file instance on its pinned inode. The
+  last one writes back and closes the inode, together with the data
+  buffered for it. Clusters preallocated past the end of data are freed.
+
+  @param  IFile                 - The open file instance.
+
+**/
+VOID
+NtfsIFileReleaseInode (
+  IN NTFS_IFILE  *IFile
+  )
+{
+  NTFS_PINNED_INODE  *Pin;
+
+  Pin = IFile->Pin;
+  if (Pin == NULL) {
+    return;
+  }
+
+  if (Pin->RefCount > 1) {
+    Pin->RefCount--;
+    IFile->Pin = NULL;
+    return;
+  }
+
+  if (Pin->Ni != NULL) {
+    NtfsIFileFlushWriteBehind (IFile, TRUE);
+
+    RemoveEntryList (&Pin->Link);
+
+    ntfs_attr_close (Pin->DataAttr);
+#if CACHE_NIDATA_SIZE
+    //
+    // Drop any stale copy a lookup may have left in the cache meanwhile
+    //
+    ntfs_inode_invalidate (IFile->Volume->VolInfo, Pin->Ni->mft_no);
+#endif
+    ntfs_inode_close (Pin->Ni);
+  }
+
+  IFile->Pin = NULL;
+  if (Pin->WriteBehind != NULL) {
+    FreePool (Pin->WriteBehind);
+  }
+  FreePool (Pin);
+}
+
+/**
+
+  Take the inode out of the pin of the open file instance, for the caller
+  to consume it. The other instances holding the pin see the file as gone,
+  the data buffered for it and its preallocated clusters go with the inode.
+
+  @param  IFile                 - The open file instance, its inode is pinned.
+
+  @return The inode.
+
+**/
+ntfs_inode *
+NtfsIFileDetachInode (
+  IN NTFS_IFILE  *IFile
+  )
+{
+  NTFS_PINNED_INODE  *Pin;
+  ntfs_inode         *Ni;
+
+  Pin = IFile->Pin;
+  Ni  = Pin->Ni;
+
+  RemoveEntryList (&Pin->Link);
+  ntfs_attr_close (Pin->DataAttr);
+  Pin->Ni           = NULL;
+  Pin->DataAttr     = NULL;
+  Pin->Preallocated = FALSE;
+  if (Pin->WriteBehind != NULL) {
+    Pin->WriteBehind->Length = 0;
+  }
+
+  NtfsIFileReleaseInode (IFile);
+  return Ni;
+}
+
 /**
- * create_pathname - Create a path/file from some components
- * @dir:      Directory in which to create the file (optional)
- * @name:     Filename to give the file (optional)
- * @stream:   Name of the stream (optional)
- * @buffer:   Store the result here
- * @bufsize:  Size of buffer
- *
- * Create a filename from various pieces.  The output will be of the form:
- *	dir/file
- *	dir/file:stream
- *	file
- *	file:stream
- *
- * All the components are optional.  If the name is missing, "unknown" will be
- * used.  If the directory is missing the file will be created in the current
- * directory.  If the stream name is present it will be appended to the
- * filename, delimited by a colon.
- *
- * N.B. If the buffer isn't large enough the name will be truncated.
- *
- * Return:  n  Length of the allocated name
- */
-static int create_pathname(const char *dir, const char *name,
-	char *buffer, int bufsize)
+
+  Get the parent directory and the long name of an inode from its
+  $FILE_NAME attributes, the DOS name is skipped. The root directory is
+  its own parent and has an empty name.
+
+  @param  Ni                    - The inode.
+  @param  ParentMRef            - The MFT reference of the parent directory.
+  @param  Name                  - The name of the inode, allocated from pool.
+
+  @retval EFI_SUCCESS           - The parent and the name are returned.
+  @retval EFI_OUT_OF_RESOURCES  - Can not allocate the memory.
+  @retval EFI_DEVICE_ERROR      - The inode has no $FILE_NAME attribute.
+
+**/
+STATIC
+EFI_STATUS
+NtfsInodeGetLink (
+  IN  ntfs_inode  *Ni,
+  OUT MFT_REF     *ParentMRef,
+  OUT CHAR16      **Name
+  )
 {
-	if (dir)
-		snprintf(buffer, bufsize, "%s%c%s", dir, PATH_SEP, name);
-	else
-		snprintf(buffer, bufsize, "%s", name);
+  ntfs_attr_search_ctx  *ctx;
+  FILE_NAME_ATTR        *fn;
+  EFI_STATUS            Status;
 
-	return strlen(buffer);
+  if (Ni->mft_no == FILE_root) {
+    *ParentMRef = NTFS_INODE_MREF (Ni);
+    *Name       = AllocateZeroPool (sizeof (CHAR16));
+    return (*Name == NULL) ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+  }
+
+  ctx = ntfs_attr_get_search_ctx (Ni, NULL);
+  if (ctx == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = EFI_DEVICE_ERROR;
+  while (!ntfs_attr_lookup (AT_FILE_NAME, AT_UNNAMED, 0, CASE_SENSITIVE, 0, NULL, 0, ctx)) {
+    fn = (FILE_NAME_ATTR *) ((u8 *) ctx->attr + le16_to_cpu (ctx->attr->value_offset));
+    if (fn->file_name_type == FILE_NAME_DOS) {
+      continue;
+    }
+
+    *ParentMRef = le64_to_cpu (fn->parent_directory);
+    *Name       = AllocateZeroPool ((fn->file_name_length + 1) * sizeof (CHAR16));
+    Status      = EFI_OUT_OF_RESOURCES;
+    if (*Name != NULL) {
+      CopyMem (*Name, fn->file_name, fn->file_name_length * sizeof (CHAR16));
+      Status = EFI_SUCCESS;
+    }
+    break;
+  }
+
+  ntfs_attr_put_search_ctx (ctx);
+  return Status;
 }
 
 /**
@@ -128,84 +416,155 @@ NtfsOFileOpen (
   NTFS_VOLUME  *Volume;
   BOOLEAN      WriteMode;
   ntfs_inode   *ni;
-  ntfs_inode   *cur_ni;
-  CHAR8        *AsciiFileName;
-  CHAR8        AsciiPath[PATH_MAX];
-  CHAR16       *uname;
-  mode_t       type = 0;
+  ntfs_inode   *dir_ni;
+  ntfs_inode   *start_ni;
   CHAR16       *NewFileName;
+  CHAR16       *DirName;
+  CHAR16       *Name;
+  CHAR16       *LinkName;
+  MFT_REF      ParentMRef;
+  UINTN        Length;
+  u64          inum;
+  mode_t       type = 0;
 
   Volume = IFile->Volume;
   
   ASSERT_VOLUME_LOCKED (Volume);
-  
-  Print(L"NtfsOFileOpen0 %s 0x%x 0x%llx\n", FileName, Attributes, OpenMode);
+
   WriteMode = (BOOLEAN) (OpenMode & EFI_FILE_MODE_WRITE);
   if (Volume->ReadOnly && WriteMode) {
     return EFI_WRITE_PROTECTED;
   }
 
   NewFileName = (CHAR16 *) AllocateZeroPool (StrSize(FileName));
+  if (NewFileName == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
   if (!NtfsFileNameIsValid (FileName, NewFileName)) {
+    FreePool (NewFileName);
     return EFI_INVALID_PARAMETER;
   }
 
-  if (StrCmp(NewFileName, L".") == 0) {
-	ni = ntfs_pathname_to_inode(Volume->VolInfo, NULL, IFile->Path);
-	AsciiStrCpy(AsciiPath, IFile->Path);
+  //
+  // Absolute names start from the root, the others from the directory
+  // of the handle
+  //
+  DirName = NewFileName;
+  if (*DirName == L'\\') {
+    while (*DirName == L'\\') {
+      DirName++;
+    }
+    start_ni = ntfs_inode_open (Volume->VolInfo, FILE_root);
+  } else if (IFile->IsDir) {
+    start_ni = NtfsIFileLoadInode (IFile);
+  } else {
+    start_ni = NULL;
   }
-  else if (StrCmp(NewFileName, L"..") == 0) {
-    cur_ni = ntfs_pathname_to_inode(Volume->VolInfo, NULL, IFile->Path);
-    ni = ntfs_dir_parent_inode(cur_ni);
-    ntfs_inode_close(cur_ni);
-	utils_inode_get_name(ni, AsciiPath, PATH_MAX);
+
+  Length = StrLen (DirName);
+  while (Length > 0 && DirName[Length - 1] == L'\\') {
+    DirName[--Length] = L'\0';
   }
-  else {
-    AsciiFileName = (CHAR8 *) AllocateZeroPool (StrLen(NewFileName) + 2);
-    Unicode2Ascii(AsciiFileName, NewFileName);
-  
-    create_pathname(IFile->Path, AsciiFileName, AsciiPath, PATH_MAX);
-	FreePool(AsciiFileName);
-  
-    ni = ntfs_pathname_to_inode(Volume->VolInfo, NULL, AsciiPath);
-    if (!ni) {
-      if ((OpenMode & EFI_FILE_MODE_CREATE) == 0) {
-	  	FreePool(NewFileName);
-	    return EFI_NOT_FOUND;
-      }
-	
-	  uname = (ntfschar *)GetFileNameFromPathW(NewFileName);
-	
-      if ((Attributes & EFI_FILE_DIRECTORY) != 0) {
-        type |= S_IFDIR;
-      }
 
-      if ((Attributes & EFI_FILE_SYSTEM) == 0 && (Attributes & EFI_FILE_DIRECTORY) == 0) {
-        type |= S_IFREG;
-      }
+  //
+  // Split the last component off, the directories leading to it are
+  // looked up from the starting directory
+  //
+  Name = GetFileNameFromPathW (DirName);
+  if (Name != DirName) {
+    Name[-1] = L'\0';
+  } else {
+    DirName = L"";
+  }
 
-	  if ((Attributes & EFI_FILE_READ_ONLY) != 0) {
-        type |= S_IREADONLY;
-      }
+  dir_ni = start_ni;
+  if (start_ni != NULL && *DirName != L'\0') {
+    dir_ni = ntfs_ucs_pathname_to_inode (Volume->VolInfo, start_ni, (ntfschar *) DirName, (int) StrLen (DirName));
+    if (dir_ni != start_ni) {
+      ntfs_inode_close (start_ni);
+    }
+  }
+
+  if (dir_ni == NULL) {
+    FreePool (NewFileName);
+    return EFI_NOT_FOUND;
+  }
 
-	  if ((Attributes & EFI_FILE_HIDDEN) != 0) {
-        type |= S_IHIDDEN;
+  //
+  // Find the inode of the last component, its parent and its name
+  //
+  ni       = NULL;
+  LinkName = NULL;
+  Status   = EFI_SUCCESS;
+  if (*Name == L'\0' || StrCmp (Name, L".") == 0) {
+    ni     = dir_ni;
+    dir_ni = NULL;
+    Status = NtfsInodeGetLink (ni, &ParentMRef, &LinkName);
+  } else if (StrCmp (Name, L"..") == 0) {
+    Status = NtfsInodeGetLink (dir_ni, &ParentMRef, &LinkName);
+    if (!EFI_ERROR (Status)) {
+      FreePool (LinkName);
+      LinkName = NULL;
+      if (dir_ni->mft_no == FILE_root) {
+        ni     = dir_ni;
+        dir_ni = NULL;
+      } else {
+        ni = ntfs_inode_open (Volume->VolInfo, MREF (ParentMRef));
+      }
+      Status = EFI_DEVICE_ERROR;
+      if (ni != NULL) {
+        Status = NtfsInodeGetLink (ni, &ParentMRef, &LinkName);
+      }
+    }
+  } else {
+    ParentMRef = NTFS_INODE_MREF (dir_ni);
+    LinkName   = AllocateCopyPool (StrSize (Name), Name);
+    if (LinkName == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    } else {
+      inum = ntfs_inode_lookup_by_ucsname (dir_ni, (ntfschar *) Name, (int) StrLen (Name));
+      if (inum != (u64) -1) {
+        NtfsSyncPinnedInode (Volume, MREF (inum));
+        ni = ntfs_inode_open (Volume->VolInfo, MREF (inum));
+      } else if ((OpenMode & EFI_FILE_MODE_CREATE) == 0) {
+        Status = EFI_NOT_FOUND;
+      } else {
+        if ((Attributes & EFI_FILE_DIRECTORY) != 0) {
+          type |= S_IFDIR;
+        }
+
+        if ((Attributes & EFI_FILE_SYSTEM) == 0 && (Attributes & EFI_FILE_DIRECTORY) == 0) {
+          type |= S_IFREG;
+        }
+
+        if ((Attributes & EFI_FILE_READ_ONLY) != 0) {
+          type |= S_IREADONLY;
+        }
+
+        if ((Attributes & EFI_FILE_HIDDEN) != 0) {
+          type |= S_IHIDDEN;
+        }
+
+        ni = ntfs_create (dir_ni, const_cpu_to_le32(0), (ntfschar *) Name, (u8) StrLen (Name), type);
       }
-	  
-	  cur_ni = ntfs_pathname_to_inode(Volume->VolInfo, NULL, IFile->Path);
-      ni = ntfs_create(cur_ni, const_cpu_to_le32(0), uname, StrLen(uname), type);
-	  ntfs_inode_close(cur_ni);
     }
   }
-  FreePool(NewFileName);
-  
-  if (!ni) {
-	return EFI_DEVICE_ERROR;
+
+  if (dir_ni != NULL) {
+    ntfs_inode_close (dir_ni);
+  }
+  FreePool (NewFileName);
+
+  if (!EFI_ERROR (Status) && ni == NULL) {
+    Status = EFI_DEVICE_ERROR;
+  }
+  if (EFI_ERROR (Status)) {
+    goto Error;
   }
 
   if ((ni->flags & EFI_FILE_READ_ONLY) != 0 && (ni->flags & FILE_ATTR_DIRECTORY) == 0 && WriteMode) {
-  	ntfs_inode_close(ni);
-	return EFI_ACCESS_DENIED;
+    Status = EFI_ACCESS_DENIED;
+    goto Error;
   }
 
   //
@@ -213,27 +572,45 @@ NtfsOFileOpen (
   //
   Status = NtfsAllocateIFile (Volume, NewIFile);
   if (EFI_ERROR (Status)) {
-  	ntfs_inode_close(ni);
-    return Status;
+    goto Error;
+  }
+  (*NewIFile)->IsDir      = IsDir(ni);
+  (*NewIFile)->IsRoot     = (BOOLEAN) (ni->mft_no == FILE_root);
+  (*NewIFile)->ReadOnly   = (BOOLEAN)!WriteMode;
+  (*NewIFile)->MRef       = NTFS_INODE_MREF (ni);
+  (*NewIFile)->ParentMRef = ParentMRef;
+  (*NewIFile)->Name       = LinkName;
+
+  if ((*NewIFile)->IsDir) {
+    ntfs_inode_close(ni);
+  } else {
+    //
+    // Keep the inode for the handle, Read/Write use it directly
+    //
+    Status = NtfsIFilePinInode (*NewIFile, ni);
+    if (EFI_ERROR (Status)) {
+      FreePool (LinkName);
+      FreePool (*NewIFile);
+      return Status;
+    }
   }
-  (*NewIFile)->IsDir = IsDir(ni);
-  (*NewIFile)->ReadOnly = (BOOLEAN)!WriteMode;
-  AsciiStrCpy((*NewIFile)->Path, AsciiPath);
-
-  ntfs_inode_close(ni);
 
   (*NewIFile)->FileInfoSize = 0;
-  Status = NtfsGetDirEntInfo(Volume, *NewIFile, &(*NewIFile)->FileInfoSize, NULL, TRUE);
+  Status = NtfsGetDirEntInfo(Volume, *NewIFile, &(*NewIFile)->FileInfoSize, NULL);
   if (Status == EFI_BUFFER_TOO_SMALL) {
   	(*NewIFile)->FileInfo = AllocateZeroPool((*NewIFile)->FileInfoSize);
 	if ((*NewIFile)->FileInfo == NULL) {
+      NtfsIFileReleaseInode (*NewIFile);
+      FreePool (LinkName);
       FreePool (*NewIFile);
 	  return EFI_OUT_OF_RESOURCES;
 	}
 
-	Status = NtfsGetDirEntInfo(Volume, *NewIFile, &(*NewIFile)->FileInfoSize, (*NewIFile)->FileInfo, TRUE);
+	Status = NtfsGetDirEntInfo(Volume, *NewIFile, &(*NewIFile)->FileInfoSize, (*NewIFile)->FileInfo);
 	if (EFI_ERROR(Status)) {
 	  FreePool((*NewIFile)->FileInfo);
+	  NtfsIFileReleaseInode (*NewIFile);
+	  FreePool (LinkName);
 	  FreePool (*NewIFile);
 	  return EFI_DEVICE_ERROR;
 	}
@@ -243,6 +620,15 @@ NtfsOFileOpen (
 
   DEBUG ((EFI_D_INFO, "FSOpen: Open '%S' %r\n", FileName, Status));
   return EFI_SUCCESS;
+
+Error:
+  if (ni != NULL) {
+    ntfs_inode_close (ni);
+  }
+  if (LinkName != NULL) {
+    FreePool (LinkName);
+  }
+  return Status;
 }
 
 /**
@@ -273,11 +659,45 @@ NtfsOpen (
   IN  UINT64              OpenMode,
   IN  UINT64              Attributes
   )
+{
+  return NtfsOpenEx (FHand, NewHandle, FileName, OpenMode, Attributes, NULL);
+}
+
+/**
+
+  Implements OpenEx() of Simple File System Protocol. The file is opened
+  synchronously, a non-blocking request is completed through its token.
+
+  @param  FHand                 - File handle of the file serves as a starting reference point.
+  @param  NewHandle             - Handle of the file that is newly opened.
+  @param  FileName              - File name relative to FHand.
+  @param  OpenMode              - Open mode.
+  @param  Attributes            - Attributes to set if the file is created.
+  @param  Token                 - A pointer to the token associated with the transaction.
+
+  @retval EFI_INVALID_PARAMETER - The FileName is NULL or the file string is empty.
+                          The OpenMode is not supported.
+                          The Attributes is not the valid attributes.
+  @retval EFI_OUT_OF_RESOURCES  - Can not allocate the memory for file string.
+  @retval EFI_SUCCESS           - Open the file successfully.
+  @return Others                - The status of open file.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsOpenEx (
+  IN  EFI_FILE_PROTOCOL       *FHand,
+  OUT EFI_FILE_PROTOCOL       **NewHandle,
+  IN  CHAR16                  *FileName,
+  IN  UINT64                  OpenMode,
+  IN  UINT64                  Attributes,
+  IN OUT EFI_FILE_IO_TOKEN    *Token
+  )
 {
   NTFS_IFILE  *IFile;
   NTFS_IFILE  *NewIFile;
   EFI_STATUS  Status;
-  Print(L"NtfsOpen+\n");
+  NTFS_TRACE_DECLARE (Trace);
 
   //
   // Perform some parameter checking
@@ -306,12 +726,12 @@ NtfsOpen (
   //}
 
   IFile = IFILE_FROM_FHAND (FHand);
-  //Print(L"NtfsOpenEx %s\n", IFile->FileInfo->FileName);
 
   //
   // Lock
   //
   NtfsAcquireLock ();
+  NTFS_TRACE_BEGIN (Trace, IFile->Volume, IFile);
 
   //
   // Open the file
@@ -323,13 +743,15 @@ NtfsOpen (
   //
   if (!EFI_ERROR (Status)) {
     *NewHandle = &NewIFile->Handle;
+    NTFS_TRACE_FILE (Trace, NewIFile);
   }
+  NTFS_TRACE_END (Trace, IFile->Volume, NtfsTraceOpen, 0);
   //
   // Unlock
   //
   NtfsCleanupVolume (IFile->Volume);
   NtfsReleaseLock ();
 
-  return Status;
+  return NtfsCompleteToken (Token, Status);
 }
 
@@ -16,6 +16,23 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #define DEVICE_NAME "Ntfs%d"
 
+/* Size the library caches of the volume from the platform PCDs */
+static void NtfsCreateCaches(ntfs_volume *vol)
+{
+	int sizes[LRU_COUNT];
+
+	ntfs_lru_cache_sizes(vol, PcdGet32(PcdNtfsCacheBudget), sizes);
+	if (PcdGet32(PcdNtfsInodeCacheSize))
+		sizes[LRU_INODE] = PcdGet32(PcdNtfsInodeCacheSize);
+	if (PcdGet32(PcdNtfsNidataCacheSize))
+		sizes[LRU_NIDATA] = PcdGet32(PcdNtfsNidataCacheSize);
+	if (PcdGet32(PcdNtfsLookupCacheSize))
+		sizes[LRU_LOOKUP] = PcdGet32(PcdNtfsLookupCacheSize);
+	if (PcdGet32(PcdNtfsMftCacheSize))
+		sizes[LRU_MFT] = PcdGet32(PcdNtfsMftCacheSize);
+	ntfs_create_lru_caches_sized(vol, sizes);
+}
+
 static ntfs_volume *NtfsMount(const char *name __attribute__((unused)),
 		ntfs_mount_flags flags __attribute__((unused)), void *priv_data)
 {
@@ -33,15 +50,72 @@ static ntfs_volume *NtfsMount(const char *name __attribute__((unused)),
 		ntfs_device_free(dev);
 		errno = eo;
 	} else {
-		ntfs_create_lru_caches(vol);
+		NtfsCreateCaches(vol);
+		/* Cache the device by clusters from now on */
+		ntfs_device_uefi_cache_setup((NTFS_VOLUME*)priv_data,
+				vol->cluster_size);
 	}
 	
 	return vol;
 }
 
+/**
+
+  Mount the NTFS file system of the volume, repairing it once if the
+  first attempt fails.
+
+  @param  Volume                - The volume to mount.
+
+  @retval EFI_SUCCESS           - Volume->VolInfo holds the mounted volume.
+  @retval EFI_UNSUPPORTED       - The file system can not be mounted.
+
+**/
+STATIC
+EFI_STATUS
+NtfsMountVolume (
+  IN NTFS_VOLUME    *Volume
+  )
+{
+  CHAR8          DevName[8];
+
+  sprintf(DevName, DEVICE_NAME, Volume->MediaId);
+
+  Volume->VolInfo = NtfsMount(DevName, NTFS_MNT_FORENSIC, Volume);
+  if (Volume->VolInfo == NULL) {
+    if (fix_mount(DevName, NTFS_MNT_FORENSIC) < 0) {
+      return EFI_UNSUPPORTED;
+    }
+
+    Volume->VolInfo = NtfsMount(DevName, NTFS_MNT_FORENSIC, Volume);
+    if (Volume->VolInfo == NULL) {
+      return EFI_UNSUPPORTED;
+    }
+
+    if (check_alternate_boot(Volume->VolInfo) ||
+        ntfs_version_is_supported(Volume->VolInfo)) {
+      ntfs_umount(Volume->VolInfo, FALSE);
+      Volume->VolInfo = NULL;
+      return EFI_UNSUPPORTED;
+    }
+  }
+  NVolClearCaseSensitive(Volume->VolInfo);
+
+  //
+  // Count the free clusters and MFT records once, the allocators of
+  // libntfs-3g keep both counters up to date from now on
+  //
+  if (ntfs_volume_get_free_space(Volume->VolInfo) != 0) {
+    DEBUG ((EFI_D_ERROR, "NtfsMountVolume: can not count free space\n"));
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
 
   Implements Simple File System Protocol interface function OpenVolume().
+  The file system is mounted by the first call only, it stays mounted
+  until the volume is cleaned up.
 
   @param  This                  - Calling context.
   @param  File                  - the Root Directory of the volume.
@@ -61,52 +135,67 @@ NtfsOpenVolume (
   EFI_STATUS     Status;
   NTFS_VOLUME    *Volume;
   NTFS_IFILE     *IFile;
-  CHAR8          DevName[8];
+  NTFS_TRACE_DECLARE (Trace);
 
   Volume = VOLUME_FROM_VOL_INTERFACE (This);
   NtfsAcquireLock ();
+  NTFS_TRACE_BEGIN (Trace, Volume, NULL);
 
-  sprintf(DevName, DEVICE_NAME, Volume->MediaId);
-  
-  Print(L"NtfsOpenVolume+\n");
-
-  Volume->VolInfo = NtfsMount(DevName, NTFS_MNT_FORENSIC, Volume);
   if (Volume->VolInfo == NULL) {
-    if (fix_mount(DevName, NTFS_MNT_FORENSIC) < 0) {
-      Status = EFI_UNSUPPORTED;
-	  goto Done;
-    }
-	
-	Volume->VolInfo = NtfsMount(DevName, NTFS_MNT_FORENSIC, Volume);
-    if (Volume->VolInfo == NULL) {
-      Status = EFI_UNSUPPORTED;
-	  goto Done;
-    }
-	
-	if (check_alternate_boot(Volume->VolInfo)) {
-      Status = EFI_UNSUPPORTED;
-	  goto Done;
-	}
-
-	if (ntfs_version_is_supported(Volume->VolInfo)) {
-      Status = EFI_UNSUPPORTED;
+    Status = NtfsMountVolume (Volume);
+    if (EFI_ERROR (Status)) {
       goto Done;
-	}
+    }
   }
-  NVolClearCaseSensitive(Volume->VolInfo);
 
   //
   // Open a new instance to the root
   //
   Status = NtfsAllocateIFile (Volume, &IFile);
-  if (!EFI_ERROR (Status)) {
-	IFile->IsRoot = TRUE;
-    IFile->IsDir = TRUE;
-    AsciiStrCpy(IFile->Path, "\\");
-    *File = &IFile->Handle;
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  IFile->IsRoot     = TRUE;
+  IFile->IsDir      = TRUE;
+  IFile->MRef       = MK_MREF (FILE_root, 0);
+  IFile->ParentMRef = IFile->MRef;
+  IFile->Name       = AllocateZeroPool (sizeof (CHAR16));
+
+  IFile->FileInfoSize = 0;
+  Status = EFI_OUT_OF_RESOURCES;
+  if (IFile->Name != NULL) {
+    Status = NtfsGetDirEntInfo (Volume, IFile, &IFile->FileInfoSize, NULL);
+  }
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    IFile->FileInfo = AllocateZeroPool (IFile->FileInfoSize);
+    Status = EFI_OUT_OF_RESOURCES;
+    if (IFile->FileInfo != NULL) {
+      Status = NtfsGetDirEntInfo (Volume, IFile, &IFile->FileInfoSize, IFile->FileInfo);
+    }
   }
 
+  if (EFI_ERROR (Status)) {
+    if (IFile->FileInfo != NULL) {
+      FreePool (IFile->FileInfo);
+    }
+    if (IFile->Name != NULL) {
+      FreePool (IFile->Name);
+    }
+    FreePool (IFile);
+    goto Done;
+  }
+
+  //
+  // The root handle holds a reference on the mounted volume like any
+  // other open file, NtfsClose() drops it
+  //
+  Volume->RefCount++;
+  *File = &IFile->Handle;
+  NTFS_TRACE_FILE (Trace, IFile);
+
 Done:
+  NTFS_TRACE_END (Trace, Volume, NtfsTraceOpenVolume, 0);
 
   NtfsCleanupVolume (Volume);
   NtfsReleaseLock ();
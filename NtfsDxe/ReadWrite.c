@@ -36,7 +36,6 @@ NtfsGetPosition (
   )
 {
   NTFS_IFILE *IFile;
-  Print(L"NtfsGetPosition+\n");
 
   IFile = IFILE_FROM_FHAND (FHand);
 
@@ -68,7 +67,6 @@ NtfsSetPosition (
   )
 {
   NTFS_IFILE *IFile;
-  Print(L"NtfsSetPosition+\n");
 
   IFile = IFILE_FROM_FHAND (FHand);
 
@@ -82,6 +80,8 @@ NtfsSetPosition (
       //
       return EFI_UNSUPPORTED;
     }
+
+    IFile->DirPos = 0;
   }
 
   //
@@ -97,6 +97,940 @@ NtfsSetPosition (
   return EFI_SUCCESS;
 }
 
+/**
+
+  Check whether the read of a read-ahead window has completed. It is not
+  waited for, as the volume lock is held: a read still in flight is read
+  again synchronously by the caller. The completion is recorded by the
+  notification of the window's event.
+
+  @param  Window                - The pending read-ahead window.
+
+  @retval EFI_SUCCESS           - The window holds valid data.
+  @retval EFI_NOT_READY         - The read is still in flight.
+  @return Others                - The read failed, the window is emptied.
+
+**/
+STATIC
+EFI_STATUS
+NtfsReadAheadPoll (
+  IN NTFS_READ_AHEAD_WINDOW  *Window
+  )
+{
+  EFI_STATUS  Status;
+  BOOLEAN     Done;
+
+  ASSERT (Window->Pending);
+
+  EfiAcquireLock (&NtfsTaskLock);
+  Done = Window->Done;
+  EfiReleaseLock (&NtfsTaskLock);
+  if (!Done) {
+    return EFI_NOT_READY;
+  }
+
+  Window->Pending = FALSE;
+  Status = Window->Token.TransactionStatus;
+  if (EFI_ERROR (Status)) {
+    Window->Length = 0;
+  }
+  return Status;
+}
+
+/**
+
+  Free the read-ahead windows of a handle, no read of theirs is in flight.
+
+  @param  ReadAhead             - The read-ahead windows.
+
+**/
+STATIC
+VOID
+NtfsReadAheadDestroy (
+  IN NTFS_READ_AHEAD  *ReadAhead
+  )
+{
+  NTFS_READ_AHEAD_WINDOW  *Window;
+  UINTN                   Index;
+
+  for (Index = 0; Index < NTFS_READ_AHEAD_WINDOWS; Index++) {
+    Window = &ReadAhead->Window[Index];
+    if (Window->Token.Event != NULL) {
+      gBS->CloseEvent (Window->Token.Event);
+    }
+    if (Window->Buffer != NULL) {
+      FreePool (Window->Buffer);
+    }
+  }
+
+  FreePool (ReadAhead);
+}
+
+/**
+
+  Notification of the completion of a read-ahead window. The last one of
+  a handle already closed frees the windows.
+
+  @param  Event                 - The event of the window.
+  @param  Context               - The window.
+
+**/
+STATIC
+VOID
+EFIAPI
+NtfsOnReadAheadComplete (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  NTFS_READ_AHEAD_WINDOW  *Window;
+  NTFS_READ_AHEAD         *ReadAhead;
+  BOOLEAN                 Last;
+
+  Window    = (NTFS_READ_AHEAD_WINDOW *) Context;
+  ReadAhead = Window->ReadAhead;
+
+  EfiAcquireLock (&NtfsTaskLock);
+  Window->Done = TRUE;
+  Last = (BOOLEAN) (--ReadAhead->InFlight == 0 && ReadAhead->Orphaned);
+  EfiReleaseLock (&NtfsTaskLock);
+
+  if (Last) {
+    NtfsReadAheadDestroy (ReadAhead);
+  }
+}
+
+/**
+
+  Start the asynchronous read of a read-ahead window at a file offset.
+  The window covers the clusters contiguous on disk from that offset, so
+  that one ReadDiskEx() request fills it. Nothing is read in holes and
+  past the initialized size. The dirty blocks of the block cache in the
+  window are written first, later writes drop the window.
+
+  @param  IFile                 - The open file instance, its inode is pinned.
+  @param  Window                - The window to fill, not pending.
+  @param  Pos                   - File offset of the window.
+
+  @retval TRUE                  - The read is in flight.
+  @retval FALSE                 - Nothing to read ahead from Pos.
+
+**/
+STATIC
+BOOLEAN
+NtfsReadAheadIssue (
+  IN NTFS_IFILE              *IFile,
+  IN NTFS_READ_AHEAD_WINDOW  *Window,
+  IN s64                     Pos
+  )
+{
+  NTFS_VOLUME      *Volume;
+  ntfs_attr        *na;
+  runlist_element  *rl;
+  u8               Bits;
+  s64              Length;
+  EFI_STATUS       Status;
+
+  Volume = IFile->Volume;
+  na     = IFile->Pin->DataAttr;
+  Bits   = Volume->VolInfo->cluster_size_bits;
+
+  ASSERT (!Window->Pending);
+
+  Window->Length = 0;
+  if (Pos >= na->initialized_size) {
+    return FALSE;
+  }
+
+  rl = ntfs_attr_find_vcn (na, Pos >> Bits);
+  if (rl == NULL || rl->lcn < 0) {
+    return FALSE;
+  }
+
+  Length = ((rl->vcn + rl->length) << Bits) - Pos;
+  Length = MIN (Length, NTFS_READ_AHEAD_SIZE);
+  Length = MIN (Length, na->initialized_size - Pos);
+
+  if (Window->Buffer == NULL) {
+    Window->Buffer = AllocatePool (NTFS_READ_AHEAD_SIZE);
+    if (Window->Buffer == NULL) {
+      return FALSE;
+    }
+  }
+  if (Window->Token.Event == NULL) {
+    Window->ReadAhead = IFile->ReadAhead;
+    Status = gBS->CreateEvent (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_NOTIFY,
+                    NtfsOnReadAheadComplete,
+                    Window,
+                    &Window->Token.Event
+                    );
+    if (EFI_ERROR (Status)) {
+      Window->Token.Event = NULL;
+      return FALSE;
+    }
+  }
+
+  Window->Start      = Pos;
+  Window->DiskOffset = (rl->lcn << Bits) + (Pos - (rl->vcn << Bits));
+  Window->Generation = Volume->WriteGeneration;
+
+  if (ntfs_device_uefi_cache_writeback (Volume, Window->DiskOffset, Length) != 0) {
+    return FALSE;
+  }
+
+  EfiAcquireLock (&NtfsTaskLock);
+  Window->Done = FALSE;
+  Window->ReadAhead->InFlight++;
+  EfiReleaseLock (&NtfsTaskLock);
+
+  Status = Volume->DiskIo2->ReadDiskEx (
+                              Volume->DiskIo2,
+                              Volume->MediaId,
+                              Window->DiskOffset,
+                              &Window->Token,
+                              (UINTN) Length,
+                              Window->Buffer
+                              );
+  if (EFI_ERROR (Status)) {
+    EfiAcquireLock (&NtfsTaskLock);
+    Window->ReadAhead->InFlight--;
+    EfiReleaseLock (&NtfsTaskLock);
+    return FALSE;
+  }
+  Volume->Counters.DeviceReads++;
+  Volume->Counters.DeviceBytesRead += Length;
+
+  Window->Length  = (UINTN) Length;
+  Window->Pending = TRUE;
+  return TRUE;
+}
+
+/**
+
+  Copy into Buffer what the read-ahead windows hold from Offset on.
+
+  @param  IFile                 - The open file instance, its inode is pinned.
+  @param  Offset                - File offset of the data.
+  @param  Size                  - Size of the data.
+  @param  Buffer                - Buffer receiving the data.
+
+  @return The number of bytes copied from Offset on.
+
+**/
+STATIC
+s64
+NtfsReadAheadCopy (
+  IN  NTFS_IFILE   *IFile,
+  IN  s64          Offset,
+  IN  s64          Size,
+  OUT UINT8        *Buffer
+  )
+{
+  NTFS_READ_AHEAD_WINDOW  *Window;
+  UINTN                   Index;
+  s64                     Total;
+  s64                     Count;
+
+  Total = 0;
+  Index = 0;
+  while (Size > 0 && Index < NTFS_READ_AHEAD_WINDOWS) {
+    Window = &IFile->ReadAhead->Window[Index++];
+    if (Window->Length == 0 ||
+        Offset < Window->Start || Offset >= Window->Start + (s64) Window->Length) {
+      continue;
+    }
+
+    if (Window->Pending && NtfsReadAheadPoll (Window) != EFI_SUCCESS) {
+      break;
+    }
+
+    if (Window->Generation != IFile->Volume->WriteGeneration) {
+      Window->Length = 0;
+      break;
+    }
+
+    Count = MIN (Size, Window->Start + (s64) Window->Length - Offset);
+    CopyMem (Buffer + Total, Window->Buffer + (Offset - Window->Start), (UINTN) Count);
+    Offset += Count;
+    Size   -= Count;
+    Total  += Count;
+
+    //
+    // The data may continue in the other window
+    //
+    Index = 0;
+  }
+
+  return Total;
+}
+
+/**
+
+  Keep the read-ahead windows ahead of a handle reading sequentially: each
+  window holding nothing beyond the next read position is restarted right
+  after the data still ahead.
+
+  @param  IFile                 - The open file instance, its inode is pinned.
+
+**/
+STATIC
+VOID
+NtfsReadAheadAdvance (
+  IN NTFS_IFILE   *IFile
+  )
+{
+  NTFS_READ_AHEAD_WINDOW  *Window;
+  NTFS_READ_AHEAD         *ReadAhead;
+  UINTN                   Index;
+  s64                     Ahead;
+
+  ReadAhead = IFile->ReadAhead;
+  Ahead     = ReadAhead->NextPos;
+  for (Index = 0; Index < NTFS_READ_AHEAD_WINDOWS; Index++) {
+    Window = &ReadAhead->Window[Index];
+    if (Window->Length != 0 && Window->Start + (s64) Window->Length > Ahead &&
+        Window->Generation == IFile->Volume->WriteGeneration) {
+      Ahead = Window->Start + Window->Length;
+    }
+  }
+
+  for (Index = 0; Index < NTFS_READ_AHEAD_WINDOWS; Index++) {
+    Window = &ReadAhead->Window[Index];
+    if (Window->Length != 0 && Window->Start + (s64) Window->Length > ReadAhead->NextPos &&
+        Window->Generation == IFile->Volume->WriteGeneration) {
+      continue;
+    }
+    if (Window->Pending && NtfsReadAheadPoll (Window) == EFI_NOT_READY) {
+      continue;
+    }
+    if (!NtfsReadAheadIssue (IFile, Window, Ahead)) {
+      break;
+    }
+    Ahead = Window->Start + Window->Length;
+  }
+}
+
+/**
+
+  Release the read-ahead windows of an open file instance. The device
+  fills the buffers until the reads in flight are signaled, the windows
+  are then left to the last notification. They are not waited for, the
+  volume lock is held, nor cancelled, Cancel() would abort the requests
+  of every other handle of the disk.
+
+  @param  IFile                 - The open file instance.
+
+**/
+VOID
+NtfsIFileFreeReadAhead (
+  IN NTFS_IFILE          *IFile
+  )
+{
+  NTFS_READ_AHEAD  *ReadAhead;
+  BOOLEAN          Orphaned;
+
+  ReadAhead = IFile->ReadAhead;
+  if (ReadAhead == NULL) {
+    return;
+  }
+  IFile->ReadAhead = NULL;
+
+  EfiAcquireLock (&NtfsTaskLock);
+  Orphaned = (BOOLEAN) (ReadAhead->InFlight != 0);
+  ReadAhead->Orphaned = Orphaned;
+  EfiReleaseLock (&NtfsTaskLock);
+
+  if (!Orphaned) {
+    NtfsReadAheadDestroy (ReadAhead);
+  }
+}
+
+/**
+
+  Read file data at the current position through the pinned $DATA attribute.
+
+  @param  IFile                 - The open file instance, its inode is pinned.
+  @param  BufferSize            - On input the size of Buffer, on output the
+                                  number of bytes read.
+  @param  Buffer                - Buffer receiving the data.
+
+  @retval EFI_SUCCESS           - The data is read.
+  @retval EFI_DEVICE_ERROR      - An error occurred when reading the disk.
+
+**/
+STATIC
+EFI_STATUS
+NtfsIFileReadData (
+  IN     NTFS_IFILE  *IFile,
+  IN OUT UINTN       *BufferSize,
+     OUT VOID        *Buffer
+  )
+{
+  ntfs_attr  *na;
+  s64        Offset;
+  s64        Size;
+  s64        Total;
+  s64        res;
+  BOOLEAN    Sequential;
+
+  na     = IFile->Pin->DataAttr;
+  Offset = IFile->Position;
+  Size   = *BufferSize;
+  Total  = 0;
+
+  if (Offset >= na->data_size) {
+    *BufferSize = 0;
+    return EFI_SUCCESS;
+  }
+  if (Offset + Size > na->data_size) {
+    Size = na->data_size - Offset;
+  }
+
+  //
+  // Plain non resident data can be read ahead when the device has DiskIo2
+  //
+  if (IFile->ReadAhead == NULL && IFile->Volume->DiskIo2 != NULL &&
+      NAttrNonResident (na) && !NAttrCompressed (na) && !NAttrEncrypted (na)) {
+    IFile->ReadAhead = AllocateZeroPool (sizeof (NTFS_READ_AHEAD));
+  }
+
+  Sequential = FALSE;
+  if (IFile->ReadAhead != NULL) {
+    Sequential = (BOOLEAN) (Offset == IFile->ReadAhead->NextPos);
+    res = NtfsReadAheadCopy (IFile, Offset, Size, (UINT8 *) Buffer);
+    Size   -= res;
+    Offset += res;
+    Total  += res;
+  }
+
+  while (Size > 0) {
+    if (Size >= NTFS_BULK_READ_SIZE) {
+      res = ntfs_attr_bulk_read (na, Offset, Size, (CHAR8 *) Buffer + Total);
+    } else {
+      res = ntfs_attr_pread (na, Offset, Size, (CHAR8 *) Buffer + Total);
+    }
+    if (res <= 0) {
+      return EFI_DEVICE_ERROR;
+    }
+    Size   -= res;
+    Offset += res;
+    Total  += res;
+  }
+
+  if (IFile->ReadAhead != NULL) {
+    IFile->ReadAhead->NextPos = Offset;
+    if (Sequential) {
+      NtfsReadAheadAdvance (IFile);
+    }
+  }
+
+  *BufferSize = (UINTN) Total;
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Preallocate clusters ahead of a write reaching past the allocation, as
+  many as the file already holds within NTFS_WRITE_BEHIND_SIZE and
+  NTFS_PREALLOCATE_MAX, so that a file growing by small steps gets its
+  clusters and rewrites its mapping pairs a logarithmic number of times.
+  Nothing is preallocated when the volume is short of free clusters.
+
+  @param  IFile                 - The open file instance, its inode is pinned.
+  @param  End                   - File offset of the end of the write.
+
+**/
+STATIC
+VOID
+NtfsIFilePreallocate (
+  IN NTFS_IFILE  *IFile,
+  IN s64         End
+  )
+{
+  ntfs_volume  *Vol;
+  ntfs_attr    *na;
+  s64          Ahead;
+
+  Vol = IFile->Volume->VolInfo;
+  na  = IFile->Pin->DataAttr;
+  if (!NAttrNonResident (na) || End <= na->allocated_size) {
+    return;
+  }
+
+  Ahead = MIN (MAX (End, NTFS_WRITE_BEHIND_SIZE), NTFS_PREALLOCATE_MAX);
+
+  //
+  // Leave most of the free space to the other files, none is reserved
+  // when less than a cluster would be
+  //
+  if (Vol->free_clusters <= 0) {
+    return;
+  }
+  Ahead = MIN (Ahead, (Vol->free_clusters << Vol->cluster_size_bits) >> NTFS_PREALLOCATE_FREE_SHIFT);
+  if (Ahead < Vol->cluster_size) {
+    return;
+  }
+
+  if (ntfs_attr_reserve (na, End + Ahead) == 0) {
+    IFile->Pin->Preallocated = TRUE;
+  }
+}
+
+/**
+
+  The physical size of a pinned file. Clusters preallocated past the end
+  of data are not counted, they are given back when the last handle goes.
+
+  @param  Pin                   - The pinned inode.
+
+  @return The physical size in bytes.
+
+**/
+UINT64
+NtfsPinPhysicalSize (
+  IN NTFS_PINNED_INODE  *Pin
+  )
+{
+  s64  ClusterSize;
+
+  if (!Pin->Preallocated) {
+    return Pin->Ni->allocated_size;
+  }
+
+  ClusterSize = Pin->Ni->vol->cluster_size;
+  return (Pin->DataAttr->data_size + ClusterSize - 1) & -ClusterSize;
+}
+
+/**
+
+  Hand the first bytes of the write-behind buffer to the library, the
+  remaining ones are moved to the start of the buffer.
+
+  @param  IFile                 - The open file instance, its inode is pinned.
+  @param  Count                 - The number of bytes to write.
+
+  @retval EFI_SUCCESS           - The data is written.
+  @retval EFI_DEVICE_ERROR      - An error occurred when writing the data.
+
+**/
+STATIC
+EFI_STATUS
+NtfsWriteBehindPut (
+  IN NTFS_IFILE  *IFile,
+  IN UINTN       Count
+  )
+{
+  NTFS_WRITE_BEHIND  *WriteBehind;
+  s64                Total;
+  s64                res;
+
+  WriteBehind = IFile->Pin->WriteBehind;
+  if (Count == 0) {
+    return EFI_SUCCESS;
+  }
+
+  NtfsIFilePreallocate (IFile, WriteBehind->Start + Count);
+
+  Total = 0;
+  while (Total < (s64) Count) {
+    res = ntfs_attr_pwrite (
+            IFile->Pin->DataAttr,
+            WriteBehind->Start + Total,
+            Count - Total,
+            WriteBehind->Buffer + Total
+            );
+    if (res <= 0) {
+      return EFI_DEVICE_ERROR;
+    }
+    Total += res;
+  }
+
+  WriteBehind->Start  += Count;
+  WriteBehind->Length -= Count;
+  CopyMem (WriteBehind->Buffer, WriteBehind->Buffer + Count, WriteBehind->Length);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Write the data buffered for the inode pinned by an open file instance.
+
+  @param  IFile                 - The open file instance.
+  @param  Trim                  - Also free the clusters preallocated past
+                                  the end of data.
+
+  @retval EFI_SUCCESS           - Nothing is buffered anymore.
+  @retval EFI_DEVICE_ERROR      - An error occurred when writing the data.
+
+**/
+EFI_STATUS
+NtfsIFileFlushWriteBehind (
+  IN NTFS_IFILE  *IFile,
+  IN BOOLEAN     Trim
+  )
+{
+  NTFS_PINNED_INODE  *Pin;
+  EFI_STATUS         Status;
+
+  Pin = IFile->Pin;
+  if (Pin == NULL || Pin->Ni == NULL) {
+    return EFI_SUCCESS;
+  }
+  if ((Pin->WriteBehind == NULL || Pin->WriteBehind->Length == 0) &&
+      !(Trim && Pin->Preallocated)) {
+    return EFI_SUCCESS;
+  }
+
+  if (Pin->WriteBehind != NULL) {
+    Status = NtfsWriteBehindPut (IFile, Pin->WriteBehind->Length);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  if (Trim && Pin->Preallocated) {
+    if (ntfs_attr_release_reserve (Pin->DataAttr) != 0) {
+      return EFI_DEVICE_ERROR;
+    }
+    Pin->Preallocated = FALSE;
+  }
+
+  //
+  // Sizes and mapping pairs live in the MFT record, write it back now
+  //
+  if (ntfs_inode_sync (Pin->Ni) != 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  IFile->FileInfo->PhysicalSize = NtfsPinPhysicalSize (Pin);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Write file data at the current position through the pinned $DATA attribute.
+  Writes smaller than NTFS_WRITE_BEHIND_SIZE are gathered in the write-behind
+  buffer while they follow each other, a full buffer is written up to the
+  last cluster boundary.
+
+  @param  IFile                 - The open file instance, its inode is pinned.
+  @param  BufferSize            - On input the size of Buffer, on output the
+                                  number of bytes written.
+  @param  Buffer                - Buffer containing the data.
+
+  @retval EFI_SUCCESS           - The data is written.
+  @retval EFI_DEVICE_ERROR      - An error occurred when writing the disk.
+
+**/
+STATIC
+EFI_STATUS
+NtfsIFileWriteData (
+  IN     NTFS_IFILE  *IFile,
+  IN OUT UINTN       *BufferSize,
+  IN     VOID        *Buffer
+  )
+{
+  NTFS_WRITE_BEHIND  *WriteBehind;
+  ntfs_attr          *na;
+  s64                Offset;
+  s64                Size;
+  s64                Total;
+  s64                res;
+  s64                End;
+  s64                ClusterSize;
+  UINTN              Count;
+  EFI_STATUS         Status;
+
+  na          = IFile->Pin->DataAttr;
+  Offset      = IFile->Position;
+  Size        = *BufferSize;
+  Total       = 0;
+  ClusterSize = IFile->Volume->VolInfo->cluster_size;
+
+  if (IFile->Pin->WriteBehind == NULL && Size < NTFS_WRITE_BEHIND_SIZE) {
+    IFile->Pin->WriteBehind = AllocateZeroPool (sizeof (NTFS_WRITE_BEHIND) + NTFS_WRITE_BEHIND_SIZE);
+    if (IFile->Pin->WriteBehind != NULL) {
+      IFile->Pin->WriteBehind->Buffer = (UINT8 *) (IFile->Pin->WriteBehind + 1);
+    }
+  }
+  WriteBehind = IFile->Pin->WriteBehind;
+
+  if (WriteBehind != NULL && WriteBehind->Length != 0) {
+    End = WriteBehind->Start + WriteBehind->Length;
+    if (Offset != End) {
+      Status = NtfsWriteBehindPut (IFile, WriteBehind->Length);
+    } else if (WriteBehind->Length + Size > NTFS_WRITE_BEHIND_SIZE) {
+      //
+      // Keep the partial last cluster, the next writes complete it
+      //
+      Count = WriteBehind->Length;
+      if ((End & -ClusterSize) > WriteBehind->Start) {
+        Count = (UINTN) ((End & -ClusterSize) - WriteBehind->Start);
+      }
+      if (WriteBehind->Length - Count + Size > NTFS_WRITE_BEHIND_SIZE) {
+        Count = WriteBehind->Length;
+      }
+      Status = NtfsWriteBehindPut (IFile, Count);
+    } else {
+      Status = EFI_SUCCESS;
+    }
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  if (WriteBehind != NULL && Size <= (s64) (NTFS_WRITE_BEHIND_SIZE - WriteBehind->Length)) {
+    if (WriteBehind->Length == 0) {
+      WriteBehind->Start = Offset;
+    }
+    CopyMem (WriteBehind->Buffer + WriteBehind->Length, Buffer, (UINTN) Size);
+    WriteBehind->Length += (UINTN) Size;
+    IFile->FileInfo->FileSize = MAX (IFile->FileInfo->FileSize, (UINT64) (Offset + Size));
+    return EFI_SUCCESS;
+  }
+
+  NtfsIFilePreallocate (IFile, Offset + Size);
+
+  while (Size > 0) {
+    res = ntfs_attr_pwrite (na, Offset, Size, (CHAR8 *) Buffer + Total);
+    if (res <= 0) {
+      return EFI_DEVICE_ERROR;
+    }
+    Size   -= res;
+    Offset += res;
+    Total  += res;
+  }
+
+  //
+  // Sizes and mapping pairs live in the MFT record, write it back now
+  //
+  if (ntfs_inode_sync (IFile->Pin->Ni) != 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  *BufferSize = (UINTN) Total;
+  IFile->FileInfo->FileSize     = na->data_size;
+  IFile->FileInfo->PhysicalSize = NtfsPinPhysicalSize (IFile->Pin);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Drop one reference of a non-blocking read task. The last one reports
+  the status in the file token, signals it and frees the task.
+
+  @param  Task                  - The read task.
+
+**/
+STATIC
+VOID
+NtfsTaskRelease (
+  IN NTFS_TASK  *Task
+  )
+{
+  BOOLEAN  Last;
+
+  EfiAcquireLock (&NtfsTaskLock);
+  Last = (BOOLEAN) (--Task->Pending == 0);
+  EfiReleaseLock (&NtfsTaskLock);
+
+  if (Last) {
+    Task->FileIoToken->Status = Task->Status;
+    gBS->SignalEvent (Task->FileIoToken->Event);
+    FreePool (Task);
+  }
+}
+
+/**
+
+  Notification of the completion of a DiskIo2 subtask.
+
+  @param  Event                 - The event of the subtask.
+  @param  Context               - The subtask.
+
+**/
+STATIC
+VOID
+EFIAPI
+NtfsOnSubtaskComplete (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  NTFS_SUBTASK  *Subtask;
+  NTFS_TASK     *Task;
+
+  Subtask = (NTFS_SUBTASK *) Context;
+  Task    = Subtask->Task;
+  ASSERT (Task->Signature == NTFS_TASK_SIGNATURE);
+
+  if (EFI_ERROR (Subtask->DiskIo2Token.TransactionStatus)) {
+    Task->Status = Subtask->DiskIo2Token.TransactionStatus;
+  }
+
+  gBS->CloseEvent (Event);
+  NtfsTaskRelease (Task);
+}
+
+/**
+
+  Start a non-blocking read of file data at the current position. One
+  ReadDiskEx() is issued per extent of the runlist, holes and data past
+  the initialized size are zeroed at once. The file token is signaled when
+  the last extent has arrived.
+
+  @param  IFile                 - The open file instance, its inode is pinned.
+  @param  BufferSize            - On input the size of Buffer, on output the
+                                  number of bytes being read.
+  @param  Buffer                - Buffer receiving the data.
+  @param  Token                 - The token of the request, with an event.
+
+  @retval EFI_SUCCESS           - The read is in flight, its status will be
+                                  reported in the token. If an extent can
+                                  not be issued, BufferSize stops before it.
+  @retval EFI_UNSUPPORTED       - The data can not be read through DiskIo2,
+                                  or no extent could be issued.
+  @retval EFI_OUT_OF_RESOURCES  - Can not allocate the task.
+  @retval EFI_DEVICE_ERROR      - The cached data can not be written back.
+
+**/
+STATIC
+EFI_STATUS
+NtfsIFileReadAsync (
+  IN     NTFS_IFILE         *IFile,
+  IN OUT UINTN              *BufferSize,
+     OUT VOID               *Buffer,
+  IN     EFI_FILE_IO_TOKEN  *Token
+  )
+{
+  NTFS_VOLUME      *Volume;
+  ntfs_attr        *na;
+  runlist_element  *rl;
+  NTFS_TASK        *Task;
+  NTFS_SUBTASK     *Subtask;
+  UINTN            Count;
+  u8               Bits;
+  s64              Offset;
+  s64              End;
+  s64              Pos;
+  s64              RunEnd;
+  EFI_STATUS       Status;
+
+  Volume = IFile->Volume;
+  na     = IFile->Pin->DataAttr;
+  Bits   = Volume->VolInfo->cluster_size_bits;
+  Offset = IFile->Position;
+
+  if (Volume->DiskIo2 == NULL || !NAttrNonResident (na) ||
+      NAttrCompressed (na) || NAttrEncrypted (na) || Offset >= na->data_size) {
+    return EFI_UNSUPPORTED;
+  }
+  End = MIN (Offset + (s64) *BufferSize, na->data_size);
+
+  //
+  // Count the extents, and make sure the whole range is mapped. DiskIo2
+  // reads the media, not the block cache, so the cached changes of each
+  // extent are written first. The device needs no flush for that.
+  //
+  Count = 0;
+  for (Pos = Offset; Pos < End && Pos < na->initialized_size; Pos = RunEnd) {
+    rl = ntfs_attr_find_vcn (na, Pos >> Bits);
+    if (rl == NULL || (rl->lcn < 0 && rl->lcn != LCN_HOLE)) {
+      return EFI_UNSUPPORTED;
+    }
+    RunEnd = MIN ((rl->vcn + rl->length) << Bits, End);
+    RunEnd = MIN (RunEnd, na->initialized_size);
+    if (rl->lcn >= 0) {
+      if (ntfs_device_uefi_cache_writeback (Volume, (rl->lcn << Bits) + (Pos - (rl->vcn << Bits)), RunEnd - Pos) != 0) {
+        return EFI_DEVICE_ERROR;
+      }
+      Count++;
+    }
+  }
+
+  Task = AllocateZeroPool (sizeof (NTFS_TASK) + Count * sizeof (NTFS_SUBTASK));
+  if (Task == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Task->Signature   = NTFS_TASK_SIGNATURE;
+  Task->FileIoToken = Token;
+  Task->Status      = EFI_SUCCESS;
+  Task->Pending     = 1;
+
+  Status  = EFI_SUCCESS;
+  Subtask = Task->Subtasks;
+  for (Pos = Offset; Pos < End; Pos = RunEnd) {
+    if (Pos >= na->initialized_size) {
+      ZeroMem ((UINT8 *) Buffer + (Pos - Offset), (UINTN) (End - Pos));
+      break;
+    }
+
+    rl     = ntfs_attr_find_vcn (na, Pos >> Bits);
+    RunEnd = MIN ((rl->vcn + rl->length) << Bits, End);
+    RunEnd = MIN (RunEnd, na->initialized_size);
+    if (rl->lcn == LCN_HOLE) {
+      ZeroMem ((UINT8 *) Buffer + (Pos - Offset), (UINTN) (RunEnd - Pos));
+      continue;
+    }
+
+    Subtask->Task = Task;
+    Status = gBS->CreateEvent (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_NOTIFY,
+                    NtfsOnSubtaskComplete,
+                    Subtask,
+                    &Subtask->DiskIo2Token.Event
+                    );
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    EfiAcquireLock (&NtfsTaskLock);
+    Task->Pending++;
+    EfiReleaseLock (&NtfsTaskLock);
+
+    Status = Volume->DiskIo2->ReadDiskEx (
+                                Volume->DiskIo2,
+                                Volume->MediaId,
+                                (rl->lcn << Bits) + (Pos - (rl->vcn << Bits)),
+                                &Subtask->DiskIo2Token,
+                                (UINTN) (RunEnd - Pos),
+                                (UINT8 *) Buffer + (Pos - Offset)
+                                );
+    if (EFI_ERROR (Status)) {
+      gBS->CloseEvent (Subtask->DiskIo2Token.Event);
+      NtfsTaskRelease (Task);
+      break;
+    }
+    Volume->Counters.DeviceReads++;
+    Volume->Counters.DeviceBytesRead += RunEnd - Pos;
+    Subtask++;
+  }
+
+  if (EFI_ERROR (Status)) {
+    if (Subtask == Task->Subtasks) {
+      //
+      // Nothing is in flight, the caller reads synchronously instead
+      //
+      FreePool (Task);
+      return EFI_UNSUPPORTED;
+    }
+    //
+    // Report the extents in flight only, the position does not pass them
+    //
+    End = Pos;
+  }
+  *BufferSize = (UINTN) (End - Offset);
+
+  //
+  // Drop the reference held while issuing, the task may complete here
+  //
+  NtfsTaskRelease (Task);
+  return EFI_SUCCESS;
+}
+
 /**
 
   Get the file info from the open file of the IFile into Buffer.
@@ -125,10 +1059,10 @@ NtfsIFileAccess (
   )
 {
   EFI_STATUS   Status = EFI_SUCCESS;
-  s64          res = 0;
   NTFS_VOLUME  *Volume;
   NTFS_IFILE   *IFile;
-  ntfs_inode   *ni;
+  BOOLEAN      Queued;
+  NTFS_TRACE_DECLARE (Trace);
 
   IFile = IFILE_FROM_FHAND (FHand);
   Volume = IFile->Volume;
@@ -137,7 +1071,7 @@ NtfsIFileAccess (
 	//
 	// If position is at EOF, then return device error
 	//
-	if (IFile->Position > IFile->FileInfo->FileSize) {
+	if (!IFile->IsDir && IFile->Position > IFile->FileInfo->FileSize) {
       return EFI_DEVICE_ERROR;
 	}
   } else {
@@ -158,68 +1092,68 @@ NtfsIFileAccess (
   }
   
   NtfsAcquireLock ();
-  
-  ni = ntfs_pathname_to_inode(Volume->VolInfo, NULL, IFile->Path);
+  NTFS_TRACE_BEGIN (Trace, Volume, IFile);
 
+  Queued = FALSE;
   if (IoMode == ReadData) {
   	if (IFile->IsDir) {
-	  LIST_ENTRY		   *Node;
-	  NTFS_IFILE           *SubFile;
-	  UINTN                Size = 0;
-	  
-	  Node = GetFirstNode (&IFile->SubFIleHead);
-	  while (!IsNull (&IFile->SubFIleHead, Node)) {
-	  	SubFile = IFILE_FROM_LINK (Node);
-		if (Size == IFile->Position) {
-			break;
-	    }
-		
-	    Size += SubFile->FileInfoSize;
-		Node = GetNextNode (&IFile->SubFIleHead, Node);
-	  }
-
-	  if (Size == IFile->FileInfo->FileSize) {
-	  	*BufferSize = 0;
-		Status = EFI_SUCCESS;
-	  }
-	  else {
-	    Status = NtfsGetDirEntInfo (IFile->Volume, SubFile, BufferSize, Buffer, FALSE);
-	  }
+	  //
+	  // Directories are enumerated through their readdir cursor, the
+	  // position is not meaningful for them
+	  //
+	  Status = NtfsReadDirEntry (IFile, BufferSize, Buffer);
     }
 	else {
-  	  res = ntfs_attr_data_read(ni, AT_UNNAMED, 0, Buffer, *BufferSize, IFile->Position);
-	  if (res < 0) {
-	  	Status = EFI_DEVICE_ERROR;
+	  Status = NtfsIFileOpenInode (IFile);
+	  if (!EFI_ERROR (Status)) {
+	    //
+	    // Reads see the data still in the write-behind buffer
+	    //
+	    Status = NtfsIFileFlushWriteBehind (IFile, FALSE);
 	  }
-	  else {
-	  	*BufferSize = res;
+	  if (!EFI_ERROR (Status) && Token != NULL && Token->Event != NULL) {
+	    //
+	    // Non-blocking reads go to DiskIo2 so that they overlap at the device
+	    //
+	    Status = NtfsIFileReadAsync (IFile, BufferSize, Buffer, Token);
+	    Queued = (BOOLEAN) (Status == EFI_SUCCESS);
+	    if (Status == EFI_UNSUPPORTED) {
+	      Status = EFI_SUCCESS;
+	    }
+	  }
+	  if (!EFI_ERROR (Status) && !Queued) {
+	    Status = NtfsIFileReadData (IFile, BufferSize, Buffer);
 	  }
 	}
   }
   else {
-  	res = ntfs_attr_data_write(ni, AT_UNNAMED, 0, Buffer, *BufferSize, IFile->Position);
-	if (res < 0) {
-	  Status = EFI_DEVICE_ERROR;
-	}
-	else {
-	  *BufferSize = res;
-	  IFile->FileInfo->FileSize = ni->data_size;
-      IFile->FileInfo->PhysicalSize = ni->allocated_size;
-	}	
+    Status = NtfsIFileOpenInode (IFile);
+    if (!EFI_ERROR (Status)) {
+      Status = NtfsIFileWriteData (IFile, BufferSize, Buffer);
+    }
   }
 
-  ntfs_inode_close(ni);
-
-  if (!EFI_ERROR (Status)) {
+  if (!EFI_ERROR (Status) && !IFile->IsDir) {
     IFile->Position += *BufferSize;
   }
 
+  NTFS_TRACE_END (
+    Trace,
+    Volume,
+    (IoMode == ReadData) ? NtfsTraceRead : NtfsTraceWrite,
+    EFI_ERROR (Status) ? 0 : *BufferSize
+    );
+
   if (EFI_ERROR (Status)) {
     NtfsCleanupVolume (Volume);
   }
 
   NtfsReleaseLock ();
-  return Status;
+
+  if (Queued) {
+    return EFI_SUCCESS;
+  }
+  return NtfsCompleteToken (Token, Status);
 }
 
 /**
@@ -275,3 +1209,52 @@ NtfsWrite (
 {
   return NtfsIFileAccess (FHand, WriteData, BufferSize, Buffer, NULL);
 }
+
+/**
+
+  Get the file info.
+
+  @param  FHand                 - The handle of the file.
+  @param  Token                 - A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS           - Get the file info successfully.
+  @retval EFI_DEVICE_ERROR      - Can not find the OFile for the file.
+  @retval EFI_VOLUME_CORRUPTED  - The file type of open file is error.
+  @return other                 - An error occurred when operation the disk.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsReadEx (
+  IN     EFI_FILE_PROTOCOL  *FHand,
+  IN OUT EFI_FILE_IO_TOKEN  *Token
+  )
+{
+  return NtfsIFileAccess (FHand, ReadData, &Token->BufferSize, Token->Buffer, Token);
+}
+
+/**
+
+  Write the content of buffer into files. The data is written
+  synchronously, a non-blocking request is completed through its token.
+
+  @param  FHand                 - The handle of the file.
+  @param  Token                 - A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS           - Set the file info successfully.
+  @retval EFI_WRITE_PROTECTED   - The disk is write protect.
+  @retval EFI_ACCESS_DENIED     - The file is read-only.
+  @retval EFI_DEVICE_ERROR      - The OFile is not valid.
+  @retval EFI_UNSUPPORTED       - The open file is not a file.
+  @return other                 - An error occurred when operation the disk.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsWriteEx (
+  IN     EFI_FILE_PROTOCOL  *FHand,
+  IN OUT EFI_FILE_IO_TOKEN  *Token
+  )
+{
+  return NtfsIFileAccess (FHand, WriteData, &Token->BufferSize, Token->Buffer, Token);
+}
@@ -0,0 +1,322 @@
+/** @file
+  Counters and trace of file operations.
+
+  The counters of a volume are always maintained. When the driver is built
+  with NTFS_TRACE defined, every file operation also records a fixed size
+  event into a ring of NTFS_TRACE_EVENTS entries of its volume, instead of
+  printing to the console. The ring is only written with the volume locked.
+
+**/
+
+#include "Ntfs.h"
+
+/**
+
+  Implements GetCounters() of the NTFS trace protocol.
+
+  @param  This                  - The protocol instance of the volume.
+  @param  Counters              - The counters of the volume.
+
+  @retval EFI_SUCCESS           - The counters are returned.
+  @retval EFI_INVALID_PARAMETER - Counters is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsTraceGetCounters (
+  IN  NTFS_TRACE_PROTOCOL   *This,
+  OUT NTFS_VOLUME_COUNTERS  *Counters
+  )
+{
+  NTFS_VOLUME  *Volume;
+
+  if (Counters == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Volume = VOLUME_FROM_TRACE_INTERFACE (This);
+
+  NtfsAcquireLock ();
+  CopyMem (Counters, &Volume->Counters, sizeof (NTFS_VOLUME_COUNTERS));
+  //
+  // Metadata reads are counted by the library while the volume is mounted
+  //
+  if (Volume->VolInfo != NULL) {
+    Counters->MftRecordReads  = Volume->VolInfo->mft_record_reads;
+    Counters->IndexBlockReads = Volume->VolInfo->index_block_reads;
+  }
+  NtfsReleaseLock ();
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Implements GetEvents() of the NTFS trace protocol.
+
+  @param  This                  - The protocol instance of the volume.
+  @param  Count                 - On input the number of events Events can hold,
+                                  on output the number of events returned.
+  @param  Events                - The events, oldest first.
+  @param  Dropped               - The number of events overwritten since the last reset.
+
+  @retval EFI_SUCCESS           - The events are returned.
+  @retval EFI_INVALID_PARAMETER - Count is NULL, or Events is NULL while *Count is not 0.
+  @retval EFI_UNSUPPORTED       - The driver is built without NTFS_TRACE.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsTraceGetEvents (
+  IN     NTFS_TRACE_PROTOCOL  *This,
+  IN OUT UINTN                *Count,
+     OUT NTFS_TRACE_EVENT     *Events,
+     OUT UINT64               *Dropped OPTIONAL
+  )
+{
+  NTFS_VOLUME  *Volume;
+  UINT64       First;
+  UINT64       Index;
+  UINTN        Copied;
+
+  if (Count == NULL || (Events == NULL && *Count != 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Volume = VOLUME_FROM_TRACE_INTERFACE (This);
+  if (Volume->TraceEvents == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  NtfsAcquireLock ();
+
+  First = 0;
+  if (Volume->TraceHead > NTFS_TRACE_EVENTS) {
+    First = Volume->TraceHead - NTFS_TRACE_EVENTS;
+  }
+  if (Dropped != NULL) {
+    *Dropped = First;
+  }
+
+  Copied = 0;
+  for (Index = First; Index < Volume->TraceHead && Copied < *Count; Index++) {
+    CopyMem (
+      &Events[Copied++],
+      &Volume->TraceEvents[Index & (NTFS_TRACE_EVENTS - 1)],
+      sizeof (NTFS_TRACE_EVENT)
+      );
+  }
+  *Count = Copied;
+
+  NtfsReleaseLock ();
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Implements Reset() of the NTFS trace protocol.
+
+  @param  This                  - The protocol instance of the volume.
+
+  @retval EFI_SUCCESS           - The counters and the events are cleared.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsTraceReset (
+  IN NTFS_TRACE_PROTOCOL  *This
+  )
+{
+  NTFS_VOLUME  *Volume;
+
+  Volume = VOLUME_FROM_TRACE_INTERFACE (This);
+
+  NtfsAcquireLock ();
+  ZeroMem (&Volume->Counters, sizeof (NTFS_VOLUME_COUNTERS));
+  if (Volume->VolInfo != NULL) {
+    Volume->VolInfo->mft_record_reads  = 0;
+    Volume->VolInfo->index_block_reads = 0;
+  }
+  Volume->TraceHead = 0;
+  NtfsReleaseLock ();
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Implements GetCacheStats() of the NTFS trace protocol.
+
+  @param  This                  - The protocol instance of the volume.
+  @param  Count                 - On input the number of caches Caches can hold,
+                                  on output the number of caches of the volume.
+  @param  Caches                - The statistics of the caches.
+
+  @retval EFI_SUCCESS           - The statistics are returned.
+  @retval EFI_INVALID_PARAMETER - Count is NULL, or Caches is NULL while *Count is not 0.
+  @retval EFI_BUFFER_TOO_SMALL  - Caches is too small, Count is updated.
+  @retval EFI_NOT_READY         - The volume is not mounted.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsTraceGetCacheStats (
+  IN     NTFS_TRACE_PROTOCOL  *This,
+  IN OUT UINTN                *Count,
+     OUT NTFS_CACHE_COUNTERS  *Caches
+  )
+{
+  NTFS_VOLUME        *Volume;
+  struct CACHE_STATS Stats[LRU_COUNT];
+  UINTN              Index;
+  UINTN              Length;
+
+  if (Count == NULL || (Caches == NULL && *Count != 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (*Count < LRU_COUNT) {
+    *Count = LRU_COUNT;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  Volume = VOLUME_FROM_TRACE_INTERFACE (This);
+
+  NtfsAcquireLock ();
+  if (Volume->VolInfo == NULL) {
+    NtfsReleaseLock ();
+    return EFI_NOT_READY;
+  }
+  ntfs_lru_cache_stats (Volume->VolInfo, Stats);
+  NtfsReleaseLock ();
+
+  for (Index = 0; Index < LRU_COUNT; Index++) {
+    ZeroMem (&Caches[Index], sizeof (NTFS_CACHE_COUNTERS));
+    Length = AsciiStrLen (Stats[Index].name);
+    if (Length >= sizeof (Caches[Index].Name)) {
+      Length = sizeof (Caches[Index].Name) - 1;
+    }
+    CopyMem (Caches[Index].Name, Stats[Index].name, Length);
+    Caches[Index].Entries = (UINT32) Stats[Index].entries;
+    Caches[Index].Lookups = Stats[Index].reads;
+    Caches[Index].Hits    = Stats[Index].hits;
+    Caches[Index].Inserts = Stats[Index].writes;
+  }
+  *Count = LRU_COUNT;
+
+  return EFI_SUCCESS;
+}
+
+#ifdef NTFS_TRACE
+
+/**
+
+  Hash the name of a file, FNV-1a over its UTF-16 code units.
+
+  @param  Name                  - The name of the file.
+
+  @return The hash of the name.
+
+**/
+STATIC
+UINT32
+NtfsTraceHashName (
+  IN CONST CHAR16  *Name
+  )
+{
+  UINT32  Hash;
+
+  Hash = 0x811C9DC5;
+  while (*Name != L'\0') {
+    Hash = (Hash ^ *Name++) * 0x01000193;
+  }
+
+  return Hash;
+}
+
+/**
+
+  Start timing a file operation, the volume must be locked.
+
+  @param  Scope                 - The state of the operation.
+  @param  Volume                - The volume of the file.
+  @param  IFile                 - The file of the operation, may be NULL.
+
+**/
+VOID
+NtfsTraceBegin (
+  OUT NTFS_TRACE_SCOPE  *Scope,
+  IN  NTFS_VOLUME       *Volume,
+  IN  NTFS_IFILE        *IFile
+  )
+{
+  ASSERT_VOLUME_LOCKED (Volume);
+
+  Scope->Handle   = 0;
+  Scope->PathHash = 0;
+  if (IFile != NULL) {
+    NtfsTraceFile (Scope, IFile);
+  }
+  Scope->DeviceReads  = Volume->Counters.DeviceReads;
+  Scope->DeviceWrites = Volume->Counters.DeviceWrites;
+  Scope->Tick         = AsmReadTsc ();
+}
+
+/**
+
+  Attribute the event of an operation to another file.
+
+  @param  Scope                 - The state of the operation.
+  @param  IFile                 - The file of the operation.
+
+**/
+VOID
+NtfsTraceFile (
+  IN OUT NTFS_TRACE_SCOPE  *Scope,
+  IN     NTFS_IFILE        *IFile
+  )
+{
+  Scope->Handle   = (UINT64) (UINTN) &IFile->Handle;
+  Scope->PathHash = NtfsTraceHashName (IFile->Name);
+}
+
+/**
+
+  Record the event of a file operation, the volume must still be locked.
+
+  @param  Scope                 - The state of the operation.
+  @param  Volume                - The volume of the file.
+  @param  Op                    - The operation.
+  @param  Bytes                 - The bytes read or written.
+
+**/
+VOID
+NtfsTraceEnd (
+  IN NTFS_TRACE_SCOPE  *Scope,
+  IN NTFS_VOLUME       *Volume,
+  IN NTFS_TRACE_OP     Op,
+  IN UINT64            Bytes
+  )
+{
+  NTFS_TRACE_EVENT  *Event;
+
+  ASSERT_VOLUME_LOCKED (Volume);
+
+  if (Volume->TraceEvents == NULL) {
+    return;
+  }
+
+  Event = &Volume->TraceEvents[Volume->TraceHead++ & (NTFS_TRACE_EVENTS - 1)];
+  Event->Tick         = Scope->Tick;
+  Event->Elapsed      = AsmReadTsc () - Scope->Tick;
+  Event->Handle       = Scope->Handle;
+  Event->Bytes        = Bytes;
+  Event->PathHash     = Scope->PathHash;
+  Event->Op           = (UINT16) Op;
+  Event->Reserved     = 0;
+  Event->DeviceReads  = (UINT32) (Volume->Counters.DeviceReads - Scope->DeviceReads);
+  Event->DeviceWrites = (UINT32) (Volume->Counters.DeviceWrites - Scope->DeviceWrites);
+}
+
+#endif
@@ -0,0 +1,143 @@
+/** @file
+  Host build: declarations shared by the boot services, the disk and the
+  benchmark driver of the harness.
+
+**/
+
+#ifndef _NTFS_HOST_H_
+#define _NTFS_HOST_H_
+
+#include <Uefi.h>
+
+#include <Guid/FileInfo.h>
+#include <Guid/FileSystemInfo.h>
+#include <Guid/FileSystemVolumeLabelInfo.h>
+#include <Protocol/BlockIo.h>
+#include <Protocol/DiskIo.h>
+#include <Protocol/DiskIo2.h>
+#include <Protocol/SimpleFileSystem.h>
+#include <Protocol/UnicodeCollation.h>
+
+#include <Library/PcdLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+#include "NtfsTrace.h"
+
+extern EFI_GUID  gEfiCallerIdGuid;
+extern EFI_GUID  gNtfsTraceProtocolGuid;
+
+//
+// Outstanding allocations and events, checked after the driver is unloaded
+//
+typedef struct {
+  UINT64  PoolAllocations;
+  UINT64  PoolBytes;
+  UINT64  PageAllocations;
+  UINT64  Pages;
+  UINT64  Events;
+} HOST_POOL_STATS;
+
+extern HOST_POOL_STATS  gHostPool;
+extern UINTN            gHostDebugLevel;
+
+//
+// Simulated device: each request costs Latency nanoseconds plus its size
+// at Bandwidth bytes per second, requests being served one at a time
+//
+typedef struct {
+  UINT64  LatencyNs;
+  UINT64  Bandwidth;
+  UINT32  BlockSize;
+  UINT32  IoAlign;
+  BOOLEAN NoDiskIo2;
+  BOOLEAN ReadOnly;
+} HOST_DISK_CONFIG;
+
+typedef struct {
+  UINT64  Reads;
+  UINT64  Writes;
+  UINT64  AsyncReads;
+  UINT64  AsyncWrites;
+  UINT64  Flushes;
+  UINT64  Cancels;
+  UINT64  BytesRead;
+  UINT64  BytesWritten;
+} HOST_DISK_STATS;
+
+typedef struct _HOST_DISK HOST_DISK;
+
+UINT64
+HostPoolMark (
+  VOID
+  );
+
+VOID
+HostPoolDump (
+  IN UINT64  Mark
+  );
+
+EFI_STATUS
+HostUefiInitialize (
+  VOID
+  );
+
+UINT64
+HostNanoseconds (
+  VOID
+  );
+
+CONST CHAR8 *
+HostStatusName (
+  IN EFI_STATUS  Status
+  );
+
+EFI_TPL
+HostCurrentTpl (
+  VOID
+  );
+
+EFI_STATUS
+HostDiskOpen (
+  IN  CONST CHAR8             *Path,
+  IN  CONST HOST_DISK_CONFIG  *Config,
+  OUT HOST_DISK               **Disk
+  );
+
+VOID
+HostDiskClose (
+  IN HOST_DISK  *Disk
+  );
+
+EFI_HANDLE
+HostDiskHandle (
+  IN HOST_DISK  *Disk
+  );
+
+VOID
+HostDiskGetStats (
+  IN  HOST_DISK        *Disk,
+  OUT HOST_DISK_STATS  *Stats
+  );
+
+VOID
+HostDiskPoll (
+  VOID
+  );
+
+BOOLEAN
+HostDiskBusy (
+  VOID
+  );
+
+BOOLEAN
+HostDiskEventInUse (
+  IN EFI_EVENT  Event
+  );
+
+#endif
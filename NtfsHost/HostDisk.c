@@ -0,0 +1,673 @@
+/** @file
+  Host build: a raw image file exposed as Block I/O, Disk I/O and Disk I/O 2
+  on a handle of its own, the way a partition driver publishes a partition.
+
+  Requests are served one at a time by a simulated device. A synchronous
+  request waits for the device to be idle and then for its own cost. An
+  asynchronous one is queued and completes, signaling its token, at the
+  first poll after the device would have finished it. The image itself is
+  accessed with pread() and pwrite(), and only when the request completes,
+  so a driver reading a buffer of a request still in flight sees stale
+  data as it would on hardware.
+
+**/
+
+#include "Host.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HOST_DISK_SIGNATURE  SIGNATURE_32 ('h', 'd', 's', 'k')
+
+typedef struct {
+  LIST_ENTRY          Link;
+  EFI_DISK_IO2_TOKEN  *Token;
+  UINT64              Offset;
+  UINTN               BufferSize;
+  VOID                *Buffer;
+  BOOLEAN             Write;
+  UINT64              Deadline;
+} HOST_DISK_REQUEST;
+
+struct _HOST_DISK {
+  UINT32                  Signature;
+  int                     Fd;
+  UINT64                  Size;
+  HOST_DISK_CONFIG        Config;
+  HOST_DISK_STATS         Stats;
+  UINT64                  BusyUntil;
+  LIST_ENTRY              Queue;
+  LIST_ENTRY              Link;
+  EFI_HANDLE              Handle;
+  EFI_BLOCK_IO_MEDIA      Media;
+  EFI_BLOCK_IO_PROTOCOL   BlockIo;
+  EFI_DISK_IO_PROTOCOL    DiskIo;
+  EFI_DISK_IO2_PROTOCOL   DiskIo2;
+};
+
+#define DISK_FROM_BLOCK_IO(a)  BASE_CR (a, HOST_DISK, BlockIo)
+#define DISK_FROM_DISK_IO(a)   BASE_CR (a, HOST_DISK, DiskIo)
+#define DISK_FROM_DISK_IO2(a)  BASE_CR (a, HOST_DISK, DiskIo2)
+
+STATIC LIST_ENTRY  mHostDisks = INITIALIZE_LIST_HEAD_VARIABLE (mHostDisks);
+
+/**
+  Reserve the device for a request of BufferSize bytes.
+
+  @return The time the device completes the request.
+
+**/
+STATIC
+UINT64
+HostDiskSchedule (
+  IN HOST_DISK  *Disk,
+  IN UINTN      BufferSize
+  )
+{
+  UINT64  Start;
+
+  Start = HostNanoseconds ();
+  if (Disk->BusyUntil > Start) {
+    Start = Disk->BusyUntil;
+  }
+  Disk->BusyUntil = Start + Disk->Config.LatencyNs;
+  if (Disk->Config.Bandwidth != 0) {
+    Disk->BusyUntil += BufferSize * 1000000000ULL / Disk->Config.Bandwidth;
+  }
+  return Disk->BusyUntil;
+}
+
+STATIC
+EFI_STATUS
+HostDiskTransfer (
+  IN HOST_DISK  *Disk,
+  IN UINT64     Offset,
+  IN UINTN      BufferSize,
+  IN VOID       *Buffer,
+  IN BOOLEAN    Write
+  )
+{
+  ssize_t  Done;
+  UINTN    Total;
+
+  for (Total = 0; Total < BufferSize; Total += Done) {
+    if (Write) {
+      Done = pwrite (Disk->Fd, (UINT8 *) Buffer + Total, BufferSize - Total, Offset + Total);
+    } else {
+      Done = pread (Disk->Fd, (UINT8 *) Buffer + Total, BufferSize - Total, Offset + Total);
+    }
+    if (Done <= 0) {
+      return EFI_DEVICE_ERROR;
+    }
+  }
+  if (Write) {
+    Disk->Stats.BytesWritten += BufferSize;
+  } else {
+    Disk->Stats.BytesRead += BufferSize;
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Check a request against the media, in the order of the DiskIo driver
+  of the firmware.
+
+**/
+STATIC
+EFI_STATUS
+HostDiskCheck (
+  IN HOST_DISK  *Disk,
+  IN UINT32     MediaId,
+  IN UINT64     Offset,
+  IN UINTN      BufferSize,
+  IN BOOLEAN    Write
+  )
+{
+  if (MediaId != Disk->Media.MediaId) {
+    return EFI_MEDIA_CHANGED;
+  }
+  if (Write && Disk->Media.ReadOnly) {
+    return EFI_WRITE_PROTECTED;
+  }
+  if (Offset > Disk->Size || BufferSize > Disk->Size - Offset) {
+    return EFI_INVALID_PARAMETER;
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Serve a synchronous request, waiting for the device.
+
+**/
+STATIC
+EFI_STATUS
+HostDiskSync (
+  IN HOST_DISK  *Disk,
+  IN UINT64     Offset,
+  IN UINTN      BufferSize,
+  IN VOID       *Buffer,
+  IN BOOLEAN    Write
+  )
+{
+  UINT64  Deadline;
+
+  if (Write) {
+    Disk->Stats.Writes++;
+  } else {
+    Disk->Stats.Reads++;
+  }
+  Deadline = HostDiskSchedule (Disk, BufferSize);
+  while (HostNanoseconds () < Deadline) {
+    HostDiskPoll ();
+  }
+  return HostDiskTransfer (Disk, Offset, BufferSize, Buffer, Write);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostBlockReset (
+  IN EFI_BLOCK_IO_PROTOCOL  *This,
+  IN BOOLEAN                ExtendedVerification
+  )
+{
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+HostBlockCheck (
+  IN HOST_DISK  *Disk,
+  IN UINT32     MediaId,
+  IN EFI_LBA    Lba,
+  IN UINTN      BufferSize,
+  IN VOID       *Buffer,
+  IN BOOLEAN    Write
+  )
+{
+  if (MediaId != Disk->Media.MediaId) {
+    return EFI_MEDIA_CHANGED;
+  }
+  if (Write && Disk->Media.ReadOnly) {
+    return EFI_WRITE_PROTECTED;
+  }
+  if (Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (BufferSize % Disk->Media.BlockSize != 0) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+  if (Lba > Disk->Media.LastBlock || BufferSize / Disk->Media.BlockSize > Disk->Media.LastBlock - Lba + 1) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (Disk->Media.IoAlign > 1 && ((UINTN) Buffer & (Disk->Media.IoAlign - 1)) != 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostBlockRead (
+  IN EFI_BLOCK_IO_PROTOCOL  *This,
+  IN UINT32                 MediaId,
+  IN EFI_LBA                Lba,
+  IN UINTN                  BufferSize,
+  OUT VOID                  *Buffer
+  )
+{
+  HOST_DISK   *Disk;
+  EFI_STATUS  Status;
+
+  Disk   = DISK_FROM_BLOCK_IO (This);
+  Status = HostBlockCheck (Disk, MediaId, Lba, BufferSize, Buffer, FALSE);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  return HostDiskSync (Disk, Lba * Disk->Media.BlockSize, BufferSize, Buffer, FALSE);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostBlockWrite (
+  IN EFI_BLOCK_IO_PROTOCOL  *This,
+  IN UINT32                 MediaId,
+  IN EFI_LBA                Lba,
+  IN UINTN                  BufferSize,
+  IN VOID                   *Buffer
+  )
+{
+  HOST_DISK   *Disk;
+  EFI_STATUS  Status;
+
+  Disk   = DISK_FROM_BLOCK_IO (This);
+  Status = HostBlockCheck (Disk, MediaId, Lba, BufferSize, Buffer, TRUE);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  return HostDiskSync (Disk, Lba * Disk->Media.BlockSize, BufferSize, Buffer, TRUE);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostBlockFlush (
+  IN EFI_BLOCK_IO_PROTOCOL  *This
+  )
+{
+  HOST_DISK  *Disk;
+  UINT64     Deadline;
+
+  Disk = DISK_FROM_BLOCK_IO (This);
+  Disk->Stats.Flushes++;
+  Deadline = HostDiskSchedule (Disk, 0);
+  while (HostNanoseconds () < Deadline) {
+    HostDiskPoll ();
+  }
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostDiskRead (
+  IN EFI_DISK_IO_PROTOCOL  *This,
+  IN UINT32                MediaId,
+  IN UINT64                Offset,
+  IN UINTN                 BufferSize,
+  OUT VOID                 *Buffer
+  )
+{
+  HOST_DISK   *Disk;
+  EFI_STATUS  Status;
+
+  Disk   = DISK_FROM_DISK_IO (This);
+  Status = HostDiskCheck (Disk, MediaId, Offset, BufferSize, FALSE);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  return HostDiskSync (Disk, Offset, BufferSize, Buffer, FALSE);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostDiskWrite (
+  IN EFI_DISK_IO_PROTOCOL  *This,
+  IN UINT32                MediaId,
+  IN UINT64                Offset,
+  IN UINTN                 BufferSize,
+  IN VOID                  *Buffer
+  )
+{
+  HOST_DISK   *Disk;
+  EFI_STATUS  Status;
+
+  Disk   = DISK_FROM_DISK_IO (This);
+  Status = HostDiskCheck (Disk, MediaId, Offset, BufferSize, TRUE);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  return HostDiskSync (Disk, Offset, BufferSize, Buffer, TRUE);
+}
+
+/**
+  Complete a queued request and signal its token.
+
+**/
+STATIC
+VOID
+HostDiskComplete (
+  IN HOST_DISK          *Disk,
+  IN HOST_DISK_REQUEST  *Request,
+  IN EFI_STATUS         Status
+  )
+{
+  EFI_DISK_IO2_TOKEN  *Token;
+
+  RemoveEntryList (&Request->Link);
+  if (!EFI_ERROR (Status)) {
+    Status = HostDiskTransfer (Disk, Request->Offset, Request->BufferSize, Request->Buffer, Request->Write);
+  }
+  Token = Request->Token;
+  free (Request);
+  Token->TransactionStatus = Status;
+  gBS->SignalEvent (Token->Event);
+}
+
+STATIC
+EFI_STATUS
+HostDiskQueue (
+  IN HOST_DISK           *Disk,
+  IN UINT32              MediaId,
+  IN UINT64              Offset,
+  IN EFI_DISK_IO2_TOKEN  *Token,
+  IN UINTN               BufferSize,
+  IN VOID                *Buffer,
+  IN BOOLEAN             Write
+  )
+{
+  HOST_DISK_REQUEST  *Request;
+  EFI_STATUS         Status;
+
+  Status = HostDiskCheck (Disk, MediaId, Offset, BufferSize, Write);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  if (Token == NULL || Token->Event == NULL) {
+    return HostDiskSync (Disk, Offset, BufferSize, Buffer, Write);
+  }
+  if (Write) {
+    Disk->Stats.AsyncWrites++;
+  } else {
+    Disk->Stats.AsyncReads++;
+  }
+  Request = calloc (1, sizeof (HOST_DISK_REQUEST));
+  if (Request == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Request->Token      = Token;
+  Request->Offset     = Offset;
+  Request->BufferSize = BufferSize;
+  Request->Buffer     = Buffer;
+  Request->Write      = Write;
+  Request->Deadline   = HostDiskSchedule (Disk, BufferSize);
+  InsertTailList (&Disk->Queue, &Request->Link);
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostDiskCancelEx (
+  IN EFI_DISK_IO2_PROTOCOL  *This
+  )
+{
+  HOST_DISK  *Disk;
+
+  Disk = DISK_FROM_DISK_IO2 (This);
+  Disk->Stats.Cancels++;
+  while (!IsListEmpty (&Disk->Queue)) {
+    HostDiskComplete (Disk, BASE_CR (GetFirstNode (&Disk->Queue), HOST_DISK_REQUEST, Link), EFI_ABORTED);
+  }
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostDiskReadEx (
+  IN EFI_DISK_IO2_PROTOCOL   *This,
+  IN UINT32                  MediaId,
+  IN UINT64                  Offset,
+  IN OUT EFI_DISK_IO2_TOKEN  *Token,
+  IN UINTN                   BufferSize,
+  OUT VOID                   *Buffer
+  )
+{
+  return HostDiskQueue (DISK_FROM_DISK_IO2 (This), MediaId, Offset, Token, BufferSize, Buffer, FALSE);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostDiskWriteEx (
+  IN EFI_DISK_IO2_PROTOCOL   *This,
+  IN UINT32                  MediaId,
+  IN UINT64                  Offset,
+  IN OUT EFI_DISK_IO2_TOKEN  *Token,
+  IN UINTN                   BufferSize,
+  IN VOID                    *Buffer
+  )
+{
+  return HostDiskQueue (DISK_FROM_DISK_IO2 (This), MediaId, Offset, Token, BufferSize, Buffer, TRUE);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostDiskFlushEx (
+  IN EFI_DISK_IO2_PROTOCOL   *This,
+  IN OUT EFI_DISK_IO2_TOKEN  *Token
+  )
+{
+  HOST_DISK  *Disk;
+
+  Disk = DISK_FROM_DISK_IO2 (This);
+  HostBlockFlush (&Disk->BlockIo);
+  if (Token != NULL && Token->Event != NULL) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Complete the asynchronous requests the devices are done with. Called
+  wherever firmware could take the timer interrupt.
+
+**/
+VOID
+HostDiskPoll (
+  VOID
+  )
+{
+  LIST_ENTRY         *DiskLink;
+  HOST_DISK          *Disk;
+  HOST_DISK_REQUEST  *Request;
+  UINT64             Now;
+  STATIC BOOLEAN     Polling;
+
+  //
+  // Completions signal events, whose notification functions may poll
+  //
+  if (Polling) {
+    return;
+  }
+  Polling = TRUE;
+  Now     = HostNanoseconds ();
+  for (DiskLink = GetFirstNode (&mHostDisks); !IsNull (&mHostDisks, DiskLink); DiskLink = GetNextNode (&mHostDisks, DiskLink)) {
+    Disk = BASE_CR (DiskLink, HOST_DISK, Link);
+    while (!IsListEmpty (&Disk->Queue)) {
+      Request = BASE_CR (GetFirstNode (&Disk->Queue), HOST_DISK_REQUEST, Link);
+      if (Request->Deadline > Now) {
+        break;
+      }
+      HostDiskComplete (Disk, Request, EFI_SUCCESS);
+    }
+  }
+  Polling = FALSE;
+}
+
+/**
+  Tell whether some asynchronous request is still in flight.
+
+**/
+BOOLEAN
+HostDiskBusy (
+  VOID
+  )
+{
+  LIST_ENTRY  *DiskLink;
+
+  for (DiskLink = GetFirstNode (&mHostDisks); !IsNull (&mHostDisks, DiskLink); DiskLink = GetNextNode (&mHostDisks, DiskLink)) {
+    if (!IsListEmpty (&BASE_CR (DiskLink, HOST_DISK, Link)->Queue)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Tell whether a request in flight is to signal Event.
+
+**/
+BOOLEAN
+HostDiskEventInUse (
+  IN EFI_EVENT  Event
+  )
+{
+  LIST_ENTRY         *DiskLink;
+  LIST_ENTRY         *Link;
+  HOST_DISK          *Disk;
+  HOST_DISK_REQUEST  *Request;
+
+  for (DiskLink = GetFirstNode (&mHostDisks); !IsNull (&mHostDisks, DiskLink); DiskLink = GetNextNode (&mHostDisks, DiskLink)) {
+    Disk = BASE_CR (DiskLink, HOST_DISK, Link);
+    for (Link = GetFirstNode (&Disk->Queue); !IsNull (&Disk->Queue, Link); Link = GetNextNode (&Disk->Queue, Link)) {
+      Request = BASE_CR (Link, HOST_DISK_REQUEST, Link);
+      if (Request->Token->Event == Event) {
+        return TRUE;
+      }
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Open an image file and install the disk protocols on a new handle.
+
+  @param  Path                  - The image file.
+  @param  Config                - How the device behaves.
+  @param  Disk                  - The new disk.
+
+  @retval EFI_SUCCESS           - The disk is installed.
+  @retval EFI_NOT_FOUND         - The image can not be opened.
+
+**/
+EFI_STATUS
+HostDiskOpen (
+  IN  CONST CHAR8             *Path,
+  IN  CONST HOST_DISK_CONFIG  *Config,
+  OUT HOST_DISK               **Disk
+  )
+{
+  HOST_DISK    *NewDisk;
+  struct stat  Stat;
+  EFI_STATUS   Status;
+
+  NewDisk = calloc (1, sizeof (HOST_DISK));
+  if (NewDisk == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  NewDisk->Signature = HOST_DISK_SIGNATURE;
+  NewDisk->Config    = *Config;
+  if (NewDisk->Config.BlockSize == 0) {
+    NewDisk->Config.BlockSize = 512;
+  }
+  NewDisk->Fd = open (Path, Config->ReadOnly ? O_RDONLY : O_RDWR);
+  if (NewDisk->Fd < 0 || fstat (NewDisk->Fd, &Stat) != 0) {
+    fprintf (stderr, "%s: %s\n", Path, strerror (errno));
+    if (NewDisk->Fd >= 0) {
+      close (NewDisk->Fd);
+    }
+    free (NewDisk);
+    return EFI_NOT_FOUND;
+  }
+  NewDisk->Size = (UINT64) Stat.st_size - (UINT64) Stat.st_size % NewDisk->Config.BlockSize;
+  InitializeListHead (&NewDisk->Queue);
+
+  NewDisk->Media.MediaId          = 1;
+  NewDisk->Media.MediaPresent     = TRUE;
+  NewDisk->Media.LogicalPartition = TRUE;
+  NewDisk->Media.ReadOnly         = Config->ReadOnly;
+  NewDisk->Media.BlockSize        = NewDisk->Config.BlockSize;
+  NewDisk->Media.IoAlign          = Config->IoAlign;
+  NewDisk->Media.LastBlock        = NewDisk->Size / NewDisk->Config.BlockSize - 1;
+
+  NewDisk->BlockIo.Revision       = EFI_BLOCK_IO_PROTOCOL_REVISION;
+  NewDisk->BlockIo.Media          = &NewDisk->Media;
+  NewDisk->BlockIo.Reset          = HostBlockReset;
+  NewDisk->BlockIo.ReadBlocks     = HostBlockRead;
+  NewDisk->BlockIo.WriteBlocks    = HostBlockWrite;
+  NewDisk->BlockIo.FlushBlocks    = HostBlockFlush;
+
+  NewDisk->DiskIo.Revision        = EFI_DISK_IO_PROTOCOL_REVISION;
+  NewDisk->DiskIo.ReadDisk        = HostDiskRead;
+  NewDisk->DiskIo.WriteDisk       = HostDiskWrite;
+
+  NewDisk->DiskIo2.Revision       = EFI_DISK_IO2_PROTOCOL_REVISION;
+  NewDisk->DiskIo2.Cancel         = HostDiskCancelEx;
+  NewDisk->DiskIo2.ReadDiskEx     = HostDiskReadEx;
+  NewDisk->DiskIo2.WriteDiskEx    = HostDiskWriteEx;
+  NewDisk->DiskIo2.FlushDiskEx    = HostDiskFlushEx;
+
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &NewDisk->Handle,
+                  &gEfiBlockIoProtocolGuid,
+                  &NewDisk->BlockIo,
+                  &gEfiDiskIoProtocolGuid,
+                  &NewDisk->DiskIo,
+                  NULL
+                  );
+  if (!EFI_ERROR (Status) && !Config->NoDiskIo2) {
+    Status = gBS->InstallMultipleProtocolInterfaces (
+                    &NewDisk->Handle,
+                    &gEfiDiskIo2ProtocolGuid,
+                    &NewDisk->DiskIo2,
+                    NULL
+                    );
+  }
+  if (EFI_ERROR (Status)) {
+    close (NewDisk->Fd);
+    free (NewDisk);
+    return Status;
+  }
+  InsertTailList (&mHostDisks, &NewDisk->Link);
+  *Disk = NewDisk;
+  return EFI_SUCCESS;
+}
+
+/**
+  Wait for the requests in flight, then uninstall the disk and close the
+  image.
+
+**/
+VOID
+HostDiskClose (
+  IN HOST_DISK  *Disk
+  )
+{
+  while (!IsListEmpty (&Disk->Queue)) {
+    HostDiskPoll ();
+  }
+  if (!Disk->Config.NoDiskIo2) {
+    gBS->UninstallMultipleProtocolInterfaces (Disk->Handle, &gEfiDiskIo2ProtocolGuid, &Disk->DiskIo2, NULL);
+  }
+  gBS->UninstallMultipleProtocolInterfaces (
+         Disk->Handle,
+         &gEfiBlockIoProtocolGuid,
+         &Disk->BlockIo,
+         &gEfiDiskIoProtocolGuid,
+         &Disk->DiskIo,
+         NULL
+         );
+  RemoveEntryList (&Disk->Link);
+  fsync (Disk->Fd);
+  close (Disk->Fd);
+  free (Disk);
+}
+
+EFI_HANDLE
+HostDiskHandle (
+  IN HOST_DISK  *Disk
+  )
+{
+  return Disk->Handle;
+}
+
+VOID
+HostDiskGetStats (
+  IN  HOST_DISK        *Disk,
+  OUT HOST_DISK_STATS  *Stats
+  )
+{
+  *Stats = Disk->Stats;
+}
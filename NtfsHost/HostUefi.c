@@ -0,0 +1,2115 @@
+/** @file
+  Host build: the boot services, runtime services and libraries the NTFS
+  driver links against in firmware.
+
+  Everything runs on the calling thread. The task priority level is a
+  variable: raising it defers the notification functions of the events
+  signaled meanwhile, restoring it runs them. Asynchronous disk requests
+  complete when the driver polls, see HostDisk.c, so the places where
+  firmware would take a timer interrupt are CheckEvent(), WaitForEvent(),
+  Stall() and RestoreTPL().
+
+**/
+
+#include "Host.h"
+
+#include <execinfo.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <x86intrin.h>
+#endif
+
+#define HOST_EVENT_SIGNATURE    SIGNATURE_32 ('h', 'e', 'v', 't')
+#define HOST_HANDLE_SIGNATURE   SIGNATURE_32 ('h', 'h', 'n', 'd')
+#define HOST_POOL_SIGNATURE     SIGNATURE_32 ('h', 'p', 'o', 'l')
+
+typedef struct {
+  UINT32            Signature;
+  UINT32            Type;
+  EFI_TPL           NotifyTpl;
+  EFI_EVENT_NOTIFY  NotifyFunction;
+  VOID              *NotifyContext;
+  BOOLEAN           Signaled;
+  BOOLEAN           NotifyQueued;
+  LIST_ENTRY        NotifyLink;
+} HOST_EVENT;
+
+typedef struct {
+  LIST_ENTRY        Link;
+  EFI_HANDLE        AgentHandle;
+  EFI_HANDLE        ControllerHandle;
+  UINT32            Attributes;
+} HOST_OPEN_ENTRY;
+
+typedef struct {
+  LIST_ENTRY        Link;
+  EFI_GUID          *Protocol;
+  VOID              *Interface;
+  LIST_ENTRY        OpenList;
+} HOST_PROTOCOL_ENTRY;
+
+typedef struct {
+  UINT32            Signature;
+  LIST_ENTRY        Link;
+  LIST_ENTRY        Protocols;
+} HOST_HANDLE;
+
+//
+// Live pool allocations are listed with their caller, so that a leak can
+// be told where it comes from
+//
+typedef struct {
+  UINT32            Signature;
+  UINT32            Reserved;
+  UINT64            Size;
+  LIST_ENTRY        Link;
+  UINT64            Sequence;
+  VOID              *Caller;
+} HOST_POOL_HEADER;
+
+//
+// GUIDs, AutoGen.c of the firmware build defines them
+//
+EFI_GUID gEfiBlockIoProtocolGuid              = EFI_BLOCK_IO_PROTOCOL_GUID;
+EFI_GUID gEfiDiskIoProtocolGuid               = EFI_DISK_IO_PROTOCOL_GUID;
+EFI_GUID gEfiDiskIo2ProtocolGuid              = EFI_DISK_IO2_PROTOCOL_GUID;
+EFI_GUID gEfiSimpleFileSystemProtocolGuid     = EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID;
+EFI_GUID gEfiUnicodeCollationProtocolGuid     = EFI_UNICODE_COLLATION_PROTOCOL_GUID;
+EFI_GUID gEfiUnicodeCollation2ProtocolGuid    = EFI_UNICODE_COLLATION_PROTOCOL2_GUID;
+EFI_GUID gEfiDriverBindingProtocolGuid        = EFI_DRIVER_BINDING_PROTOCOL_GUID;
+EFI_GUID gEfiComponentNameProtocolGuid        = { 0x107a772c, 0xd5e1, 0x11d4, { 0x9a, 0x46, 0x0, 0x90, 0x27, 0x3f, 0xc1, 0x4d } };
+EFI_GUID gEfiComponentName2ProtocolGuid       = { 0x6a7a5cff, 0xe8d9, 0x4f70, { 0xba, 0xda, 0x75, 0xab, 0x30, 0x25, 0xce, 0x14 } };
+EFI_GUID gEfiFileInfoGuid                     = EFI_FILE_INFO_ID;
+EFI_GUID gEfiFileSystemInfoGuid               = EFI_FILE_SYSTEM_INFO_ID;
+EFI_GUID gEfiFileSystemVolumeLabelInfoIdGuid  = EFI_FILE_SYSTEM_VOLUME_LABEL_ID;
+EFI_GUID gNtfsTraceProtocolGuid               = NTFS_TRACE_PROTOCOL_GUID;
+EFI_GUID gEfiCallerIdGuid                     = { 0xb6cd00a1, 0xc45b, 0x41f4, { 0x80, 0x58, 0xba, 0x6e, 0x5c, 0x04, 0x99, 0xb7 } };
+EFI_GUID gNtfsTokenSpaceGuid                  = { 0x9ee28053, 0x0371, 0x4a5b, { 0x90, 0xc5, 0xf2, 0xca, 0x71, 0x2c, 0xcf, 0x74 } };
+
+//
+// PCDs, with the defaults of MdePkg.dec and ntfs-3g.dec
+//
+HOST_PCD  gHostPcd = {
+  0,
+  0,
+  0,
+  0,
+  0,
+  "engfraengfra",
+  "en-US;fr-FR"
+};
+
+UINTN             gHostDebugLevel = DEBUG_ERROR;
+HOST_POOL_STATS   gHostPool;
+
+STATIC EFI_TPL    mHostTpl = TPL_APPLICATION;
+STATIC LIST_ENTRY mHostNotifyQueue = INITIALIZE_LIST_HEAD_VARIABLE (mHostNotifyQueue);
+STATIC LIST_ENTRY mHostHandles = INITIALIZE_LIST_HEAD_VARIABLE (mHostHandles);
+STATIC LIST_ENTRY mHostPoolList = INITIALIZE_LIST_HEAD_VARIABLE (mHostPoolList);
+STATIC UINT64     mHostPoolSequence;
+
+//
+// Memory allocation
+//
+
+STATIC
+VOID *
+HostAllocatePool (
+  IN UINTN  AllocationSize,
+  IN VOID   *Caller
+  )
+{
+  HOST_POOL_HEADER  *Header;
+
+  Header = malloc (sizeof (HOST_POOL_HEADER) + AllocationSize);
+  if (Header == NULL) {
+    return NULL;
+  }
+  Header->Signature = HOST_POOL_SIGNATURE;
+  Header->Size      = AllocationSize;
+  Header->Sequence  = mHostPoolSequence++;
+  Header->Caller    = Caller;
+  InsertTailList (&mHostPoolList, &Header->Link);
+  gHostPool.PoolAllocations++;
+  gHostPool.PoolBytes += AllocationSize;
+  return Header + 1;
+}
+
+VOID *
+EFIAPI
+AllocatePool (
+  IN UINTN  AllocationSize
+  )
+{
+  return HostAllocatePool (AllocationSize, __builtin_return_address (0));
+}
+
+VOID *
+EFIAPI
+AllocateZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  VOID  *Buffer;
+
+  Buffer = HostAllocatePool (AllocationSize, __builtin_return_address (0));
+  if (Buffer != NULL) {
+    memset (Buffer, 0, AllocationSize);
+  }
+  return Buffer;
+}
+
+VOID *
+EFIAPI
+AllocateCopyPool (
+  IN UINTN       AllocationSize,
+  IN CONST VOID  *Buffer
+  )
+{
+  VOID  *Copy;
+
+  ASSERT (Buffer != NULL);
+  Copy = HostAllocatePool (AllocationSize, __builtin_return_address (0));
+  if (Copy != NULL) {
+    memcpy (Copy, Buffer, AllocationSize);
+  }
+  return Copy;
+}
+
+VOID
+EFIAPI
+FreePool (
+  IN VOID  *Buffer
+  )
+{
+  HOST_POOL_HEADER  *Header;
+
+  ASSERT (Buffer != NULL);
+  Header = (HOST_POOL_HEADER *) Buffer - 1;
+  ASSERT (Header->Signature == HOST_POOL_SIGNATURE);
+  Header->Signature = 0;
+  RemoveEntryList (&Header->Link);
+  gHostPool.PoolAllocations--;
+  gHostPool.PoolBytes -= Header->Size;
+  free (Header);
+}
+
+VOID *
+EFIAPI
+ReallocatePool (
+  IN UINTN  OldSize,
+  IN UINTN  NewSize,
+  IN VOID   *OldBuffer  OPTIONAL
+  )
+{
+  VOID  *NewBuffer;
+
+  NewBuffer = HostAllocatePool (NewSize, __builtin_return_address (0));
+  if (NewBuffer != NULL) {
+    memset (NewBuffer, 0, NewSize);
+  }
+  if (NewBuffer != NULL && OldBuffer != NULL) {
+    memcpy (NewBuffer, OldBuffer, MIN (OldSize, NewSize));
+    FreePool (OldBuffer);
+  }
+  return NewBuffer;
+}
+
+/**
+  Return a mark, the pool allocations made after it are those HostPoolDump()
+  reports.
+
+**/
+UINT64
+HostPoolMark (
+  VOID
+  )
+{
+  return mHostPoolSequence;
+}
+
+/**
+  Print the live pool allocations made since Mark, with their callers.
+
+**/
+VOID
+HostPoolDump (
+  IN UINT64  Mark
+  )
+{
+  LIST_ENTRY        *Link;
+  HOST_POOL_HEADER  *Header;
+
+  for (Link = GetFirstNode (&mHostPoolList); !IsNull (&mHostPoolList, Link); Link = GetNextNode (&mHostPoolList, Link)) {
+    Header = BASE_CR (Link, HOST_POOL_HEADER, Link);
+    if (Header->Sequence >= Mark) {
+      fprintf (stderr, "  %6llu bytes from ", Header->Size);
+      backtrace_symbols_fd (&Header->Caller, 1, 2);
+    }
+  }
+}
+
+VOID *
+EFIAPI
+AllocateAlignedPages (
+  IN UINTN  Pages,
+  IN UINTN  Alignment
+  )
+{
+  VOID  *Buffer;
+
+  if (Pages == 0) {
+    return NULL;
+  }
+  if (Alignment < EFI_PAGE_SIZE) {
+    Alignment = EFI_PAGE_SIZE;
+  }
+  Buffer = aligned_alloc (Alignment, EFI_PAGES_TO_SIZE (Pages));
+  if (Buffer != NULL) {
+    gHostPool.PageAllocations++;
+    gHostPool.Pages += Pages;
+  }
+  return Buffer;
+}
+
+VOID
+EFIAPI
+FreeAlignedPages (
+  IN VOID   *Buffer,
+  IN UINTN  Pages
+  )
+{
+  ASSERT (Buffer != NULL);
+  gHostPool.PageAllocations--;
+  gHostPool.Pages -= Pages;
+  free (Buffer);
+}
+
+VOID *
+EFIAPI
+AllocatePages (
+  IN UINTN  Pages
+  )
+{
+  return AllocateAlignedPages (Pages, EFI_PAGE_SIZE);
+}
+
+VOID
+EFIAPI
+FreePages (
+  IN VOID   *Buffer,
+  IN UINTN  Pages
+  )
+{
+  FreeAlignedPages (Buffer, Pages);
+}
+
+//
+// BaseMemoryLib
+//
+
+VOID *
+EFIAPI
+CopyMem (
+  OUT VOID       *DestinationBuffer,
+  IN CONST VOID  *SourceBuffer,
+  IN UINTN       Length
+  )
+{
+  return memmove (DestinationBuffer, SourceBuffer, Length);
+}
+
+VOID *
+EFIAPI
+SetMem (
+  OUT VOID  *Buffer,
+  IN UINTN  Length,
+  IN UINT8  Value
+  )
+{
+  return memset (Buffer, Value, Length);
+}
+
+VOID *
+EFIAPI
+ZeroMem (
+  OUT VOID  *Buffer,
+  IN UINTN  Length
+  )
+{
+  return memset (Buffer, 0, Length);
+}
+
+INTN
+EFIAPI
+CompareMem (
+  IN CONST VOID  *DestinationBuffer,
+  IN CONST VOID  *SourceBuffer,
+  IN UINTN       Length
+  )
+{
+  return memcmp (DestinationBuffer, SourceBuffer, Length);
+}
+
+BOOLEAN
+EFIAPI
+CompareGuid (
+  IN CONST GUID  *Guid1,
+  IN CONST GUID  *Guid2
+  )
+{
+  return (BOOLEAN) (memcmp (Guid1, Guid2, sizeof (GUID)) == 0);
+}
+
+//
+// BaseLib
+//
+
+UINTN
+EFIAPI
+StrLen (
+  IN CONST CHAR16  *String
+  )
+{
+  UINTN  Length;
+
+  ASSERT (String != NULL);
+  for (Length = 0; String[Length] != 0; Length++) {
+  }
+  return Length;
+}
+
+UINTN
+EFIAPI
+StrSize (
+  IN CONST CHAR16  *String
+  )
+{
+  return (StrLen (String) + 1) * sizeof (CHAR16);
+}
+
+INTN
+EFIAPI
+StrCmp (
+  IN CONST CHAR16  *FirstString,
+  IN CONST CHAR16  *SecondString
+  )
+{
+  while (*FirstString != 0 && *FirstString == *SecondString) {
+    FirstString++;
+    SecondString++;
+  }
+  return *FirstString - *SecondString;
+}
+
+INTN
+EFIAPI
+StrnCmp (
+  IN CONST CHAR16  *FirstString,
+  IN CONST CHAR16  *SecondString,
+  IN UINTN         Length
+  )
+{
+  if (Length == 0) {
+    return 0;
+  }
+  while (*FirstString != 0 && *FirstString == *SecondString && Length > 1) {
+    FirstString++;
+    SecondString++;
+    Length--;
+  }
+  return *FirstString - *SecondString;
+}
+
+CHAR16 *
+EFIAPI
+StrCpy (
+  OUT CHAR16        *Destination,
+  IN CONST CHAR16   *Source
+  )
+{
+  CHAR16  *Return;
+
+  Return = Destination;
+  while (*Source != 0) {
+    *(Destination++) = *(Source++);
+  }
+  *Destination = 0;
+  return Return;
+}
+
+UINTN
+EFIAPI
+AsciiStrLen (
+  IN CONST CHAR8  *String
+  )
+{
+  return strlen (String);
+}
+
+UINTN
+EFIAPI
+AsciiStrSize (
+  IN CONST CHAR8  *String
+  )
+{
+  return strlen (String) + 1;
+}
+
+INTN
+EFIAPI
+AsciiStrCmp (
+  IN CONST CHAR8  *FirstString,
+  IN CONST CHAR8  *SecondString
+  )
+{
+  return strcmp (FirstString, SecondString);
+}
+
+INTN
+EFIAPI
+AsciiStrnCmp (
+  IN CONST CHAR8  *FirstString,
+  IN CONST CHAR8  *SecondString,
+  IN UINTN        Length
+  )
+{
+  return strncmp (FirstString, SecondString, Length);
+}
+
+/**
+  The driver is built with -fshort-wchar like the firmware, so its wide
+  strings are UCS-2 and the wcs functions of the host C library, which
+  work on 32-bit characters, can not be used. This one overrides it.
+
+**/
+wchar_t *
+wcsrchr (
+  const wchar_t  *String,
+  wchar_t        Char
+  )
+{
+  const wchar_t  *Last;
+
+  Last = NULL;
+  do {
+    if (*String == Char) {
+      Last = String;
+    }
+  } while (*(String++) != 0);
+  return (wchar_t *) Last;
+}
+
+size_t
+wcslen (
+  const wchar_t  *String
+  )
+{
+  return StrLen ((CONST CHAR16 *) String);
+}
+
+LIST_ENTRY *
+EFIAPI
+InitializeListHead (
+  IN OUT LIST_ENTRY  *ListHead
+  )
+{
+  ListHead->ForwardLink = ListHead;
+  ListHead->BackLink    = ListHead;
+  return ListHead;
+}
+
+LIST_ENTRY *
+EFIAPI
+InsertHeadList (
+  IN OUT LIST_ENTRY  *ListHead,
+  IN OUT LIST_ENTRY  *Entry
+  )
+{
+  Entry->ForwardLink            = ListHead->ForwardLink;
+  Entry->BackLink               = ListHead;
+  Entry->ForwardLink->BackLink  = Entry;
+  ListHead->ForwardLink         = Entry;
+  return ListHead;
+}
+
+LIST_ENTRY *
+EFIAPI
+InsertTailList (
+  IN OUT LIST_ENTRY  *ListHead,
+  IN OUT LIST_ENTRY  *Entry
+  )
+{
+  Entry->ForwardLink            = ListHead;
+  Entry->BackLink               = ListHead->BackLink;
+  Entry->BackLink->ForwardLink  = Entry;
+  ListHead->BackLink            = Entry;
+  return ListHead;
+}
+
+LIST_ENTRY *
+EFIAPI
+GetFirstNode (
+  IN CONST LIST_ENTRY  *List
+  )
+{
+  return List->ForwardLink;
+}
+
+LIST_ENTRY *
+EFIAPI
+GetNextNode (
+  IN CONST LIST_ENTRY  *List,
+  IN CONST LIST_ENTRY  *Node
+  )
+{
+  return Node->ForwardLink;
+}
+
+BOOLEAN
+EFIAPI
+IsListEmpty (
+  IN CONST LIST_ENTRY  *ListHead
+  )
+{
+  return (BOOLEAN) (ListHead->ForwardLink == ListHead);
+}
+
+BOOLEAN
+EFIAPI
+IsNull (
+  IN CONST LIST_ENTRY  *List,
+  IN CONST LIST_ENTRY  *Node
+  )
+{
+  return (BOOLEAN) (Node == List);
+}
+
+LIST_ENTRY *
+EFIAPI
+RemoveEntryList (
+  IN CONST LIST_ENTRY  *Entry
+  )
+{
+  ASSERT (Entry->ForwardLink != Entry);
+  Entry->ForwardLink->BackLink = Entry->BackLink;
+  Entry->BackLink->ForwardLink = Entry->ForwardLink;
+  return Entry->ForwardLink;
+}
+
+UINT64
+EFIAPI
+LShiftU64 (
+  IN UINT64  Operand,
+  IN UINTN   Count
+  )
+{
+  return Operand << Count;
+}
+
+UINT64
+EFIAPI
+RShiftU64 (
+  IN UINT64  Operand,
+  IN UINTN   Count
+  )
+{
+  return Operand >> Count;
+}
+
+UINT64
+EFIAPI
+MultU64x32 (
+  IN UINT64  Multiplicand,
+  IN UINT32  Multiplier
+  )
+{
+  return Multiplicand * Multiplier;
+}
+
+UINT64
+EFIAPI
+DivU64x32 (
+  IN UINT64  Dividend,
+  IN UINT32  Divisor
+  )
+{
+  return Dividend / Divisor;
+}
+
+UINT64
+HostNanoseconds (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  clock_gettime (CLOCK_MONOTONIC, &Now);
+  return (UINT64) Now.tv_sec * 1000000000ULL + Now.tv_nsec;
+}
+
+UINT64
+EFIAPI
+AsmReadTsc (
+  VOID
+  )
+{
+#if defined (__x86_64__) || defined (__i386__)
+  return __rdtsc ();
+#else
+  return HostNanoseconds ();
+#endif
+}
+
+VOID
+EFIAPI
+CpuPause (
+  VOID
+  )
+{
+}
+
+//
+// Formatted output. The driver uses the edk2 PrintLib conventions:
+// %a is an ASCII string, %s a UCS-2 one, %r an EFI_STATUS, %g a GUID
+// and the l flag means 64 bits.
+//
+
+STATIC CONST CHAR8  *mStatusNames[] = {
+  "Success",                  "Load Error",               "Invalid Parameter",
+  "Unsupported",              "Bad Buffer Size",          "Buffer Too Small",
+  "Not Ready",                "Device Error",             "Write Protected",
+  "Out of Resources",         "Volume Corrupt",           "Volume Full",
+  "No Media",                 "Media changed",            "Not Found",
+  "Access Denied",            "No Response",              "No mapping",
+  "Time out",                 "Not started",              "Already started",
+  "Aborted",                  "ICMP Error",               "TFTP Error",
+  "Protocol Error",           "Incompatible Version",     "Security Violation",
+  "CRC Error",                "End of Media",             "Reserved (29)",
+  "Reserved (30)",            "End of File"
+};
+
+CONST CHAR8 *
+HostStatusName (
+  IN EFI_STATUS  Status
+  )
+{
+  UINTN  Code;
+
+  Code = (UINTN) (Status & ~MAX_BIT);
+  if (Code < ARRAY_SIZE (mStatusNames)) {
+    return mStatusNames[Code];
+  }
+  return "Unknown";
+}
+
+STATIC
+VOID
+HostVPrint (
+  IN FILE         *Stream,
+  IN CONST CHAR8  *Format,
+  IN VA_LIST      Marker
+  )
+{
+  CHAR8         Spec[32];
+  UINTN         SpecLength;
+  BOOLEAN       Long;
+  CONST CHAR16  *Unicode;
+  CONST CHAR8   *Ascii;
+  GUID          *Guid;
+
+  for ( ; *Format != 0; Format++) {
+    if (*Format != '%') {
+      fputc (*Format, Stream);
+      continue;
+    }
+    SpecLength = 0;
+    Spec[SpecLength++] = '%';
+    Format++;
+    while (strchr ("-+ #0123456789.*", *Format) != NULL && *Format != 0 && SpecLength < sizeof (Spec) - 4) {
+      if (*Format == '*') {
+        SpecLength += snprintf (&Spec[SpecLength], sizeof (Spec) - SpecLength - 3, "%d", (int) VA_ARG (Marker, UINTN));
+      } else {
+        Spec[SpecLength++] = *Format;
+      }
+      Format++;
+    }
+    Long = FALSE;
+    while (*Format == 'l' || *Format == 'L') {
+      Long = TRUE;
+      Format++;
+    }
+    switch (*Format) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'x':
+    case 'X':
+      Spec[SpecLength++] = 'l';
+      Spec[SpecLength++] = 'l';
+      Spec[SpecLength++] = *Format;
+      Spec[SpecLength]   = 0;
+      if (Long) {
+        fprintf (Stream, Spec, VA_ARG (Marker, UINT64));
+      } else if (*Format == 'd' || *Format == 'i') {
+        fprintf (Stream, Spec, (INT64) VA_ARG (Marker, int));
+      } else {
+        fprintf (Stream, Spec, (UINT64) VA_ARG (Marker, unsigned int));
+      }
+      break;
+    case 'p':
+      fprintf (Stream, "%p", VA_ARG (Marker, VOID *));
+      break;
+    case 'c':
+      fputc ((int) VA_ARG (Marker, UINTN), Stream);
+      break;
+    case 'a':
+      Ascii = VA_ARG (Marker, CONST CHAR8 *);
+      Spec[SpecLength++] = 's';
+      Spec[SpecLength]   = 0;
+      fprintf (Stream, Spec, Ascii == NULL ? "<null string>" : Ascii);
+      break;
+    case 's':
+    case 'S':
+      Unicode = VA_ARG (Marker, CONST CHAR16 *);
+      if (Unicode == NULL) {
+        fputs ("<null string>", Stream);
+      }
+      while (Unicode != NULL && *Unicode != 0) {
+        fputc (*Unicode < 0x80 ? (int) *Unicode : '?', Stream);
+        Unicode++;
+      }
+      break;
+    case 'r':
+      fputs (HostStatusName (VA_ARG (Marker, EFI_STATUS)), Stream);
+      break;
+    case 'g':
+      Guid = VA_ARG (Marker, GUID *);
+      fprintf (
+        Stream,
+        "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+        Guid->Data1,
+        Guid->Data2,
+        Guid->Data3,
+        Guid->Data4[0],
+        Guid->Data4[1],
+        Guid->Data4[2],
+        Guid->Data4[3],
+        Guid->Data4[4],
+        Guid->Data4[5],
+        Guid->Data4[6],
+        Guid->Data4[7]
+        );
+      break;
+    case '%':
+      fputc ('%', Stream);
+      break;
+    case 0:
+      return;
+    default:
+      fputc ('%', Stream);
+      fputc (*Format, Stream);
+      break;
+    }
+  }
+}
+
+UINTN
+EFIAPI
+AsciiPrint (
+  IN CONST CHAR8  *Format,
+  ...
+  )
+{
+  VA_LIST  Marker;
+
+  VA_START (Marker, Format);
+  HostVPrint (stdout, Format, Marker);
+  VA_END (Marker);
+  return 0;
+}
+
+UINTN
+EFIAPI
+Print (
+  IN CONST CHAR16  *Format,
+  ...
+  )
+{
+  CHAR8    Ascii[512];
+  UINTN    Index;
+  VA_LIST  Marker;
+
+  for (Index = 0; Format[Index] != 0 && Index < sizeof (Ascii) - 1; Index++) {
+    Ascii[Index] = (CHAR8) Format[Index];
+  }
+  Ascii[Index] = 0;
+  VA_START (Marker, Format);
+  HostVPrint (stdout, Ascii, Marker);
+  VA_END (Marker);
+  return 0;
+}
+
+VOID
+EFIAPI
+DebugPrint (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  )
+{
+  VA_LIST  Marker;
+
+  if ((ErrorLevel & gHostDebugLevel) == 0) {
+    return;
+  }
+  VA_START (Marker, Format);
+  HostVPrint (stderr, Format, Marker);
+  VA_END (Marker);
+}
+
+VOID
+EFIAPI
+DebugAssert (
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber,
+  IN CONST CHAR8  *Description
+  )
+{
+  VOID  *Frames[32];
+
+  fprintf (stderr, "ASSERT %s(%llu): %s\n", FileName, LineNumber, Description);
+  backtrace_symbols_fd (Frames, backtrace (Frames, ARRAY_SIZE (Frames)), 2);
+  abort ();
+}
+
+VOID *
+EFIAPI
+DebugCheckRecord (
+  IN VOID         *Record,
+  IN BOOLEAN      SignatureMatches,
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber
+  )
+{
+  if (!SignatureMatches) {
+    DebugAssert (FileName, LineNumber, "CR has Bad Signature");
+  }
+  return Record;
+}
+
+//
+// Task priority levels and events
+//
+
+STATIC
+VOID
+HostDispatchNotifies (
+  IN EFI_TPL  Tpl
+  )
+{
+  LIST_ENTRY  *Link;
+  HOST_EVENT  *Event;
+
+  //
+  // Highest priority first, each notification runs at its own TPL
+  //
+  for (;;) {
+    Event = NULL;
+    for (Link = GetFirstNode (&mHostNotifyQueue); !IsNull (&mHostNotifyQueue, Link); Link = GetNextNode (&mHostNotifyQueue, Link)) {
+      HOST_EVENT  *Candidate;
+
+      Candidate = BASE_CR (Link, HOST_EVENT, NotifyLink);
+      if (Candidate->NotifyTpl > Tpl && (Event == NULL || Candidate->NotifyTpl > Event->NotifyTpl)) {
+        Event = Candidate;
+      }
+    }
+    if (Event == NULL) {
+      return;
+    }
+    RemoveEntryList (&Event->NotifyLink);
+    Event->NotifyQueued = FALSE;
+    if ((Event->Type & EVT_NOTIFY_SIGNAL) != 0) {
+      Event->Signaled = FALSE;
+    }
+    mHostTpl = Event->NotifyTpl;
+    Event->NotifyFunction (Event, Event->NotifyContext);
+    mHostTpl = Tpl;
+  }
+}
+
+STATIC
+EFI_TPL
+EFIAPI
+HostRaiseTpl (
+  IN EFI_TPL  NewTpl
+  )
+{
+  EFI_TPL  OldTpl;
+
+  OldTpl = mHostTpl;
+  if (NewTpl < OldTpl) {
+    DebugAssert (__FILE__, __LINE__, "RaiseTPL to a lower TPL");
+  }
+  mHostTpl = NewTpl;
+  return OldTpl;
+}
+
+STATIC
+VOID
+EFIAPI
+HostRestoreTpl (
+  IN EFI_TPL  OldTpl
+  )
+{
+  if (OldTpl > mHostTpl) {
+    DebugAssert (__FILE__, __LINE__, "RestoreTPL to a higher TPL");
+  }
+  HostDiskPoll ();
+  HostDispatchNotifies (OldTpl);
+  mHostTpl = OldTpl;
+}
+
+EFI_TPL
+HostCurrentTpl (
+  VOID
+  )
+{
+  return mHostTpl;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostCreateEvent (
+  IN  UINT32            Type,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction,
+  IN  VOID              *NotifyContext,
+  OUT EFI_EVENT         *Event
+  )
+{
+  HOST_EVENT  *NewEvent;
+
+  if (Event == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if ((Type & (EVT_NOTIFY_SIGNAL | EVT_NOTIFY_WAIT)) != 0) {
+    if (NotifyFunction == NULL || NotifyTpl <= TPL_APPLICATION || NotifyTpl >= TPL_HIGH_LEVEL) {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+  NewEvent = calloc (1, sizeof (HOST_EVENT));
+  if (NewEvent == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  gHostPool.Events++;
+  NewEvent->Signature      = HOST_EVENT_SIGNATURE;
+  NewEvent->Type           = Type;
+  NewEvent->NotifyTpl      = NotifyTpl;
+  NewEvent->NotifyFunction = NotifyFunction;
+  NewEvent->NotifyContext  = NotifyContext;
+  *Event = NewEvent;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostSignalEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  HOST_EVENT  *HostEvent;
+
+  HostEvent = Event;
+  if (HostEvent == NULL || HostEvent->Signature != HOST_EVENT_SIGNATURE) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (HostEvent->Signaled) {
+    return EFI_SUCCESS;
+  }
+  HostEvent->Signaled = TRUE;
+  if ((HostEvent->Type & EVT_NOTIFY_SIGNAL) != 0 && !HostEvent->NotifyQueued) {
+    HostEvent->NotifyQueued = TRUE;
+    InsertTailList (&mHostNotifyQueue, &HostEvent->NotifyLink);
+    HostDispatchNotifies (mHostTpl);
+  }
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostCloseEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  HOST_EVENT  *HostEvent;
+
+  HostEvent = Event;
+  if (HostEvent == NULL || HostEvent->Signature != HOST_EVENT_SIGNATURE) {
+    return EFI_INVALID_PARAMETER;
+  }
+  //
+  // Closing an event a disk request still has to signal is a driver bug
+  //
+  if (HostDiskEventInUse (Event)) {
+    DebugAssert (__FILE__, __LINE__, "CloseEvent of the event of a pending disk request");
+  }
+  if (HostEvent->NotifyQueued) {
+    RemoveEntryList (&HostEvent->NotifyLink);
+  }
+  HostEvent->Signature = 0;
+  gHostPool.Events--;
+  free (HostEvent);
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostCheckEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  HOST_EVENT  *HostEvent;
+  EFI_TPL     OldTpl;
+
+  HostEvent = Event;
+  if (HostEvent == NULL || HostEvent->Signature != HOST_EVENT_SIGNATURE) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if ((HostEvent->Type & EVT_NOTIFY_SIGNAL) != 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+  HostDiskPoll ();
+  if (!HostEvent->Signaled && (HostEvent->Type & EVT_NOTIFY_WAIT) != 0) {
+    OldTpl = HostRaiseTpl (HostEvent->NotifyTpl);
+    HostEvent->NotifyFunction (HostEvent, HostEvent->NotifyContext);
+    HostRestoreTpl (OldTpl);
+  }
+  if (HostEvent->Signaled) {
+    HostEvent->Signaled = FALSE;
+    return EFI_SUCCESS;
+  }
+  return EFI_NOT_READY;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostWaitForEvent (
+  IN  UINTN      NumberOfEvents,
+  IN  EFI_EVENT  *Event,
+  OUT UINTN      *Index
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       EventIndex;
+
+  if (NumberOfEvents == 0 || Event == NULL || Index == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (mHostTpl != TPL_APPLICATION) {
+    return EFI_UNSUPPORTED;
+  }
+  for (;;) {
+    for (EventIndex = 0; EventIndex < NumberOfEvents; EventIndex++) {
+      Status = HostCheckEvent (Event[EventIndex]);
+      if (Status != EFI_NOT_READY) {
+        *Index = EventIndex;
+        return Status;
+      }
+    }
+    if (!HostDiskBusy ()) {
+      //
+      // Nothing can signal the events any more
+      //
+      DebugAssert (__FILE__, __LINE__, "WaitForEvent would wait forever");
+    }
+  }
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostStall (
+  IN UINTN  Microseconds
+  )
+{
+  UINT64  Deadline;
+
+  Deadline = HostNanoseconds () + Microseconds * 1000ULL;
+  do {
+    HostDiskPoll ();
+  } while (HostNanoseconds () < Deadline);
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostSetTimer (
+  IN EFI_EVENT        Event,
+  IN EFI_TIMER_DELAY  Type,
+  IN UINT64           TriggerTime
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+//
+// EFI_LOCK
+//
+
+EFI_LOCK *
+EFIAPI
+EfiInitializeLock (
+  IN OUT EFI_LOCK  *Lock,
+  IN EFI_TPL       Priority
+  )
+{
+  Lock->Tpl      = Priority;
+  Lock->OwnerTpl = TPL_APPLICATION;
+  Lock->Lock     = EfiLockReleased;
+  return Lock;
+}
+
+VOID
+EFIAPI
+EfiAcquireLock (
+  IN EFI_LOCK  *Lock
+  )
+{
+  ASSERT (Lock->Lock == EfiLockReleased);
+  Lock->OwnerTpl = HostRaiseTpl (Lock->Tpl);
+  Lock->Lock     = EfiLockAcquired;
+}
+
+EFI_STATUS
+EFIAPI
+EfiAcquireLockOrFail (
+  IN EFI_LOCK  *Lock
+  )
+{
+  ASSERT (Lock->Lock != EfiLockUninitialized);
+  if (Lock->Lock == EfiLockAcquired) {
+    return EFI_ACCESS_DENIED;
+  }
+  Lock->OwnerTpl = HostRaiseTpl (Lock->Tpl);
+  Lock->Lock     = EfiLockAcquired;
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+EfiReleaseLock (
+  IN EFI_LOCK  *Lock
+  )
+{
+  EFI_TPL  Tpl;
+
+  ASSERT (Lock->Lock == EfiLockAcquired);
+  Tpl        = Lock->OwnerTpl;
+  Lock->Lock = EfiLockReleased;
+  HostRestoreTpl (Tpl);
+}
+
+//
+// Handle database
+//
+
+STATIC
+HOST_HANDLE *
+HostFindHandle (
+  IN EFI_HANDLE  Handle
+  )
+{
+  HOST_HANDLE  *HostHandle;
+
+  HostHandle = Handle;
+  if (HostHandle == NULL || HostHandle->Signature != HOST_HANDLE_SIGNATURE) {
+    return NULL;
+  }
+  return HostHandle;
+}
+
+STATIC
+HOST_PROTOCOL_ENTRY *
+HostFindProtocol (
+  IN HOST_HANDLE  *Handle,
+  IN EFI_GUID     *Protocol
+  )
+{
+  LIST_ENTRY           *Link;
+  HOST_PROTOCOL_ENTRY  *Entry;
+
+  for (Link = GetFirstNode (&Handle->Protocols); !IsNull (&Handle->Protocols, Link); Link = GetNextNode (&Handle->Protocols, Link)) {
+    Entry = BASE_CR (Link, HOST_PROTOCOL_ENTRY, Link);
+    if (CompareGuid (Entry->Protocol, Protocol)) {
+      return Entry;
+    }
+  }
+  return NULL;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostInstallProtocolInterface (
+  IN OUT EFI_HANDLE          *Handle,
+  IN     EFI_GUID            *Protocol,
+  IN     EFI_INTERFACE_TYPE  InterfaceType,
+  IN     VOID                *Interface
+  )
+{
+  HOST_HANDLE          *HostHandle;
+  HOST_PROTOCOL_ENTRY  *Entry;
+
+  if (Handle == NULL || Protocol == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (*Handle == NULL) {
+    HostHandle = calloc (1, sizeof (HOST_HANDLE));
+    if (HostHandle == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    HostHandle->Signature = HOST_HANDLE_SIGNATURE;
+    InitializeListHead (&HostHandle->Protocols);
+    InsertTailList (&mHostHandles, &HostHandle->Link);
+    *Handle = HostHandle;
+  } else {
+    HostHandle = HostFindHandle (*Handle);
+    if (HostHandle == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+    if (HostFindProtocol (HostHandle, Protocol) != NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+  Entry = calloc (1, sizeof (HOST_PROTOCOL_ENTRY));
+  if (Entry == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Entry->Protocol  = Protocol;
+  Entry->Interface = Interface;
+  InitializeListHead (&Entry->OpenList);
+  InsertTailList (&HostHandle->Protocols, &Entry->Link);
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostUninstallProtocolInterface (
+  IN EFI_HANDLE  Handle,
+  IN EFI_GUID    *Protocol,
+  IN VOID        *Interface
+  )
+{
+  HOST_HANDLE          *HostHandle;
+  HOST_PROTOCOL_ENTRY  *Entry;
+  HOST_OPEN_ENTRY      *Open;
+
+  HostHandle = HostFindHandle (Handle);
+  if (HostHandle == NULL || Protocol == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Entry = HostFindProtocol (HostHandle, Protocol);
+  if (Entry == NULL || Entry->Interface != Interface) {
+    return EFI_NOT_FOUND;
+  }
+  //
+  // Drivers which opened the protocol BY_DRIVER would be stopped first by
+  // the firmware, the harness never has any
+  //
+  while (!IsListEmpty (&Entry->OpenList)) {
+    Open = BASE_CR (GetFirstNode (&Entry->OpenList), HOST_OPEN_ENTRY, Link);
+    if ((Open->Attributes & (EFI_OPEN_PROTOCOL_BY_DRIVER | EFI_OPEN_PROTOCOL_EXCLUSIVE)) != 0) {
+      return EFI_ACCESS_DENIED;
+    }
+    RemoveEntryList (&Open->Link);
+    free (Open);
+  }
+  RemoveEntryList (&Entry->Link);
+  free (Entry);
+  if (IsListEmpty (&HostHandle->Protocols)) {
+    RemoveEntryList (&HostHandle->Link);
+    HostHandle->Signature = 0;
+    free (HostHandle);
+  }
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostInstallMultipleProtocolInterfaces (
+  IN OUT EFI_HANDLE  *Handle,
+  ...
+  )
+{
+  VA_LIST     Marker;
+  EFI_GUID    *Protocol;
+  VOID        *Interface;
+  EFI_STATUS  Status;
+
+  Status = EFI_SUCCESS;
+  VA_START (Marker, Handle);
+  for (Protocol = VA_ARG (Marker, EFI_GUID *); Protocol != NULL; Protocol = VA_ARG (Marker, EFI_GUID *)) {
+    Interface = VA_ARG (Marker, VOID *);
+    Status = HostInstallProtocolInterface (Handle, Protocol, EFI_NATIVE_INTERFACE, Interface);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+  VA_END (Marker);
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostUninstallMultipleProtocolInterfaces (
+  IN EFI_HANDLE  Handle,
+  ...
+  )
+{
+  VA_LIST     Marker;
+  EFI_GUID    *Protocol;
+  VOID        *Interface;
+  EFI_STATUS  Status;
+
+  Status = EFI_SUCCESS;
+  VA_START (Marker, Handle);
+  for (Protocol = VA_ARG (Marker, EFI_GUID *); Protocol != NULL; Protocol = VA_ARG (Marker, EFI_GUID *)) {
+    Interface = VA_ARG (Marker, VOID *);
+    Status = HostUninstallProtocolInterface (Handle, Protocol, Interface);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+  VA_END (Marker);
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostHandleProtocol (
+  IN  EFI_HANDLE  Handle,
+  IN  EFI_GUID    *Protocol,
+  OUT VOID        **Interface
+  )
+{
+  HOST_HANDLE          *HostHandle;
+  HOST_PROTOCOL_ENTRY  *Entry;
+
+  HostHandle = HostFindHandle (Handle);
+  if (HostHandle == NULL || Protocol == NULL || Interface == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Entry = HostFindProtocol (HostHandle, Protocol);
+  if (Entry == NULL) {
+    *Interface = NULL;
+    return EFI_UNSUPPORTED;
+  }
+  *Interface = Entry->Interface;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostOpenProtocol (
+  IN  EFI_HANDLE  Handle,
+  IN  EFI_GUID    *Protocol,
+  OUT VOID        **Interface,
+  IN  EFI_HANDLE  AgentHandle,
+  IN  EFI_HANDLE  ControllerHandle,
+  IN  UINT32      Attributes
+  )
+{
+  HOST_HANDLE          *HostHandle;
+  HOST_PROTOCOL_ENTRY  *Entry;
+  HOST_OPEN_ENTRY      *Open;
+  LIST_ENTRY           *Link;
+
+  HostHandle = HostFindHandle (Handle);
+  if (HostHandle == NULL || Protocol == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (Interface == NULL && Attributes != EFI_OPEN_PROTOCOL_TEST_PROTOCOL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Entry = HostFindProtocol (HostHandle, Protocol);
+  if (Entry == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+  if (Attributes == EFI_OPEN_PROTOCOL_TEST_PROTOCOL) {
+    return EFI_SUCCESS;
+  }
+  if ((Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) != 0) {
+    for (Link = GetFirstNode (&Entry->OpenList); !IsNull (&Entry->OpenList, Link); Link = GetNextNode (&Entry->OpenList, Link)) {
+      Open = BASE_CR (Link, HOST_OPEN_ENTRY, Link);
+      if ((Open->Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) != 0) {
+        *Interface = Entry->Interface;
+        return Open->AgentHandle == AgentHandle ? EFI_ALREADY_STARTED : EFI_ACCESS_DENIED;
+      }
+    }
+  }
+  Open = calloc (1, sizeof (HOST_OPEN_ENTRY));
+  if (Open == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Open->AgentHandle      = AgentHandle;
+  Open->ControllerHandle = ControllerHandle;
+  Open->Attributes       = Attributes;
+  InsertTailList (&Entry->OpenList, &Open->Link);
+  *Interface = Entry->Interface;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostCloseProtocol (
+  IN EFI_HANDLE  Handle,
+  IN EFI_GUID    *Protocol,
+  IN EFI_HANDLE  AgentHandle,
+  IN EFI_HANDLE  ControllerHandle
+  )
+{
+  HOST_HANDLE          *HostHandle;
+  HOST_PROTOCOL_ENTRY  *Entry;
+  HOST_OPEN_ENTRY      *Open;
+  LIST_ENTRY           *Link;
+  EFI_STATUS           Status;
+
+  HostHandle = HostFindHandle (Handle);
+  if (HostHandle == NULL || Protocol == NULL || AgentHandle == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Entry = HostFindProtocol (HostHandle, Protocol);
+  if (Entry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+  Status = EFI_NOT_FOUND;
+  Link   = GetFirstNode (&Entry->OpenList);
+  while (!IsNull (&Entry->OpenList, Link)) {
+    Open = BASE_CR (Link, HOST_OPEN_ENTRY, Link);
+    Link = GetNextNode (&Entry->OpenList, Link);
+    if (Open->AgentHandle == AgentHandle && Open->ControllerHandle == ControllerHandle) {
+      RemoveEntryList (&Open->Link);
+      free (Open);
+      Status = EFI_SUCCESS;
+    }
+  }
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostLocateHandleBuffer (
+  IN  EFI_LOCATE_SEARCH_TYPE  SearchType,
+  IN  EFI_GUID                *Protocol,
+  IN  VOID                    *SearchKey,
+  OUT UINTN                   *NoHandles,
+  OUT EFI_HANDLE              **Buffer
+  )
+{
+  LIST_ENTRY   *Link;
+  HOST_HANDLE  *HostHandle;
+  UINTN        Count;
+
+  if (NoHandles == NULL || Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (SearchType != AllHandles && (SearchType != ByProtocol || Protocol == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  *Buffer    = NULL;
+  *NoHandles = 0;
+  Count      = 0;
+  for (Link = GetFirstNode (&mHostHandles); !IsNull (&mHostHandles, Link); Link = GetNextNode (&mHostHandles, Link)) {
+    Count++;
+  }
+  if (Count == 0) {
+    return EFI_NOT_FOUND;
+  }
+  *Buffer = AllocatePool (Count * sizeof (EFI_HANDLE));
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  for (Link = GetFirstNode (&mHostHandles); !IsNull (&mHostHandles, Link); Link = GetNextNode (&mHostHandles, Link)) {
+    HostHandle = BASE_CR (Link, HOST_HANDLE, Link);
+    if (SearchType == AllHandles || HostFindProtocol (HostHandle, Protocol) != NULL) {
+      (*Buffer)[(*NoHandles)++] = HostHandle;
+    }
+  }
+  if (*NoHandles == 0) {
+    FreePool (*Buffer);
+    *Buffer = NULL;
+    return EFI_NOT_FOUND;
+  }
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration,
+  OUT VOID      **Interface
+  )
+{
+  LIST_ENTRY           *Link;
+  HOST_PROTOCOL_ENTRY  *Entry;
+
+  if (Protocol == NULL || Interface == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  for (Link = GetFirstNode (&mHostHandles); !IsNull (&mHostHandles, Link); Link = GetNextNode (&mHostHandles, Link)) {
+    Entry = HostFindProtocol (BASE_CR (Link, HOST_HANDLE, Link), Protocol);
+    if (Entry != NULL) {
+      *Interface = Entry->Interface;
+      return EFI_SUCCESS;
+    }
+  }
+  *Interface = NULL;
+  return EFI_NOT_FOUND;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostConnectController (
+  IN EFI_HANDLE                ControllerHandle,
+  IN EFI_HANDLE                *DriverImageHandle,
+  IN EFI_DEVICE_PATH_PROTOCOL  *RemainingDevicePath,
+  IN BOOLEAN                   Recursive
+  )
+{
+  EFI_STATUS                   Status;
+  EFI_HANDLE                   *Handles;
+  UINTN                        HandleCount;
+  UINTN                        Index;
+  EFI_DRIVER_BINDING_PROTOCOL  *Binding;
+  BOOLEAN                      Started;
+
+  Status = HostLocateHandleBuffer (ByProtocol, &gEfiDriverBindingProtocolGuid, NULL, &HandleCount, &Handles);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
+  }
+  Started = FALSE;
+  for (Index = 0; Index < HandleCount; Index++) {
+    Status = HostHandleProtocol (Handles[Index], &gEfiDriverBindingProtocolGuid, (VOID **) &Binding);
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+    if (!EFI_ERROR (Binding->Supported (Binding, ControllerHandle, RemainingDevicePath))) {
+      if (!EFI_ERROR (Binding->Start (Binding, ControllerHandle, RemainingDevicePath))) {
+        Started = TRUE;
+      }
+    }
+  }
+  FreePool (Handles);
+  return Started ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostDisconnectController (
+  IN EFI_HANDLE  ControllerHandle,
+  IN EFI_HANDLE  DriverImageHandle,
+  IN EFI_HANDLE  ChildHandle
+  )
+{
+  EFI_STATUS                   Status;
+  EFI_DRIVER_BINDING_PROTOCOL  *Binding;
+
+  if (DriverImageHandle == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+  Status = HostHandleProtocol (DriverImageHandle, &gEfiDriverBindingProtocolGuid, (VOID **) &Binding);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  return Binding->Stop (Binding, ControllerHandle, 0, NULL);
+}
+
+//
+// UefiLib
+//
+
+EFI_STATUS
+EFIAPI
+EfiTestManagedDevice (
+  IN CONST EFI_HANDLE  ControllerHandle,
+  IN CONST EFI_HANDLE  DriverBindingHandle,
+  IN CONST EFI_GUID    *ProtocolGuid
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *ManagedInterface;
+
+  Status = HostOpenProtocol (
+             ControllerHandle,
+             (EFI_GUID *) ProtocolGuid,
+             &ManagedInterface,
+             DriverBindingHandle,
+             ControllerHandle,
+             EFI_OPEN_PROTOCOL_BY_DRIVER
+             );
+  if (!EFI_ERROR (Status)) {
+    HostCloseProtocol (ControllerHandle, (EFI_GUID *) ProtocolGuid, DriverBindingHandle, ControllerHandle);
+    return EFI_UNSUPPORTED;
+  }
+  if (Status != EFI_ALREADY_STARTED) {
+    return EFI_UNSUPPORTED;
+  }
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+EfiLibInstallDriverBindingComponentName2 (
+  IN CONST EFI_HANDLE                    ImageHandle,
+  IN CONST EFI_SYSTEM_TABLE              *SystemTable,
+  IN EFI_DRIVER_BINDING_PROTOCOL         *DriverBinding,
+  IN EFI_HANDLE                          DriverBindingHandle,
+  IN CONST EFI_COMPONENT_NAME_PROTOCOL   *ComponentName,  OPTIONAL
+  IN CONST EFI_COMPONENT_NAME2_PROTOCOL  *ComponentName2  OPTIONAL
+  )
+{
+  EFI_STATUS  Status;
+
+  DriverBinding->ImageHandle         = ImageHandle;
+  DriverBinding->DriverBindingHandle = DriverBindingHandle;
+  Status = HostInstallMultipleProtocolInterfaces (
+             &DriverBinding->DriverBindingHandle,
+             &gEfiDriverBindingProtocolGuid,
+             DriverBinding,
+             &gEfiComponentNameProtocolGuid,
+             ComponentName,
+             &gEfiComponentName2ProtocolGuid,
+             ComponentName2,
+             NULL
+             );
+  return Status;
+}
+
+/**
+  Compare the language codes of the Lang and PlatformLang conventions, the
+  first one being a prefix of the supported list entry.
+
+**/
+STATIC
+CHAR8 *
+HostMatchLanguage (
+  IN CONST CHAR8  *SupportedLanguages,
+  IN BOOLEAN      Iso639Language,
+  IN CONST CHAR8  *Language,
+  IN UINTN        LanguageLength
+  )
+{
+  CONST CHAR8  *Supported;
+  UINTN        Length;
+  CHAR8        *Best;
+
+  for (Supported = SupportedLanguages; *Supported != 0; Supported += Length) {
+    if (Iso639Language) {
+      Length = 3;
+    } else {
+      while (*Supported == ';') {
+        Supported++;
+      }
+      for (Length = 0; Supported[Length] != 0 && Supported[Length] != ';'; Length++) {
+      }
+    }
+    if (Length == LanguageLength && strncasecmp (Supported, Language, Length) == 0) {
+      Best = AllocateZeroPool (Length + 1);
+      if (Best != NULL) {
+        memcpy (Best, Supported, Length);
+      }
+      return Best;
+    }
+  }
+  return NULL;
+}
+
+CHAR8 *
+EFIAPI
+GetBestLanguage (
+  IN CONST CHAR8  *SupportedLanguages,
+  IN UINTN        Iso639Language,
+  ...
+  )
+{
+  VA_LIST      Args;
+  CONST CHAR8  *Language;
+  UINTN        LanguageLength;
+  CHAR8        *Best;
+
+  Best = NULL;
+  VA_START (Args, Iso639Language);
+  for (Language = VA_ARG (Args, CONST CHAR8 *); Language != NULL && Best == NULL; Language = VA_ARG (Args, CONST CHAR8 *)) {
+    if (Iso639Language) {
+      LanguageLength = MIN (3, strlen (Language));
+      if (LanguageLength == 3) {
+        Best = HostMatchLanguage (SupportedLanguages, TRUE, Language, 3);
+      }
+      continue;
+    }
+    for (LanguageLength = 0; Language[LanguageLength] != 0 && Language[LanguageLength] != ';'; LanguageLength++) {
+    }
+    //
+    // Try the RFC 4646 language, then its shorter prefixes
+    //
+    while (LanguageLength > 0 && Best == NULL) {
+      Best = HostMatchLanguage (SupportedLanguages, FALSE, Language, LanguageLength);
+      while (LanguageLength > 0 && Language[--LanguageLength] != '-') {
+      }
+    }
+  }
+  VA_END (Args);
+  return Best;
+}
+
+EFI_STATUS
+EFIAPI
+GetEfiGlobalVariable2 (
+  IN CONST CHAR16  *Name,
+  OUT VOID         **Value,
+  OUT UINTN        *Size    OPTIONAL
+  )
+{
+  CONST CHAR8  *Data;
+
+  if (StrCmp (Name, L"PlatformLang") == 0) {
+    Data = "en-US";
+  } else if (StrCmp (Name, L"Lang") == 0) {
+    Data = "eng";
+  } else {
+    *Value = NULL;
+    return EFI_NOT_FOUND;
+  }
+  *Value = AllocateCopyPool (strlen (Data) + 1, Data);
+  if (Size != NULL) {
+    *Size = strlen (Data) + 1;
+  }
+  return *Value == NULL ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+LookupUnicodeString2 (
+  IN  CONST CHAR8                     *Language,
+  IN  CONST CHAR8                     *SupportedLanguages,
+  IN  CONST EFI_UNICODE_STRING_TABLE  *UnicodeStringTable,
+  OUT CHAR16                          **UnicodeString,
+  IN  BOOLEAN                         Iso639Language
+  )
+{
+  CHAR8  *Best;
+
+  if (Language == NULL || UnicodeString == NULL || SupportedLanguages == NULL || UnicodeStringTable == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Best = GetBestLanguage (SupportedLanguages, Iso639Language, Language, NULL);
+  if (Best == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+  for ( ; UnicodeStringTable->Language != NULL; UnicodeStringTable++) {
+    if (strstr (UnicodeStringTable->Language, Best) != NULL) {
+      *UnicodeString = UnicodeStringTable->UnicodeString;
+      FreePool (Best);
+      return EFI_SUCCESS;
+    }
+  }
+  FreePool (Best);
+  return EFI_UNSUPPORTED;
+}
+
+//
+// Runtime services
+//
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostGetTime (
+  OUT EFI_TIME               *Time,
+  OUT EFI_TIME_CAPABILITIES  *Capabilities
+  )
+{
+  struct timespec  Now;
+  struct tm        Tm;
+
+  if (Time == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  clock_gettime (CLOCK_REALTIME, &Now);
+  gmtime_r (&Now.tv_sec, &Tm);
+  ZeroMem (Time, sizeof (EFI_TIME));
+  Time->Year       = (UINT16) (Tm.tm_year + 1900);
+  Time->Month      = (UINT8) (Tm.tm_mon + 1);
+  Time->Day        = (UINT8) Tm.tm_mday;
+  Time->Hour       = (UINT8) Tm.tm_hour;
+  Time->Minute     = (UINT8) Tm.tm_min;
+  Time->Second     = (UINT8) Tm.tm_sec;
+  Time->Nanosecond = (UINT32) Now.tv_nsec;
+  Time->TimeZone   = EFI_UNSPECIFIED_TIMEZONE;
+  if (Capabilities != NULL) {
+    Capabilities->Resolution = 1;
+    Capabilities->Accuracy   = 50000000;
+    Capabilities->SetsToZero = FALSE;
+  }
+  return EFI_SUCCESS;
+}
+
+//
+// Unicode collation, the English one of the firmware
+//
+
+STATIC
+CHAR16
+HostToUpper (
+  IN CHAR16  Char
+  )
+{
+  if (Char >= L'a' && Char <= L'z') {
+    return (CHAR16) (Char - (L'a' - L'A'));
+  }
+  return Char;
+}
+
+STATIC
+CHAR16
+HostToLower (
+  IN CHAR16  Char
+  )
+{
+  if (Char >= L'A' && Char <= L'Z') {
+    return (CHAR16) (Char + (L'a' - L'A'));
+  }
+  return Char;
+}
+
+STATIC
+INTN
+EFIAPI
+HostStriColl (
+  IN EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN CHAR16                          *Str1,
+  IN CHAR16                          *Str2
+  )
+{
+  while (*Str1 != 0 && HostToUpper (*Str1) == HostToUpper (*Str2)) {
+    Str1++;
+    Str2++;
+  }
+  return HostToUpper (*Str1) - HostToUpper (*Str2);
+}
+
+STATIC
+BOOLEAN
+EFIAPI
+HostMetaiMatch (
+  IN EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN CHAR16                          *String,
+  IN CHAR16                          *Pattern
+  )
+{
+  for (;;) {
+    switch (*Pattern) {
+    case 0:
+      return (BOOLEAN) (*String == 0);
+    case L'*':
+      for (;;) {
+        if (HostMetaiMatch (This, String, Pattern + 1)) {
+          return TRUE;
+        }
+        if (*String == 0) {
+          return FALSE;
+        }
+        String++;
+      }
+    case L'?':
+      if (*String == 0) {
+        return FALSE;
+      }
+      break;
+    default:
+      if (HostToUpper (*String) != HostToUpper (*Pattern)) {
+        return FALSE;
+      }
+      break;
+    }
+    String++;
+    Pattern++;
+  }
+}
+
+STATIC
+VOID
+EFIAPI
+HostStrLwr (
+  IN EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN OUT CHAR16                      *Str
+  )
+{
+  for ( ; *Str != 0; Str++) {
+    *Str = HostToLower (*Str);
+  }
+}
+
+STATIC
+VOID
+EFIAPI
+HostStrUpr (
+  IN EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN OUT CHAR16                      *Str
+  )
+{
+  for ( ; *Str != 0; Str++) {
+    *Str = HostToUpper (*Str);
+  }
+}
+
+STATIC
+VOID
+EFIAPI
+HostFatToStr (
+  IN EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN UINTN                           FatSize,
+  IN CHAR8                           *Fat,
+  OUT CHAR16                         *String
+  )
+{
+  for ( ; FatSize != 0 && *Fat != 0; FatSize--) {
+    *(String++) = (CHAR16) (UINT8) *(Fat++);
+  }
+  *String = 0;
+}
+
+STATIC
+BOOLEAN
+EFIAPI
+HostStrToFat (
+  IN EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN CHAR16                          *String,
+  IN UINTN                           FatSize,
+  OUT CHAR8                          *Fat
+  )
+{
+  BOOLEAN  Lossy;
+
+  Lossy = FALSE;
+  for ( ; *String != 0 && FatSize != 0; String++) {
+    if (*String == L'.' || *String == L' ') {
+      continue;
+    }
+    if (*String >= 0x80) {
+      *(Fat++) = '_';
+      Lossy = TRUE;
+    } else {
+      *(Fat++) = (CHAR8) HostToUpper (*String);
+    }
+    FatSize--;
+  }
+  return Lossy;
+}
+
+STATIC EFI_UNICODE_COLLATION_PROTOCOL  mHostUnicodeCollation2 = {
+  HostStriColl,
+  HostMetaiMatch,
+  HostStrLwr,
+  HostStrUpr,
+  HostFatToStr,
+  HostStrToFat,
+  "en;fr"
+};
+
+//
+// Tables
+//
+
+STATIC EFI_BOOT_SERVICES  mHostBootServices = {
+  { 0 },
+  HostRaiseTpl,
+  HostRestoreTpl,
+  HostCreateEvent,
+  HostSetTimer,
+  HostWaitForEvent,
+  HostSignalEvent,
+  HostCloseEvent,
+  HostCheckEvent,
+  HostInstallProtocolInterface,
+  HostUninstallProtocolInterface,
+  HostHandleProtocol,
+  HostStall,
+  HostConnectController,
+  HostDisconnectController,
+  HostOpenProtocol,
+  HostCloseProtocol,
+  HostLocateHandleBuffer,
+  HostLocateProtocol,
+  HostInstallMultipleProtocolInterfaces,
+  HostUninstallMultipleProtocolInterfaces
+};
+
+STATIC EFI_RUNTIME_SERVICES  mHostRuntimeServices = {
+  { 0 },
+  HostGetTime
+};
+
+STATIC EFI_SYSTEM_TABLE  mHostSystemTable = {
+  { 0 },
+  L"NtfsHost",
+  0x00010000,
+  &mHostRuntimeServices,
+  &mHostBootServices
+};
+
+EFI_HANDLE            gImageHandle;
+EFI_SYSTEM_TABLE      *gST = &mHostSystemTable;
+EFI_BOOT_SERVICES     *gBS = &mHostBootServices;
+EFI_RUNTIME_SERVICES  *gRT = &mHostRuntimeServices;
+
+/**
+  Create the image handle of the driver and install the protocols the
+  firmware would provide to it.
+
+  @retval EFI_SUCCESS           - The services are ready.
+
+**/
+EFI_STATUS
+HostUefiInitialize (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  EFI_HANDLE  Handle;
+
+  gImageHandle = NULL;
+  Status = HostInstallProtocolInterface (&gImageHandle, &gEfiCallerIdGuid, EFI_NATIVE_INTERFACE, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Handle = NULL;
+  return HostInstallProtocolInterface (
+           &Handle,
+           &gEfiUnicodeCollation2ProtocolGuid,
+           EFI_NATIVE_INTERFACE,
+           &mHostUnicodeCollation2
+           );
+}
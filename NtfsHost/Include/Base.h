@@ -0,0 +1,159 @@
+/** @file
+  Host build: the subset of the edk2 MdePkg Base.h used by the NTFS driver
+  and library, with the same names and meanings. Types are those of the
+  X64 GCC toolchain of edk2.
+
+**/
+
+#ifndef __BASE_H__
+#define __BASE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+typedef unsigned long long  UINT64;
+typedef long long           INT64;
+typedef unsigned int        UINT32;
+typedef int                 INT32;
+typedef unsigned short      UINT16;
+typedef unsigned short      CHAR16;
+typedef short               INT16;
+typedef unsigned char       BOOLEAN;
+typedef unsigned char       UINT8;
+typedef char                CHAR8;
+typedef signed char         INT8;
+typedef UINT64              UINTN;
+typedef INT64               INTN;
+
+#define VOID                void
+#define CONST               const
+#define STATIC              static
+#define IN
+#define OUT
+#define OPTIONAL
+#define EFIAPI
+#define GLOBAL_REMOVE_IF_UNREFERENCED
+
+#ifndef TRUE
+#define TRUE                ((BOOLEAN)(1==1))
+#endif
+#ifndef FALSE
+#define FALSE               ((BOOLEAN)(0==1))
+#endif
+
+#define MAX_UINT8           ((UINT8)0xFF)
+#define MAX_UINT16          ((UINT16)0xFFFF)
+#define MAX_UINT32          ((UINT32)0xFFFFFFFF)
+#define MAX_UINT64          ((UINT64)0xFFFFFFFFFFFFFFFFULL)
+#define MAX_UINTN           MAX_UINT64
+#define MAX_INTN            ((INTN)0x7FFFFFFFFFFFFFFFULL)
+
+typedef struct {
+  UINT32  Data1;
+  UINT16  Data2;
+  UINT16  Data3;
+  UINT8   Data4[8];
+} GUID;
+
+typedef struct _LIST_ENTRY LIST_ENTRY;
+
+struct _LIST_ENTRY {
+  LIST_ENTRY  *ForwardLink;
+  LIST_ENTRY  *BackLink;
+};
+
+typedef va_list             VA_LIST;
+#define VA_START(Marker, Parameter)  va_start (Marker, Parameter)
+#define VA_ARG(Marker, TYPE)         va_arg (Marker, TYPE)
+#define VA_END(Marker)               va_end (Marker)
+
+#define BIT0                0x00000001
+#define BIT1                0x00000002
+#define BIT2                0x00000004
+#define BIT3                0x00000008
+#define BIT4                0x00000010
+#define BIT5                0x00000020
+#define BIT6                0x00000040
+#define BIT7                0x00000080
+
+#define SIZE_1KB            0x00000400
+#define SIZE_4KB            0x00001000
+#define SIZE_8KB            0x00002000
+#define SIZE_16KB           0x00004000
+#define SIZE_32KB           0x00008000
+#define SIZE_64KB           0x00010000
+#define SIZE_128KB          0x00020000
+#define SIZE_256KB          0x00040000
+#define SIZE_512KB          0x00080000
+#define SIZE_1MB            0x00100000
+#define SIZE_2MB            0x00200000
+#define SIZE_4MB            0x00400000
+#define SIZE_8MB            0x00800000
+#define SIZE_16MB           0x01000000
+#define SIZE_32MB           0x02000000
+#define SIZE_64MB           0x04000000
+#define SIZE_128MB          0x08000000
+#define SIZE_256MB          0x10000000
+#define SIZE_512MB          0x20000000
+#define SIZE_1GB            0x40000000
+
+#define BASE_4KB            SIZE_4KB
+#define BASE_64KB           SIZE_64KB
+#define BASE_1MB            SIZE_1MB
+
+#define OFFSET_OF(TYPE, Field)   ((UINTN) offsetof (TYPE, Field))
+#define BASE_CR(Record, TYPE, Field) \
+  ((TYPE *) ((CHAR8 *) (Record) - OFFSET_OF (TYPE, Field)))
+
+#define ALIGN_VALUE(Value, Alignment) \
+  ((Value) + (((Alignment) - (Value)) & ((Alignment) - 1)))
+#define ALIGN_POINTER(Pointer, Alignment) \
+  ((VOID *) (ALIGN_VALUE ((UINTN)(Pointer), (Alignment))))
+#define ARRAY_SIZE(Array)   (sizeof (Array) / sizeof ((Array)[0]))
+
+#ifndef MAX
+#define MAX(a, b)           (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef MIN
+#define MIN(a, b)           (((a) < (b)) ? (a) : (b))
+#endif
+
+#define SIGNATURE_16(A, B)        ((A) | (B << 8))
+#define SIGNATURE_32(A, B, C, D)  (SIGNATURE_16 (A, B) | (SIGNATURE_16 (C, D) << 16))
+#define SIGNATURE_64(A, B, C, D, E, F, G, H) \
+    (SIGNATURE_32 (A, B, C, D) | ((UINT64) (SIGNATURE_32 (E, F, G, H)) << 32))
+
+typedef UINTN RETURN_STATUS;
+
+#define MAX_BIT             0x8000000000000000ULL
+#define ENCODE_ERROR(StatusCode)     ((RETURN_STATUS)(MAX_BIT | (StatusCode)))
+#define ENCODE_WARNING(StatusCode)   ((RETURN_STATUS)(StatusCode))
+#define RETURN_ERROR(StatusCode)     (((INTN)(RETURN_STATUS)(StatusCode)) < 0)
+
+#define RETURN_SUCCESS               0
+#define RETURN_LOAD_ERROR            ENCODE_ERROR (1)
+#define RETURN_INVALID_PARAMETER     ENCODE_ERROR (2)
+#define RETURN_UNSUPPORTED           ENCODE_ERROR (3)
+#define RETURN_BAD_BUFFER_SIZE       ENCODE_ERROR (4)
+#define RETURN_BUFFER_TOO_SMALL      ENCODE_ERROR (5)
+#define RETURN_NOT_READY             ENCODE_ERROR (6)
+#define RETURN_DEVICE_ERROR          ENCODE_ERROR (7)
+#define RETURN_WRITE_PROTECTED       ENCODE_ERROR (8)
+#define RETURN_OUT_OF_RESOURCES      ENCODE_ERROR (9)
+#define RETURN_VOLUME_CORRUPTED      ENCODE_ERROR (10)
+#define RETURN_VOLUME_FULL           ENCODE_ERROR (11)
+#define RETURN_NO_MEDIA              ENCODE_ERROR (12)
+#define RETURN_MEDIA_CHANGED         ENCODE_ERROR (13)
+#define RETURN_NOT_FOUND             ENCODE_ERROR (14)
+#define RETURN_ACCESS_DENIED         ENCODE_ERROR (15)
+#define RETURN_NO_RESPONSE           ENCODE_ERROR (16)
+#define RETURN_NO_MAPPING            ENCODE_ERROR (17)
+#define RETURN_TIMEOUT               ENCODE_ERROR (18)
+#define RETURN_NOT_STARTED           ENCODE_ERROR (19)
+#define RETURN_ALREADY_STARTED       ENCODE_ERROR (20)
+#define RETURN_ABORTED               ENCODE_ERROR (21)
+#define RETURN_END_OF_FILE           ENCODE_ERROR (31)
+#define RETURN_WARN_DELETE_FAILURE   ENCODE_WARNING (2)
+
+#endif
@@ -0,0 +1,29 @@
+/** @file
+  Host build: EFI_FILE_INFO, as in MdePkg/Include/Guid/FileInfo.h.
+
+**/
+
+#ifndef __FILE_INFO_H__
+#define __FILE_INFO_H__
+
+#include <Uefi.h>
+
+#define EFI_FILE_INFO_ID \
+  { 0x9576e92, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x0, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
+
+typedef struct {
+  UINT64    Size;
+  UINT64    FileSize;
+  UINT64    PhysicalSize;
+  EFI_TIME  CreateTime;
+  EFI_TIME  LastAccessTime;
+  EFI_TIME  ModificationTime;
+  UINT64    Attribute;
+  CHAR16    FileName[1];
+} EFI_FILE_INFO;
+
+#define SIZE_OF_EFI_FILE_INFO  OFFSET_OF (EFI_FILE_INFO, FileName)
+
+extern EFI_GUID gEfiFileInfoGuid;
+
+#endif
@@ -0,0 +1,27 @@
+/** @file
+  Host build: EFI_FILE_SYSTEM_INFO, as in MdePkg/Include/Guid/FileSystemInfo.h.
+
+**/
+
+#ifndef __FILE_SYSTEM_INFO_H__
+#define __FILE_SYSTEM_INFO_H__
+
+#include <Uefi.h>
+
+#define EFI_FILE_SYSTEM_INFO_ID \
+  { 0x9576e93, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x0, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
+
+typedef struct {
+  UINT64  Size;
+  BOOLEAN ReadOnly;
+  UINT64  VolumeSize;
+  UINT64  FreeSpace;
+  UINT32  BlockSize;
+  CHAR16  VolumeLabel[1];
+} EFI_FILE_SYSTEM_INFO;
+
+#define SIZE_OF_EFI_FILE_SYSTEM_INFO  OFFSET_OF (EFI_FILE_SYSTEM_INFO, VolumeLabel)
+
+extern EFI_GUID gEfiFileSystemInfoGuid;
+
+#endif
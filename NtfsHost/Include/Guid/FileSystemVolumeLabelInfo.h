@@ -0,0 +1,23 @@
+/** @file
+  Host build: EFI_FILE_SYSTEM_VOLUME_LABEL, as in
+  MdePkg/Include/Guid/FileSystemVolumeLabelInfo.h.
+
+**/
+
+#ifndef __FILE_SYSTEM_VOLUME_LABEL_INFO_H__
+#define __FILE_SYSTEM_VOLUME_LABEL_INFO_H__
+
+#include <Uefi.h>
+
+#define EFI_FILE_SYSTEM_VOLUME_LABEL_ID \
+  { 0xDB47D7D3, 0xFE81, 0x11d3, { 0x9A, 0x35, 0x00, 0x90, 0x27, 0x3F, 0xC1, 0x4D } }
+
+typedef struct {
+  CHAR16  VolumeLabel[1];
+} EFI_FILE_SYSTEM_VOLUME_LABEL;
+
+#define SIZE_OF_EFI_FILE_SYSTEM_VOLUME_LABEL  OFFSET_OF (EFI_FILE_SYSTEM_VOLUME_LABEL, VolumeLabel)
+
+extern EFI_GUID gEfiFileSystemVolumeLabelInfoIdGuid;
+
+#endif
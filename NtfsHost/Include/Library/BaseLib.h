@@ -0,0 +1,40 @@
+/** @file
+  Host build: the BaseLib string, list and CPU functions used by the
+  driver. Implemented by HostUefi.c.
+
+**/
+
+#ifndef __BASE_LIB__
+#define __BASE_LIB__
+
+#include <Uefi.h>
+
+#define INITIALIZE_LIST_HEAD_VARIABLE(ListHead)  {&(ListHead), &(ListHead)}
+
+UINTN   EFIAPI StrLen (IN CONST CHAR16 *String);
+UINTN   EFIAPI StrSize (IN CONST CHAR16 *String);
+INTN    EFIAPI StrCmp (IN CONST CHAR16 *FirstString, IN CONST CHAR16 *SecondString);
+INTN    EFIAPI StrnCmp (IN CONST CHAR16 *FirstString, IN CONST CHAR16 *SecondString, IN UINTN Length);
+CHAR16 *EFIAPI StrCpy (OUT CHAR16 *Destination, IN CONST CHAR16 *Source);
+UINTN   EFIAPI AsciiStrLen (IN CONST CHAR8 *String);
+UINTN   EFIAPI AsciiStrSize (IN CONST CHAR8 *String);
+INTN    EFIAPI AsciiStrCmp (IN CONST CHAR8 *FirstString, IN CONST CHAR8 *SecondString);
+INTN    EFIAPI AsciiStrnCmp (IN CONST CHAR8 *FirstString, IN CONST CHAR8 *SecondString, IN UINTN Length);
+
+LIST_ENTRY *EFIAPI InitializeListHead (IN OUT LIST_ENTRY *ListHead);
+LIST_ENTRY *EFIAPI InsertHeadList (IN OUT LIST_ENTRY *ListHead, IN OUT LIST_ENTRY *Entry);
+LIST_ENTRY *EFIAPI InsertTailList (IN OUT LIST_ENTRY *ListHead, IN OUT LIST_ENTRY *Entry);
+LIST_ENTRY *EFIAPI GetFirstNode (IN CONST LIST_ENTRY *List);
+LIST_ENTRY *EFIAPI GetNextNode (IN CONST LIST_ENTRY *List, IN CONST LIST_ENTRY *Node);
+BOOLEAN     EFIAPI IsListEmpty (IN CONST LIST_ENTRY *ListHead);
+BOOLEAN     EFIAPI IsNull (IN CONST LIST_ENTRY *List, IN CONST LIST_ENTRY *Node);
+LIST_ENTRY *EFIAPI RemoveEntryList (IN CONST LIST_ENTRY *Entry);
+
+UINT64  EFIAPI LShiftU64 (IN UINT64 Operand, IN UINTN Count);
+UINT64  EFIAPI RShiftU64 (IN UINT64 Operand, IN UINTN Count);
+UINT64  EFIAPI MultU64x32 (IN UINT64 Multiplicand, IN UINT32 Multiplier);
+UINT64  EFIAPI DivU64x32 (IN UINT64 Dividend, IN UINT32 Divisor);
+UINT64  EFIAPI AsmReadTsc (VOID);
+VOID    EFIAPI CpuPause (VOID);
+
+#endif
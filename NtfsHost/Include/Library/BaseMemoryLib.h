@@ -0,0 +1,17 @@
+/** @file
+  Host build: BaseMemoryLib. Implemented by HostUefi.c.
+
+**/
+
+#ifndef __BASE_MEMORY_LIB__
+#define __BASE_MEMORY_LIB__
+
+#include <Uefi.h>
+
+VOID   *EFIAPI CopyMem (OUT VOID *DestinationBuffer, IN CONST VOID *SourceBuffer, IN UINTN Length);
+VOID   *EFIAPI SetMem (OUT VOID *Buffer, IN UINTN Length, IN UINT8 Value);
+VOID   *EFIAPI ZeroMem (OUT VOID *Buffer, IN UINTN Length);
+INTN    EFIAPI CompareMem (IN CONST VOID *DestinationBuffer, IN CONST VOID *SourceBuffer, IN UINTN Length);
+BOOLEAN EFIAPI CompareGuid (IN CONST GUID *Guid1, IN CONST GUID *Guid2);
+
+#endif
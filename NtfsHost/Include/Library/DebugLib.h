@@ -0,0 +1,77 @@
+/** @file
+  Host build: DebugLib mapped onto the host assert and stderr.
+
+**/
+
+#ifndef __DEBUG_LIB_H__
+#define __DEBUG_LIB_H__
+
+#include <Uefi.h>
+
+#define DEBUG_INIT      0x00000001
+#define DEBUG_WARN      0x00000002
+#define DEBUG_LOAD      0x00000004
+#define DEBUG_FS        0x00000008
+#define DEBUG_INFO      0x00000040
+#define DEBUG_VERBOSE   0x00400000
+#define DEBUG_ERROR     0x80000000
+
+#define EFI_D_INIT      DEBUG_INIT
+#define EFI_D_WARN      DEBUG_WARN
+#define EFI_D_LOAD      DEBUG_LOAD
+#define EFI_D_FS        DEBUG_FS
+#define EFI_D_INFO      DEBUG_INFO
+#define EFI_D_VERBOSE   DEBUG_VERBOSE
+#define EFI_D_ERROR     DEBUG_ERROR
+
+VOID
+EFIAPI
+DebugPrint (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  );
+
+VOID
+EFIAPI
+DebugAssert (
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber,
+  IN CONST CHAR8  *Description
+  );
+
+#define ASSERT(Expression) \
+  do { \
+    if (!(Expression)) { \
+      DebugAssert (__FILE__, __LINE__, #Expression); \
+    } \
+  } while (FALSE)
+
+#define ASSERT_EFI_ERROR(StatusParameter) \
+  do { \
+    if (EFI_ERROR (StatusParameter)) { \
+      DebugAssert (__FILE__, __LINE__, #StatusParameter); \
+    } \
+  } while (FALSE)
+
+#define _DEBUG_PRINT(PrintLevel, ...)  DebugPrint (PrintLevel, ##__VA_ARGS__)
+#define DEBUG(Expression)              _DEBUG_PRINT Expression
+
+VOID *
+EFIAPI
+DebugCheckRecord (
+  IN VOID         *Record,
+  IN BOOLEAN      SignatureMatches,
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber
+  );
+
+#define CR(Record, TYPE, Field, TestSignature) \
+  ((TYPE *) DebugCheckRecord ( \
+              BASE_CR (Record, TYPE, Field), \
+              BASE_CR (Record, TYPE, Field)->Signature == (TestSignature), \
+              __FILE__, \
+              __LINE__ \
+              ))
+
+#endif
@@ -0,0 +1,22 @@
+/** @file
+  Host build: MemoryAllocationLib. Implemented by HostUefi.c, which keeps
+  a count of the outstanding allocations so the harness can report leaks.
+
+**/
+
+#ifndef __MEMORY_ALLOCATION_LIB_H__
+#define __MEMORY_ALLOCATION_LIB_H__
+
+#include <Uefi.h>
+
+VOID *EFIAPI AllocatePool (IN UINTN AllocationSize);
+VOID *EFIAPI AllocateZeroPool (IN UINTN AllocationSize);
+VOID *EFIAPI AllocateCopyPool (IN UINTN AllocationSize, IN CONST VOID *Buffer);
+VOID *EFIAPI ReallocatePool (IN UINTN OldSize, IN UINTN NewSize, IN VOID *OldBuffer OPTIONAL);
+VOID  EFIAPI FreePool (IN VOID *Buffer);
+VOID *EFIAPI AllocatePages (IN UINTN Pages);
+VOID  EFIAPI FreePages (IN VOID *Buffer, IN UINTN Pages);
+VOID *EFIAPI AllocateAlignedPages (IN UINTN Pages, IN UINTN Alignment);
+VOID  EFIAPI FreeAlignedPages (IN VOID *Buffer, IN UINTN Pages);
+
+#endif
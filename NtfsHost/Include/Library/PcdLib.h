@@ -0,0 +1,27 @@
+/** @file
+  Host build: PcdLib. Every PCD is a field of gHostPcd, set from the
+  command line of the harness; the firmware defaults are in ntfs-3g.dec.
+
+**/
+
+#ifndef __PCD_LIB_H__
+#define __PCD_LIB_H__
+
+#include <Uefi.h>
+
+typedef struct {
+  UINT32  PcdNtfsCacheBudget;
+  UINT32  PcdNtfsInodeCacheSize;
+  UINT32  PcdNtfsNidataCacheSize;
+  UINT32  PcdNtfsLookupCacheSize;
+  UINT32  PcdNtfsMftCacheSize;
+  CHAR8   *PcdUefiVariableDefaultLang;
+  CHAR8   *PcdUefiVariableDefaultPlatformLang;
+} HOST_PCD;
+
+extern HOST_PCD  gHostPcd;
+
+#define PcdGet32(TokenName)   (gHostPcd.TokenName)
+#define PcdGetPtr(TokenName)  (gHostPcd.TokenName)
+
+#endif
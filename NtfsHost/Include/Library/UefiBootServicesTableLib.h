@@ -0,0 +1,15 @@
+/** @file
+  Host build: UefiBootServicesTableLib. The tables live in HostUefi.c.
+
+**/
+
+#ifndef __UEFI_BOOT_SERVICES_TABLE_LIB_H__
+#define __UEFI_BOOT_SERVICES_TABLE_LIB_H__
+
+#include <Uefi.h>
+
+extern EFI_HANDLE         gImageHandle;
+extern EFI_SYSTEM_TABLE   *gST;
+extern EFI_BOOT_SERVICES  *gBS;
+
+#endif
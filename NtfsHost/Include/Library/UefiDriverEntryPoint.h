@@ -0,0 +1,12 @@
+/** @file
+  Host build: UefiDriverEntryPoint. The harness calls the entry point of
+  the driver itself, see NtfsBench.c.
+
+**/
+
+#ifndef __MODULE_ENTRY_POINT_H__
+#define __MODULE_ENTRY_POINT_H__
+
+#include <Uefi.h>
+
+#endif
@@ -0,0 +1,109 @@
+/** @file
+  Host build: the UefiLib functions used by the driver. Implemented by
+  HostUefi.c.
+
+**/
+
+#ifndef __UEFI_LIB_H__
+#define __UEFI_LIB_H__
+
+#include <Uefi.h>
+#include <Protocol/DriverBinding.h>
+#include <Protocol/ComponentName.h>
+#include <Protocol/ComponentName2.h>
+
+//
+// edk2 names the states of a lock, the host one only tracks ownership
+//
+typedef enum {
+  EfiLockUninitialized = 0,
+  EfiLockReleased      = 1,
+  EfiLockAcquired      = 2
+} EFI_LOCK_STATE;
+
+typedef struct {
+  EFI_TPL         Tpl;
+  EFI_TPL         OwnerTpl;
+  EFI_LOCK_STATE  Lock;
+} EFI_LOCK;
+
+#define EFI_INITIALIZE_LOCK_VARIABLE(Priority) \
+  {Priority, TPL_APPLICATION, EfiLockReleased }
+
+#define ASSERT_LOCKED(LockParameter) \
+  do { \
+    if (LockParameter != NULL) { \
+      ASSERT ((LockParameter)->Lock == EfiLockAcquired); \
+    } \
+  } while (FALSE)
+
+typedef struct {
+  CHAR8   *Language;
+  CHAR16  *UnicodeString;
+} EFI_UNICODE_STRING_TABLE;
+
+EFI_LOCK   *EFIAPI EfiInitializeLock (IN OUT EFI_LOCK *Lock, IN EFI_TPL Priority);
+VOID        EFIAPI EfiAcquireLock (IN EFI_LOCK *Lock);
+EFI_STATUS  EFIAPI EfiAcquireLockOrFail (IN EFI_LOCK *Lock);
+VOID        EFIAPI EfiReleaseLock (IN EFI_LOCK *Lock);
+
+EFI_STATUS
+EFIAPI
+EfiTestManagedDevice (
+  IN CONST EFI_HANDLE       ControllerHandle,
+  IN CONST EFI_HANDLE       DriverBindingHandle,
+  IN CONST EFI_GUID         *ProtocolGuid
+  );
+
+EFI_STATUS
+EFIAPI
+LookupUnicodeString2 (
+  IN  CONST CHAR8                     *Language,
+  IN  CONST CHAR8                     *SupportedLanguages,
+  IN  CONST EFI_UNICODE_STRING_TABLE  *UnicodeStringTable,
+  OUT CHAR16                          **UnicodeString,
+  IN  BOOLEAN                         Iso639Language
+  );
+
+EFI_STATUS
+EFIAPI
+EfiLibInstallDriverBindingComponentName2 (
+  IN CONST EFI_HANDLE                         ImageHandle,
+  IN CONST EFI_SYSTEM_TABLE                   *SystemTable,
+  IN EFI_DRIVER_BINDING_PROTOCOL              *DriverBinding,
+  IN EFI_HANDLE                               DriverBindingHandle,
+  IN CONST EFI_COMPONENT_NAME_PROTOCOL        *ComponentName,  OPTIONAL
+  IN CONST EFI_COMPONENT_NAME2_PROTOCOL       *ComponentName2  OPTIONAL
+  );
+
+EFI_STATUS
+EFIAPI
+GetEfiGlobalVariable2 (
+  IN CONST CHAR16    *Name,
+  OUT VOID           **Value,
+  OUT UINTN          *Size    OPTIONAL
+  );
+
+CHAR8 *
+EFIAPI
+GetBestLanguage (
+  IN CONST CHAR8  *SupportedLanguages,
+  IN UINTN        Iso639Language,
+  ...
+  );
+
+UINTN
+EFIAPI
+Print (
+  IN CONST CHAR16  *Format,
+  ...
+  );
+
+UINTN
+EFIAPI
+AsciiPrint (
+  IN CONST CHAR8  *Format,
+  ...
+  );
+
+#endif
@@ -0,0 +1,13 @@
+/** @file
+  Host build: UefiRuntimeServicesTableLib. The table lives in HostUefi.c.
+
+**/
+
+#ifndef __UEFI_RUNTIME_SERVICES_TABLE_LIB_H__
+#define __UEFI_RUNTIME_SERVICES_TABLE_LIB_H__
+
+#include <Uefi.h>
+
+extern EFI_RUNTIME_SERVICES  *gRT;
+
+#endif
@@ -0,0 +1,68 @@
+/** @file
+  Host build: the Disk I/O 2 protocol, as in MdePkg/Include/Protocol/DiskIo2.h.
+
+**/
+
+#ifndef __DISK_IO2_H__
+#define __DISK_IO2_H__
+
+#include <Uefi.h>
+
+#define EFI_DISK_IO2_PROTOCOL_GUID \
+  { 0x151c8eae, 0x7f2c, 0x472c, { 0x9e, 0x54, 0x98, 0x28, 0x19, 0x4f, 0x6a, 0x88 } }
+
+typedef struct _EFI_DISK_IO2_PROTOCOL EFI_DISK_IO2_PROTOCOL;
+
+typedef struct {
+  EFI_EVENT               Event;
+  EFI_STATUS              TransactionStatus;
+} EFI_DISK_IO2_TOKEN;
+
+typedef
+EFI_STATUS
+(EFIAPI *EFI_DISK_CANCEL_EX)(
+  IN EFI_DISK_IO2_PROTOCOL *This
+  );
+
+typedef
+EFI_STATUS
+(EFIAPI *EFI_DISK_READ_EX)(
+  IN EFI_DISK_IO2_PROTOCOL        *This,
+  IN UINT32                       MediaId,
+  IN UINT64                       Offset,
+  IN OUT EFI_DISK_IO2_TOKEN       *Token,
+  IN UINTN                        BufferSize,
+  OUT VOID                        *Buffer
+  );
+
+typedef
+EFI_STATUS
+(EFIAPI *EFI_DISK_WRITE_EX)(
+  IN EFI_DISK_IO2_PROTOCOL        *This,
+  IN UINT32                       MediaId,
+  IN UINT64                       Offset,
+  IN OUT EFI_DISK_IO2_TOKEN       *Token,
+  IN UINTN                        BufferSize,
+  IN VOID                         *Buffer
+  );
+
+typedef
+EFI_STATUS
+(EFIAPI *EFI_DISK_FLUSH_EX)(
+  IN EFI_DISK_IO2_PROTOCOL        *This,
+  IN OUT EFI_DISK_IO2_TOKEN       *Token
+  );
+
+#define EFI_DISK_IO2_PROTOCOL_REVISION 0x00020000
+
+struct _EFI_DISK_IO2_PROTOCOL {
+  UINT64                  Revision;
+  EFI_DISK_CANCEL_EX      Cancel;
+  EFI_DISK_READ_EX        ReadDiskEx;
+  EFI_DISK_WRITE_EX       WriteDiskEx;
+  EFI_DISK_FLUSH_EX       FlushDiskEx;
+};
+
+extern EFI_GUID gEfiDiskIo2ProtocolGuid;
+
+#endif
@@ -0,0 +1,207 @@
+/** @file
+  Host build: the subset of the edk2 MdePkg Uefi.h (UefiBaseType.h and
+  UefiSpec.h) used by the NTFS driver. The boot services are implemented
+  by HostUefi.c.
+
+**/
+
+#ifndef __PI_UEFI_H__
+#define __PI_UEFI_H__
+
+#include <Base.h>
+
+typedef GUID                EFI_GUID;
+typedef RETURN_STATUS       EFI_STATUS;
+typedef VOID                *EFI_HANDLE;
+typedef VOID                *EFI_EVENT;
+typedef UINTN               EFI_TPL;
+typedef UINT64              EFI_LBA;
+typedef UINT64              EFI_PHYSICAL_ADDRESS;
+
+#define EFI_SUCCESS               RETURN_SUCCESS
+#define EFI_LOAD_ERROR            RETURN_LOAD_ERROR
+#define EFI_INVALID_PARAMETER     RETURN_INVALID_PARAMETER
+#define EFI_UNSUPPORTED           RETURN_UNSUPPORTED
+#define EFI_BAD_BUFFER_SIZE       RETURN_BAD_BUFFER_SIZE
+#define EFI_BUFFER_TOO_SMALL      RETURN_BUFFER_TOO_SMALL
+#define EFI_NOT_READY             RETURN_NOT_READY
+#define EFI_DEVICE_ERROR          RETURN_DEVICE_ERROR
+#define EFI_WRITE_PROTECTED       RETURN_WRITE_PROTECTED
+#define EFI_OUT_OF_RESOURCES      RETURN_OUT_OF_RESOURCES
+#define EFI_VOLUME_CORRUPTED      RETURN_VOLUME_CORRUPTED
+#define EFI_VOLUME_FULL           RETURN_VOLUME_FULL
+#define EFI_NO_MEDIA              RETURN_NO_MEDIA
+#define EFI_MEDIA_CHANGED         RETURN_MEDIA_CHANGED
+#define EFI_NOT_FOUND             RETURN_NOT_FOUND
+#define EFI_ACCESS_DENIED         RETURN_ACCESS_DENIED
+#define EFI_NO_RESPONSE           RETURN_NO_RESPONSE
+#define EFI_NO_MAPPING            RETURN_NO_MAPPING
+#define EFI_TIMEOUT               RETURN_TIMEOUT
+#define EFI_NOT_STARTED           RETURN_NOT_STARTED
+#define EFI_ALREADY_STARTED       RETURN_ALREADY_STARTED
+#define EFI_ABORTED               RETURN_ABORTED
+#define EFI_END_OF_FILE           RETURN_END_OF_FILE
+#define EFI_WARN_DELETE_FAILURE   RETURN_WARN_DELETE_FAILURE
+
+#define EFI_ERROR(A)              RETURN_ERROR (A)
+
+#define EFI_PAGE_SIZE             SIZE_4KB
+#define EFI_PAGE_MASK             0xFFF
+#define EFI_PAGE_SHIFT            12
+#define EFI_SIZE_TO_PAGES(Size)   (((Size) >> EFI_PAGE_SHIFT) + (((Size) & EFI_PAGE_MASK) ? 1 : 0))
+#define EFI_PAGES_TO_SIZE(Pages)  ((Pages) << EFI_PAGE_SHIFT)
+
+typedef struct {
+  UINT16  Year;
+  UINT8   Month;
+  UINT8   Day;
+  UINT8   Hour;
+  UINT8   Minute;
+  UINT8   Second;
+  UINT8   Pad1;
+  UINT32  Nanosecond;
+  INT16   TimeZone;
+  UINT8   Daylight;
+  UINT8   Pad2;
+} EFI_TIME;
+
+#define EFI_UNSPECIFIED_TIMEZONE  0x07FF
+
+typedef struct {
+  UINT32  Resolution;
+  UINT32  Accuracy;
+  BOOLEAN SetsToZero;
+} EFI_TIME_CAPABILITIES;
+
+//
+// Task priority levels
+//
+#define TPL_APPLICATION           4
+#define TPL_CALLBACK              8
+#define TPL_NOTIFY                16
+#define TPL_HIGH_LEVEL            31
+
+//
+// Event types
+//
+#define EVT_TIMER                 0x80000000
+#define EVT_RUNTIME               0x40000000
+#define EVT_NOTIFY_WAIT           0x00000100
+#define EVT_NOTIFY_SIGNAL         0x00000200
+
+typedef
+VOID
+(EFIAPI *EFI_EVENT_NOTIFY)(
+  IN  EFI_EVENT                Event,
+  IN  VOID                     *Context
+  );
+
+typedef enum {
+  TimerCancel,
+  TimerPeriodic,
+  TimerRelative
+} EFI_TIMER_DELAY;
+
+typedef enum {
+  AllHandles,
+  ByRegisterNotify,
+  ByProtocol
+} EFI_LOCATE_SEARCH_TYPE;
+
+typedef enum {
+  EFI_NATIVE_INTERFACE
+} EFI_INTERFACE_TYPE;
+
+#define EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL  0x00000001
+#define EFI_OPEN_PROTOCOL_GET_PROTOCOL        0x00000002
+#define EFI_OPEN_PROTOCOL_TEST_PROTOCOL       0x00000004
+#define EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER 0x00000008
+#define EFI_OPEN_PROTOCOL_BY_DRIVER           0x00000010
+#define EFI_OPEN_PROTOCOL_EXCLUSIVE           0x00000020
+
+typedef struct {
+  UINT8 Type;
+  UINT8 SubType;
+  UINT8 Length[2];
+} EFI_DEVICE_PATH_PROTOCOL;
+
+typedef struct {
+  UINT64  Signature;
+  UINT32  Revision;
+  UINT32  HeaderSize;
+  UINT32  CRC32;
+  UINT32  Reserved;
+} EFI_TABLE_HEADER;
+
+typedef EFI_TPL    (EFIAPI *EFI_RAISE_TPL)(IN EFI_TPL NewTpl);
+typedef VOID       (EFIAPI *EFI_RESTORE_TPL)(IN EFI_TPL OldTpl);
+typedef EFI_STATUS (EFIAPI *EFI_CREATE_EVENT)(IN UINT32 Type, IN EFI_TPL NotifyTpl,
+                     IN EFI_EVENT_NOTIFY NotifyFunction, IN VOID *NotifyContext, OUT EFI_EVENT *Event);
+typedef EFI_STATUS (EFIAPI *EFI_SET_TIMER)(IN EFI_EVENT Event, IN EFI_TIMER_DELAY Type, IN UINT64 TriggerTime);
+typedef EFI_STATUS (EFIAPI *EFI_WAIT_FOR_EVENT)(IN UINTN NumberOfEvents, IN EFI_EVENT *Event, OUT UINTN *Index);
+typedef EFI_STATUS (EFIAPI *EFI_SIGNAL_EVENT)(IN EFI_EVENT Event);
+typedef EFI_STATUS (EFIAPI *EFI_CLOSE_EVENT)(IN EFI_EVENT Event);
+typedef EFI_STATUS (EFIAPI *EFI_CHECK_EVENT)(IN EFI_EVENT Event);
+typedef EFI_STATUS (EFIAPI *EFI_INSTALL_PROTOCOL_INTERFACE)(IN OUT EFI_HANDLE *Handle, IN EFI_GUID *Protocol,
+                     IN EFI_INTERFACE_TYPE InterfaceType, IN VOID *Interface);
+typedef EFI_STATUS (EFIAPI *EFI_UNINSTALL_PROTOCOL_INTERFACE)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol,
+                     IN VOID *Interface);
+typedef EFI_STATUS (EFIAPI *EFI_HANDLE_PROTOCOL)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface);
+typedef EFI_STATUS (EFIAPI *EFI_STALL)(IN UINTN Microseconds);
+typedef EFI_STATUS (EFIAPI *EFI_CONNECT_CONTROLLER)(IN EFI_HANDLE ControllerHandle, IN EFI_HANDLE *DriverImageHandle,
+                     IN EFI_DEVICE_PATH_PROTOCOL *RemainingDevicePath, IN BOOLEAN Recursive);
+typedef EFI_STATUS (EFIAPI *EFI_DISCONNECT_CONTROLLER)(IN EFI_HANDLE ControllerHandle, IN EFI_HANDLE DriverImageHandle,
+                     IN EFI_HANDLE ChildHandle);
+typedef EFI_STATUS (EFIAPI *EFI_OPEN_PROTOCOL)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface,
+                     IN EFI_HANDLE AgentHandle, IN EFI_HANDLE ControllerHandle, IN UINT32 Attributes);
+typedef EFI_STATUS (EFIAPI *EFI_CLOSE_PROTOCOL)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol,
+                     IN EFI_HANDLE AgentHandle, IN EFI_HANDLE ControllerHandle);
+typedef EFI_STATUS (EFIAPI *EFI_LOCATE_HANDLE_BUFFER)(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol,
+                     IN VOID *SearchKey, OUT UINTN *NoHandles, OUT EFI_HANDLE **Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_LOCATE_PROTOCOL)(IN EFI_GUID *Protocol, IN VOID *Registration, OUT VOID **Interface);
+typedef EFI_STATUS (EFIAPI *EFI_INSTALL_MULTIPLE_PROTOCOL_INTERFACES)(IN OUT EFI_HANDLE *Handle, ...);
+typedef EFI_STATUS (EFIAPI *EFI_UNINSTALL_MULTIPLE_PROTOCOL_INTERFACES)(IN EFI_HANDLE Handle, ...);
+
+//
+// Only the services the driver calls are listed
+//
+typedef struct {
+  EFI_TABLE_HEADER                            Hdr;
+  EFI_RAISE_TPL                               RaiseTPL;
+  EFI_RESTORE_TPL                             RestoreTPL;
+  EFI_CREATE_EVENT                            CreateEvent;
+  EFI_SET_TIMER                               SetTimer;
+  EFI_WAIT_FOR_EVENT                          WaitForEvent;
+  EFI_SIGNAL_EVENT                            SignalEvent;
+  EFI_CLOSE_EVENT                             CloseEvent;
+  EFI_CHECK_EVENT                             CheckEvent;
+  EFI_INSTALL_PROTOCOL_INTERFACE              InstallProtocolInterface;
+  EFI_UNINSTALL_PROTOCOL_INTERFACE            UninstallProtocolInterface;
+  EFI_HANDLE_PROTOCOL                         HandleProtocol;
+  EFI_STALL                                   Stall;
+  EFI_CONNECT_CONTROLLER                      ConnectController;
+  EFI_DISCONNECT_CONTROLLER                   DisconnectController;
+  EFI_OPEN_PROTOCOL                           OpenProtocol;
+  EFI_CLOSE_PROTOCOL                          CloseProtocol;
+  EFI_LOCATE_HANDLE_BUFFER                    LocateHandleBuffer;
+  EFI_LOCATE_PROTOCOL                         LocateProtocol;
+  EFI_INSTALL_MULTIPLE_PROTOCOL_INTERFACES    InstallMultipleProtocolInterfaces;
+  EFI_UNINSTALL_MULTIPLE_PROTOCOL_INTERFACES  UninstallMultipleProtocolInterfaces;
+} EFI_BOOT_SERVICES;
+
+typedef EFI_STATUS (EFIAPI *EFI_GET_TIME)(OUT EFI_TIME *Time, OUT EFI_TIME_CAPABILITIES *Capabilities);
+
+typedef struct {
+  EFI_TABLE_HEADER                            Hdr;
+  EFI_GET_TIME                                GetTime;
+} EFI_RUNTIME_SERVICES;
+
+typedef struct {
+  EFI_TABLE_HEADER                            Hdr;
+  CHAR16                                      *FirmwareVendor;
+  UINT32                                      FirmwareRevision;
+  EFI_RUNTIME_SERVICES                        *RuntimeServices;
+  EFI_BOOT_SERVICES                           *BootServices;
+} EFI_SYSTEM_TABLE;
+
+#endif
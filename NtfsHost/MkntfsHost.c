@@ -0,0 +1,30 @@
+/** @file
+  Host build: the helpers mkntfs takes from security.c, which NtfsLib
+  does not build.
+
+**/
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "types.h"
+#include "layout.h"
+#include "security.h"
+
+/**
+  Generate a random version 4 GUID, as ntfs_generate_guid() of security.c.
+
+**/
+void ntfs_generate_guid(GUID *guid)
+{
+	unsigned int i;
+	u8 *p = (u8 *)guid;
+
+	srand(time(NULL));
+	for (i = 0; i < sizeof(GUID); i++)
+		p[i] = (u8)rand();
+	p[7] = (p[7] & 0x0f) | 0x40;
+	p[8] = (p[8] & 0x3f) | 0x80;
+}
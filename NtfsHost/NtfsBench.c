@@ -0,0 +1,1596 @@
+/** @file
+  Host build: benchmark driver of NtfsDxe. It loads the driver, starts it
+  on an image-backed disk and times file operations through
+  EFI_FILE_PROTOCOL, reporting the device requests and the counters of the
+  volume next to each measure. A few kernels of the NTFS library are timed
+  directly.
+
+  NtfsBench [options] image [benchmark ...]
+
+**/
+
+#include "Host.h"
+#include "Ntfs.h"
+
+#include "bitmap.h"
+
+#include <execinfo.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+EFI_STATUS
+EFIAPI
+NtfsEntryPoint (
+  IN EFI_HANDLE         ImageHandle,
+  IN EFI_SYSTEM_TABLE   *SystemTable
+  );
+
+EFI_STATUS
+EFIAPI
+NtfsUnload (
+  IN EFI_HANDLE         ImageHandle
+  );
+
+#define BENCH_CHECK(Expression) \
+  do { \
+    Status = (Expression); \
+    if (EFI_ERROR (Status)) { \
+      fprintf (stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, #Expression, HostStatusName (Status)); \
+      return Status; \
+    } \
+  } while (0)
+
+#define BENCH_ASSERT(Condition) \
+  do { \
+    if (!(Condition)) { \
+      fprintf (stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #Condition); \
+      return EFI_VOLUME_CORRUPTED; \
+    } \
+  } while (0)
+
+#define BENCH_CHUNK           SIZE_64KB
+#define BENCH_QUEUE           4
+#define BENCH_PATH_LENGTH     512
+
+#define BENCH_READ            EFI_FILE_MODE_READ
+#define BENCH_WRITE           (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE)
+#define BENCH_CREATE          (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE)
+
+typedef EFI_STATUS (*BENCH_FUNCTION) (VOID);
+
+typedef struct {
+  CONST CHAR8      *Name;
+  BENCH_FUNCTION   Function;
+  CONST CHAR8      *Help;
+} BENCH;
+
+//
+// A measure: the time, the device requests and the volume counters
+// around a number of operations
+//
+typedef struct {
+  UINT64                Start;
+  NTFS_TRACE_PROTOCOL   *Trace;
+  HOST_DISK_STATS       Disk;
+  NTFS_VOLUME_COUNTERS  Counters;
+} BENCH_TIMER;
+
+STATIC HOST_DISK                        *mDisk;
+STATIC EFI_HANDLE                       mDiskHandle;
+STATIC EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *mFs;
+STATIC EFI_FILE_PROTOCOL                *mRoot;
+STATIC NTFS_TRACE_PROTOCOL              *mTrace;
+STATIC UINTN                            mScale = 100;
+STATIC UINT64                           mSeed  = 0x9E3779B97F4A7C15ULL;
+
+/**
+  Scale a count by the -x percentage, keeping at least one.
+
+**/
+STATIC
+UINTN
+BenchCount (
+  IN UINTN  Count
+  )
+{
+  Count = Count * mScale / 100;
+  return Count == 0 ? 1 : Count;
+}
+
+STATIC
+UINT64
+BenchRandom (
+  VOID
+  )
+{
+  mSeed ^= mSeed << 13;
+  mSeed ^= mSeed >> 7;
+  mSeed ^= mSeed << 17;
+  return mSeed;
+}
+
+/**
+  Format an ASCII path into UCS-2, '/' being accepted for '\\'.
+
+**/
+STATIC
+CHAR16 *
+BenchPath (
+  OUT CHAR16       *Path,
+  IN  CONST CHAR8  *Format,
+  ...
+  )
+{
+  CHAR8    Ascii[BENCH_PATH_LENGTH];
+  VA_LIST  Marker;
+  UINTN    Index;
+
+  VA_START (Marker, Format);
+  vsnprintf (Ascii, sizeof (Ascii), Format, Marker);
+  VA_END (Marker);
+  for (Index = 0; Ascii[Index] != '\0'; Index++) {
+    Path[Index] = Ascii[Index] == '/' ? L'\\' : (CHAR16) Ascii[Index];
+  }
+  Path[Index] = L'\0';
+  return Path;
+}
+
+STATIC
+VOID
+BenchStart (
+  OUT BENCH_TIMER  *Timer
+  )
+{
+  HostDiskGetStats (mDisk, &Timer->Disk);
+  Timer->Trace = mTrace;
+  mTrace->GetCounters (mTrace, &Timer->Counters);
+  Timer->Start = HostNanoseconds ();
+}
+
+/**
+  Report a measure of Operations operations moving Bytes bytes.
+
+**/
+STATIC
+VOID
+BenchReport (
+  IN BENCH_TIMER  *Timer,
+  IN CONST CHAR8  *Name,
+  IN CONST CHAR8  *What,
+  IN UINT64       Operations,
+  IN UINT64       Bytes
+  )
+{
+  UINT64                Elapsed;
+  HOST_DISK_STATS       Disk;
+  NTFS_VOLUME_COUNTERS  Counters;
+
+  Elapsed = HostNanoseconds () - Timer->Start;
+  HostDiskGetStats (mDisk, &Disk);
+  mTrace->GetCounters (mTrace, &Counters);
+  if (mTrace != Timer->Trace) {
+    //
+    // Remounted, the counters of the new volume start from zero
+    //
+    ZeroMem (&Timer->Counters, sizeof (Timer->Counters));
+  }
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+  printf (
+    "%-8s %-24s %8llu ops %10.2f us/op",
+    Name,
+    What,
+    (unsigned long long) Operations,
+    Elapsed / 1000.0 / (Operations == 0 ? 1 : Operations)
+    );
+  if (Bytes != 0) {
+    printf (" %9.1f MB/s", Bytes * 1000.0 / Elapsed);
+  } else {
+    printf ("               ");
+  }
+  printf (
+    "  dev %6llu rd %6llu wr %5llu ard %4llu flush  mft %6llu idx %6llu  cache %llu/%llu\n",
+    (unsigned long long) (Disk.Reads - Timer->Disk.Reads),
+    (unsigned long long) (Disk.Writes - Timer->Disk.Writes),
+    (unsigned long long) (Disk.AsyncReads - Timer->Disk.AsyncReads),
+    (unsigned long long) (Disk.Flushes - Timer->Disk.Flushes),
+    (unsigned long long) (Counters.MftRecordReads - Timer->Counters.MftRecordReads),
+    (unsigned long long) (Counters.IndexBlockReads - Timer->Counters.IndexBlockReads),
+    (unsigned long long) (Counters.CacheHits - Timer->Counters.CacheHits),
+    (unsigned long long) (Counters.CacheHits - Timer->Counters.CacheHits + Counters.CacheMisses - Timer->Counters.CacheMisses)
+    );
+}
+
+/**
+  Start the driver on the disk and open its root directory.
+
+**/
+STATIC
+EFI_STATUS
+BenchMount (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  BENCH_CHECK (gBS->ConnectController (mDiskHandle, NULL, NULL, FALSE));
+  BENCH_CHECK (gBS->HandleProtocol (mDiskHandle, &gEfiSimpleFileSystemProtocolGuid, (VOID **) &mFs));
+  BENCH_CHECK (gBS->HandleProtocol (mDiskHandle, &gNtfsTraceProtocolGuid, (VOID **) &mTrace));
+  BENCH_CHECK (mFs->OpenVolume (mFs, &mRoot));
+  return EFI_SUCCESS;
+}
+
+/**
+  Close the root directory and stop the driver, which unmounts the volume.
+
+**/
+STATIC
+EFI_STATUS
+BenchUnmount (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  BENCH_CHECK (mRoot->Close (mRoot));
+  mRoot = NULL;
+  BENCH_CHECK (gBS->DisconnectController (mDiskHandle, gImageHandle, NULL));
+  mFs    = NULL;
+  mTrace = NULL;
+  return EFI_SUCCESS;
+}
+
+/**
+  Remount the volume, so that the next measure starts from cold caches.
+
+**/
+STATIC
+EFI_STATUS
+BenchRemount (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  BENCH_CHECK (BenchUnmount ());
+  return BenchMount ();
+}
+
+/**
+  Create the directories of Path under the root, the last one included.
+
+**/
+STATIC
+EFI_STATUS
+BenchMakePath (
+  IN CONST CHAR8  *Path
+  )
+{
+  CHAR16             Name[BENCH_PATH_LENGTH];
+  CONST CHAR8        *End;
+  EFI_FILE_PROTOCOL  *Dir;
+  EFI_STATUS         Status;
+
+  for (End = Path; End != NULL; End = strchr (End + 1, '/')) {
+    if (End == Path) {
+      continue;
+    }
+    BenchPath (Name, "%.*s", (int) (End - Path), Path);
+    BENCH_CHECK (mRoot->Open (mRoot, &Dir, Name, BENCH_CREATE, EFI_FILE_DIRECTORY));
+    Dir->Close (Dir);
+  }
+  BenchPath (Name, "%s", Path);
+  BENCH_CHECK (mRoot->Open (mRoot, &Dir, Name, BENCH_CREATE, EFI_FILE_DIRECTORY));
+  return Dir->Close (Dir);
+}
+
+/**
+  Fill Buffer with the content expected at Offset of a benchmark file.
+
+**/
+STATIC
+VOID
+BenchPattern (
+  OUT VOID    *Buffer,
+  IN  UINT64  Offset,
+  IN  UINTN   Size
+  )
+{
+  UINT64  *Word;
+  UINTN   Index;
+
+  ASSERT (Offset % sizeof (UINT64) == 0 && Size % sizeof (UINT64) == 0);
+  Word = Buffer;
+  for (Index = 0; Index < Size / sizeof (UINT64); Index++) {
+    Word[Index] = (Offset / sizeof (UINT64) + Index) * 0x9E3779B97F4A7C15ULL;
+  }
+}
+
+STATIC
+EFI_STATUS
+BenchCheckPattern (
+  IN VOID    *Buffer,
+  IN UINT64  Offset,
+  IN UINTN   Size
+  )
+{
+  UINT64  *Word;
+  UINTN   Index;
+
+  Word = Buffer;
+  for (Index = 0; Index < Size / sizeof (UINT64); Index++) {
+    if (Word[Index] != (Offset / sizeof (UINT64) + Index) * 0x9E3779B97F4A7C15ULL) {
+      fprintf (stderr, "bad data at offset %llu\n", (unsigned long long) (Offset + Index * sizeof (UINT64)));
+      return EFI_VOLUME_CORRUPTED;
+    }
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Time cold mounts, starting the driver on the disk each time, and the
+  OpenVolume calls served by a volume already mounted.
+
+**/
+STATIC
+EFI_STATUS
+BenchMountVolume (
+  VOID
+  )
+{
+  BENCH_TIMER        Timer;
+  EFI_FILE_PROTOCOL  *Root;
+  UINTN              Count;
+  UINTN              Index;
+  EFI_STATUS         Status;
+
+  Count = BenchCount (20);
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count; Index++) {
+    BENCH_CHECK (BenchRemount ());
+  }
+  BenchReport (&Timer, "mount", "start+OpenVolume cold", Count, 0);
+
+  Count = BenchCount (10000);
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count; Index++) {
+    BENCH_CHECK (mFs->OpenVolume (mFs, &Root));
+    BENCH_CHECK (Root->Close (Root));
+  }
+  BenchReport (&Timer, "mount", "OpenVolume warm", Count, 0);
+  return EFI_SUCCESS;
+}
+
+/**
+  Time opening a file 16 directories deep by its full path.
+
+**/
+STATIC
+EFI_STATUS
+BenchDeepOpen (
+  VOID
+  )
+{
+  CHAR8              Path[BENCH_PATH_LENGTH];
+  CHAR16             Name[BENCH_PATH_LENGTH];
+  UINTN              Length;
+  UINTN              Depth;
+  BENCH_TIMER        Timer;
+  EFI_FILE_PROTOCOL  *File;
+  UINTN              Count;
+  UINTN              Index;
+  EFI_STATUS         Status;
+
+  Length = snprintf (Path, sizeof (Path), "/bench/deep");
+  for (Depth = 0; Depth < 16; Depth++) {
+    Length += snprintf (Path + Length, sizeof (Path) - Length, "/Directory%02u", (unsigned) Depth);
+  }
+  BENCH_CHECK (BenchMakePath (Path));
+  snprintf (Path + Length, sizeof (Path) - Length, "/Leaf.txt");
+  BENCH_CHECK (mRoot->Open (mRoot, &File, BenchPath (Name, "%s", Path), BENCH_CREATE, 0));
+  File->Close (File);
+  BENCH_CHECK (BenchRemount ());
+
+  Count = BenchCount (1);
+  BenchStart (&Timer);
+  BENCH_CHECK (mRoot->Open (mRoot, &File, Name, BENCH_READ, 0));
+  File->Close (File);
+  BenchReport (&Timer, "open", "deep path cold", Count, 0);
+
+  Count = BenchCount (10000);
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count; Index++) {
+    BENCH_CHECK (mRoot->Open (mRoot, &File, Name, BENCH_READ, 0));
+    File->Close (File);
+  }
+  BenchReport (&Timer, "open", "deep path warm", Count, 0);
+  return EFI_SUCCESS;
+}
+
+/**
+  Read every entry of Dir, returning their number.
+
+**/
+STATIC
+EFI_STATUS
+BenchReadDirectory (
+  IN  EFI_FILE_PROTOCOL  *Dir,
+  OUT UINTN              *Entries
+  )
+{
+  UINT8       Buffer[SIZE_OF_EFI_FILE_INFO + BENCH_PATH_LENGTH * sizeof (CHAR16)];
+  UINTN       Size;
+  EFI_STATUS  Status;
+
+  *Entries = 0;
+  BENCH_CHECK (Dir->SetPosition (Dir, 0));
+  for (;;) {
+    Size = sizeof (Buffer);
+    BENCH_CHECK (Dir->Read (Dir, &Size, Buffer));
+    if (Size == 0) {
+      return EFI_SUCCESS;
+    }
+    (*Entries)++;
+  }
+}
+
+/**
+  Create files in Path named by Format and their number.
+
+**/
+STATIC
+EFI_STATUS
+BenchCreateFiles (
+  IN CONST CHAR8  *Path,
+  IN CONST CHAR8  *Format,
+  IN UINTN        Count,
+  IN CONST CHAR8  *Name
+  )
+{
+  CHAR16             FileName[BENCH_PATH_LENGTH];
+  CHAR8              Leaf[64];
+  EFI_FILE_PROTOCOL  *Dir;
+  EFI_FILE_PROTOCOL  *File;
+  BENCH_TIMER        Timer;
+  UINTN              Index;
+  EFI_STATUS         Status;
+
+  BENCH_CHECK (BenchMakePath (Path));
+  BENCH_CHECK (mRoot->Open (mRoot, &Dir, BenchPath (FileName, "%s", Path), BENCH_WRITE, 0));
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count; Index++) {
+    snprintf (Leaf, sizeof (Leaf), Format, (unsigned) Index);
+    BENCH_CHECK (Dir->Open (Dir, &File, BenchPath (FileName, "%s", Leaf), BENCH_CREATE, 0));
+    File->Close (File);
+  }
+  Dir->Close (Dir);
+  BenchReport (&Timer, Name, "create", Count, 0);
+  return EFI_SUCCESS;
+}
+
+/**
+  Time listing a directory of 2048 files.
+
+**/
+STATIC
+EFI_STATUS
+BenchDirectory (
+  VOID
+  )
+{
+  CHAR16             Name[BENCH_PATH_LENGTH];
+  EFI_FILE_PROTOCOL  *Dir;
+  BENCH_TIMER        Timer;
+  UINTN              Files;
+  UINTN              Entries;
+  UINTN              Count;
+  UINTN              Index;
+  EFI_STATUS         Status;
+
+  Files = BenchCount (2048);
+  BENCH_CHECK (BenchCreateFiles ("/bench/list", "Entry %05u with a longer name.dat", Files, "readdir"));
+  BENCH_CHECK (BenchRemount ());
+
+  BENCH_CHECK (mRoot->Open (mRoot, &Dir, BenchPath (Name, "/bench/list"), BENCH_READ, 0));
+  BenchStart (&Timer);
+  BENCH_CHECK (BenchReadDirectory (Dir, &Entries));
+  BenchReport (&Timer, "readdir", "list cold", Entries, 0);
+  BENCH_ASSERT (Entries == Files);
+
+  Count = BenchCount (20);
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count; Index++) {
+    BENCH_CHECK (BenchReadDirectory (Dir, &Entries));
+    BENCH_ASSERT (Entries == Files);
+  }
+  BenchReport (&Timer, "readdir", "list warm (per entry)", Count * Entries, 0);
+  Dir->Close (Dir);
+  return EFI_SUCCESS;
+}
+
+/**
+  Time looking up names in a directory of 20000 files, in any case and
+  with one name out of four missing, on a cold volume and then warm.
+
+**/
+STATIC
+EFI_STATUS
+BenchLookup (
+  VOID
+  )
+{
+  CHAR8              Leaf[64];
+  CHAR16             Name[BENCH_PATH_LENGTH];
+  EFI_FILE_PROTOCOL  *Dir;
+  EFI_FILE_PROTOCOL  *File;
+  BENCH_TIMER        Timer;
+  UINTN              Files;
+  UINTN              Count;
+  UINTN              Pass;
+  UINTN              Index;
+  UINTN              Char;
+  UINT64             Random;
+  UINT64             Seed;
+  BOOLEAN            Missing;
+  EFI_STATUS         Status;
+
+  Files = BenchCount (20000);
+  BENCH_CHECK (BenchCreateFiles ("/bench/lookup", "Lookup%06u.txt", Files, "lookup"));
+  BENCH_CHECK (BenchRemount ());
+
+  BENCH_CHECK (mRoot->Open (mRoot, &Dir, BenchPath (Name, "/bench/lookup"), BENCH_READ, 0));
+  //
+  // The warm pass looks up the same names again
+  //
+  Count = BenchCount (4096);
+  Seed  = mSeed;
+  for (Pass = 0; Pass < 2; Pass++) {
+    mSeed = Seed;
+    BenchStart (&Timer);
+    for (Index = 0; Index < Count; Index++) {
+      Random  = BenchRandom ();
+      Missing = (Random & 3) == 0;
+      snprintf (Leaf, sizeof (Leaf), Missing ? "Missing%06u.txt" : "Lookup%06u.txt", (unsigned) ((Random >> 8) % Files));
+      for (Char = 0; Leaf[Char] != '\0'; Char++) {
+        if (((Random >> (16 + Char % 32)) & 1) != 0) {
+          Leaf[Char] = (CHAR8) (Leaf[Char] >= 'a' && Leaf[Char] <= 'z' ? Leaf[Char] - 'a' + 'A' : Leaf[Char]);
+        } else {
+          Leaf[Char] = (CHAR8) (Leaf[Char] >= 'A' && Leaf[Char] <= 'Z' ? Leaf[Char] - 'A' + 'a' : Leaf[Char]);
+        }
+      }
+      Status = Dir->Open (Dir, &File, BenchPath (Name, "%s", Leaf), BENCH_READ, 0);
+      if (Missing) {
+        BENCH_ASSERT (Status == EFI_NOT_FOUND);
+      } else {
+        BENCH_CHECK (Status);
+        File->Close (File);
+      }
+    }
+    BenchReport (&Timer, "lookup", Pass == 0 ? "mixed case cold" : "mixed case warm", Count, 0);
+  }
+  Dir->Close (Dir);
+  return EFI_SUCCESS;
+}
+
+/**
+  Time deleting the files of a directory of 2048 files, and check that
+  the directory is empty on a remounted volume.
+
+**/
+STATIC
+EFI_STATUS
+BenchDelete (
+  VOID
+  )
+{
+  CHAR8              Leaf[64];
+  CHAR16             Name[BENCH_PATH_LENGTH];
+  EFI_FILE_PROTOCOL  *Dir;
+  EFI_FILE_PROTOCOL  *File;
+  BENCH_TIMER        Timer;
+  UINTN              Files;
+  UINTN              Entries;
+  UINTN              Index;
+  EFI_STATUS         Status;
+
+  Files = BenchCount (2048);
+  BENCH_CHECK (BenchCreateFiles ("/bench/delete", "Delete%05u.dat", Files, "delete"));
+  BENCH_CHECK (BenchRemount ());
+
+  BENCH_CHECK (mRoot->Open (mRoot, &Dir, BenchPath (Name, "/bench/delete"), BENCH_WRITE, 0));
+  BenchStart (&Timer);
+  for (Index = 0; Index < Files; Index++) {
+    snprintf (Leaf, sizeof (Leaf), "Delete%05u.dat", (unsigned) Index);
+    BENCH_CHECK (Dir->Open (Dir, &File, BenchPath (Name, "%s", Leaf), BENCH_WRITE, 0));
+    BENCH_CHECK (File->Delete (File));
+  }
+  BenchReport (&Timer, "delete", "open+Delete", Files, 0);
+  Dir->Close (Dir);
+
+  BENCH_CHECK (BenchRemount ());
+  BENCH_CHECK (mRoot->Open (mRoot, &Dir, BenchPath (Name, "/bench/delete"), BENCH_READ, 0));
+  BENCH_CHECK (BenchReadDirectory (Dir, &Entries));
+  Dir->Close (Dir);
+  BENCH_ASSERT (Entries == 0);
+  return EFI_SUCCESS;
+}
+
+/**
+  Write Size bytes of the pattern to Name in Chunk sized writes.
+
+**/
+STATIC
+EFI_STATUS
+BenchWriteFile (
+  IN CHAR16  *Name,
+  IN UINT64  Size,
+  IN UINTN   Chunk
+  )
+{
+  EFI_FILE_PROTOCOL  *File;
+  UINT8              *Buffer;
+  UINT64             Offset;
+  UINTN              Length;
+  EFI_STATUS         Status;
+
+  Buffer = AllocatePool (Chunk);
+  BENCH_ASSERT (Buffer != NULL);
+  Status = mRoot->Open (mRoot, &File, Name, BENCH_CREATE, 0);
+  for (Offset = 0; !EFI_ERROR (Status) && Offset < Size; Offset += Chunk) {
+    Length = Chunk;
+    BenchPattern (Buffer, Offset, Length);
+    Status = File->Write (File, &Length, Buffer);
+  }
+  FreePool (Buffer);
+  if (!EFI_ERROR (Status)) {
+    Status = File->Close (File);
+  }
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+BenchReadFile (
+  IN CHAR16  *Name,
+  IN UINT64  Size,
+  IN UINTN   Chunk
+  )
+{
+  EFI_FILE_PROTOCOL  *File;
+  UINT8              *Buffer;
+  UINT64             Offset;
+  UINTN              Length;
+  EFI_STATUS         Status;
+
+  Buffer = AllocatePool (Chunk);
+  BENCH_ASSERT (Buffer != NULL);
+  Status = mRoot->Open (mRoot, &File, Name, BENCH_READ, 0);
+  for (Offset = 0; !EFI_ERROR (Status) && Offset < Size; Offset += Chunk) {
+    Length = Chunk;
+    Status = File->Read (File, &Length, Buffer);
+    if (!EFI_ERROR (Status)) {
+      Status = Length == Chunk ? BenchCheckPattern (Buffer, Offset, Length) : EFI_END_OF_FILE;
+    }
+  }
+  FreePool (Buffer);
+  if (!EFI_ERROR (Status)) {
+    Status = File->Close (File);
+  }
+  return Status;
+}
+
+/**
+  Time sequential writes and reads of a 64MiB file, in 64KiB and in 4KiB
+  requests, and handles closed right after a few sequential reads.
+
+**/
+STATIC
+EFI_STATUS
+BenchSequential (
+  VOID
+  )
+{
+  CHAR16             Name[BENCH_PATH_LENGTH];
+  BENCH_TIMER        Timer;
+  EFI_FILE_PROTOCOL  *File;
+  UINT8              *Buffer;
+  UINT64             Size;
+  UINT64             Offset;
+  UINTN              Chunk;
+  UINTN              Length;
+  UINTN              Count;
+  UINTN              Index;
+  CHAR8              What[32];
+  EFI_STATUS         Status;
+
+  BENCH_CHECK (BenchMakePath ("/bench/seq"));
+  Size = BenchCount (64) * SIZE_1MB;
+  for (Chunk = BENCH_CHUNK; Chunk >= SIZE_4KB; Chunk /= 16) {
+    BenchPath (Name, "/bench/seq/File%u.bin", (unsigned) Chunk);
+    snprintf (What, sizeof (What), "write %uKiB", (unsigned) (Chunk / SIZE_1KB));
+    BenchStart (&Timer);
+    BENCH_CHECK (BenchWriteFile (Name, Size, Chunk));
+    BenchReport (&Timer, "seq", What, Size / Chunk, Size);
+    BENCH_CHECK (BenchRemount ());
+
+    snprintf (What, sizeof (What), "read %uKiB", (unsigned) (Chunk / SIZE_1KB));
+    BenchStart (&Timer);
+    BENCH_CHECK (BenchReadFile (Name, Size, Chunk));
+    BenchReport (&Timer, "seq", What, Size / Chunk, Size);
+  }
+
+  //
+  // Close handles whose read-ahead is still in flight, the notifications
+  // free the windows (the leak check at unload would tell otherwise)
+  //
+  Buffer = AllocatePool (BENCH_CHUNK);
+  BENCH_ASSERT (Buffer != NULL);
+  Count = BenchCount (64);
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count && !EFI_ERROR (Status); Index++) {
+    Status = mRoot->Open (mRoot, &File, Name, BENCH_READ, 0);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+    Offset = Size / Count * Index & ~(UINT64) (BENCH_CHUNK - 1);
+    Status = File->SetPosition (File, Offset);
+    for (Length = 0; !EFI_ERROR (Status) && Length < 2; Length++) {
+      Chunk  = BENCH_CHUNK;
+      Status = File->Read (File, &Chunk, Buffer);
+      if (!EFI_ERROR (Status)) {
+        Status = BenchCheckPattern (Buffer, Offset + Length * BENCH_CHUNK, Chunk);
+      }
+    }
+    File->Close (File);
+  }
+  FreePool (Buffer);
+  BENCH_CHECK (Status);
+  BenchReport (&Timer, "seq", "open+read 128KiB+close", Count, Count * 2 * BENCH_CHUNK);
+  return EFI_SUCCESS;
+}
+
+/**
+  Time non-blocking ReadEx() requests of 64KiB, four in flight, over a
+  16MiB file. A chunk rewritten just before through the same handle is
+  still in the block cache, the reads have to return it.
+
+**/
+STATIC
+EFI_STATUS
+BenchReadEx (
+  VOID
+  )
+{
+  CHAR16             Name[BENCH_PATH_LENGTH];
+  EFI_FILE_PROTOCOL  *File;
+  EFI_FILE_IO_TOKEN  Tokens[BENCH_QUEUE];
+  UINT8              *Buffers[BENCH_QUEUE];
+  BENCH_TIMER        Timer;
+  UINT64             Size;
+  UINT64             Patch;
+  UINT64             Issued;
+  UINT64             Done;
+  UINTN              Slot;
+  UINTN              Index;
+  UINTN              Length;
+  EFI_STATUS         Status;
+
+  BENCH_CHECK (BenchMakePath ("/bench/readex"));
+  BenchPath (Name, "/bench/readex/File.bin");
+  Size = BenchCount (16) * SIZE_1MB;
+  BENCH_CHECK (BenchWriteFile (Name, Size, BENCH_CHUNK));
+  BENCH_CHECK (BenchRemount ());
+
+  ZeroMem (Tokens, sizeof (Tokens));
+  for (Slot = 0; Slot < BENCH_QUEUE; Slot++) {
+    Buffers[Slot] = AllocatePool (BENCH_CHUNK);
+    BENCH_ASSERT (Buffers[Slot] != NULL);
+    BENCH_CHECK (gBS->CreateEvent (0, 0, NULL, NULL, &Tokens[Slot].Event));
+  }
+
+  //
+  // The chunk in the middle gets the pattern of an offset past the end
+  //
+  BENCH_CHECK (mRoot->Open (mRoot, &File, Name, BENCH_WRITE, 0));
+  Patch  = Size / 2;
+  Length = BENCH_CHUNK;
+  BenchPattern (Buffers[0], Patch + Size, Length);
+  BENCH_CHECK (File->SetPosition (File, Patch));
+  BENCH_CHECK (File->Write (File, &Length, Buffers[0]));
+  BENCH_CHECK (File->SetPosition (File, 0));
+
+  BenchStart (&Timer);
+  for (Issued = 0, Done = 0; Done < Size; Done += BENCH_CHUNK) {
+    for ( ; Issued < Size && Issued - Done < BENCH_QUEUE * BENCH_CHUNK; Issued += BENCH_CHUNK) {
+      Slot = (UINTN) (Issued / BENCH_CHUNK) % BENCH_QUEUE;
+      Tokens[Slot].BufferSize = BENCH_CHUNK;
+      Tokens[Slot].Buffer     = Buffers[Slot];
+      BENCH_CHECK (File->ReadEx (File, &Tokens[Slot]));
+    }
+    Slot = (UINTN) (Done / BENCH_CHUNK) % BENCH_QUEUE;
+    BENCH_CHECK (gBS->WaitForEvent (1, &Tokens[Slot].Event, &Index));
+    BENCH_CHECK (Tokens[Slot].Status);
+    BENCH_ASSERT (Tokens[Slot].BufferSize == BENCH_CHUNK);
+    BENCH_CHECK (BenchCheckPattern (Buffers[Slot], Done == Patch ? Patch + Size : Done, BENCH_CHUNK));
+  }
+  BenchReport (&Timer, "readex", "ReadEx 64KiB x4", Size / BENCH_CHUNK, Size);
+  BENCH_CHECK (File->Close (File));
+
+  for (Slot = 0; Slot < BENCH_QUEUE; Slot++) {
+    gBS->CloseEvent (Tokens[Slot].Event);
+    FreePool (Buffers[Slot]);
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Time reading back a 16MiB file of words written in a compressed
+  directory, which the library stores as LZNT1 compression units. The
+  volume is remounted before the read so that every unit is decompressed,
+  -l 0 leaves the decompression time alone.
+
+**/
+STATIC
+EFI_STATUS
+BenchLznt1 (
+  VOID
+  )
+{
+  STATIC CONST CHAR8  *Words[] = {
+    "volume", "index", "record", "cluster", "attribute", "runlist", "bitmap",
+    "sector", "entry", "directory", "stream", "security", "journal", "reparse"
+  };
+  CHAR16             Name[BENCH_PATH_LENGTH];
+  UINT8              Buffer[SIZE_OF_EFI_FILE_INFO + BENCH_PATH_LENGTH * sizeof (CHAR16)];
+  EFI_FILE_INFO      *Info;
+  EFI_FILE_PROTOCOL  *File;
+  BENCH_TIMER        Timer;
+  NTFS_VOLUME        *Volume;
+  ntfs_volume        *Vol;
+  ntfs_inode         *ni;
+  CHAR8              *Text;
+  UINT8              *Chunk;
+  UINT64             Size;
+  UINT64             Offset;
+  UINTN              Length;
+  CONST CHAR8        *Word;
+  BOOLEAN            Compressed;
+  EFI_STATUS         Status;
+
+  //
+  // EFI_FILE_INFO has no compressed attribute, set it through the library
+  // on the directory, the files created in it inherit it
+  //
+  BENCH_CHECK (BenchMakePath ("/bench/lznt1"));
+  Volume = VOLUME_FROM_VOL_INTERFACE (mFs)
+  Vol    = Volume->VolInfo;
+  NVolSetCompression (Vol);
+  ni = ntfs_pathname_to_inode (Vol, NULL, "\\bench\\lznt1");
+  BENCH_ASSERT (ni != NULL);
+  ni->flags |= FILE_ATTR_COMPRESSED;
+  NInoSetDirty (ni);
+  BENCH_ASSERT (ntfs_inode_close (ni) == 0);
+
+  Size = BenchCount (16) * SIZE_1MB;
+  Text = AllocatePool ((UINTN) Size);
+  BENCH_ASSERT (Text != NULL);
+  for (Offset = 0; Offset < Size; Offset += Length) {
+    Word   = Words[BenchRandom () % ARRAY_SIZE (Words)];
+    Length = MIN (strlen (Word) + 1, (UINTN) (Size - Offset));
+    CopyMem (Text + Offset, Word, Length - 1);
+    Text[Offset + Length - 1] = (BenchRandom () & 7) == 0 ? '\n' : ' ';
+  }
+
+  BenchPath (Name, "/bench/lznt1/Words.txt");
+  BENCH_CHECK (mRoot->Open (mRoot, &File, Name, BENCH_CREATE, 0));
+  BenchStart (&Timer);
+  for (Offset = 0; Offset < Size; Offset += Length) {
+    Length = BENCH_CHUNK;
+    BENCH_CHECK (File->Write (File, &Length, Text + Offset));
+  }
+  BENCH_CHECK (File->Close (File));
+  BenchReport (&Timer, "lznt1", "write 64KiB", Size / BENCH_CHUNK, Size);
+
+  Chunk = AllocatePool (BENCH_CHUNK);
+  BENCH_ASSERT (Chunk != NULL);
+  BENCH_CHECK (BenchRemount ());
+  BENCH_CHECK (mRoot->Open (mRoot, &File, Name, BENCH_READ, 0));
+  BenchStart (&Timer);
+  for (Offset = 0; Offset < Size; Offset += Length) {
+    Length = BENCH_CHUNK;
+    BENCH_CHECK (File->Read (File, &Length, Chunk));
+    BENCH_ASSERT (Length == BENCH_CHUNK && CompareMem (Chunk, Text + Offset, Length) == 0);
+  }
+  BenchReport (&Timer, "lznt1", "read 64KiB cold", Size / BENCH_CHUNK, Size);
+  File->Close (File);
+
+  BENCH_CHECK (mRoot->Open (mRoot, &File, Name, BENCH_READ, 0));
+  Length = sizeof (Buffer);
+  BENCH_CHECK (File->GetInfo (File, &gEfiFileInfoGuid, &Length, Buffer));
+  File->Close (File);
+  Info = (EFI_FILE_INFO *) Buffer;
+  printf (
+    "lznt1    %llu bytes stored in %llu\n",
+    (unsigned long long) Info->FileSize,
+    (unsigned long long) Info->PhysicalSize
+    );
+  BENCH_ASSERT (Info->FileSize == Size && Info->PhysicalSize < Size);
+
+  //
+  // SetInfo() changes the EFI attributes only, the file stays compressed
+  //
+  BENCH_CHECK (mRoot->Open (mRoot, &File, Name, BENCH_WRITE, 0));
+  Info->Attribute |= EFI_FILE_ARCHIVE;
+  Status = File->SetInfo (File, &gEfiFileInfoGuid, (UINTN) Info->Size, Info);
+  File->Close (File);
+  BENCH_CHECK (Status);
+  BENCH_CHECK (BenchRemount ());
+  Volume = VOLUME_FROM_VOL_INTERFACE (mFs)
+  ni = ntfs_pathname_to_inode (Volume->VolInfo, NULL, "\\bench\\lznt1\\Words.txt");
+  BENCH_ASSERT (ni != NULL);
+  Compressed = (BOOLEAN) ((ni->flags & FILE_ATTR_COMPRESSED) != 0);
+  BENCH_ASSERT (ntfs_inode_close (ni) == 0);
+  BENCH_ASSERT (Compressed);
+
+  FreePool (Chunk);
+  FreePool (Text);
+  return EFI_SUCCESS;
+}
+
+/**
+  Time 4KiB reads and writes at random offsets of a 64MiB file.
+
+**/
+STATIC
+EFI_STATUS
+BenchRandomIo (
+  VOID
+  )
+{
+  CHAR16             Name[BENCH_PATH_LENGTH];
+  BENCH_TIMER        Timer;
+  EFI_FILE_PROTOCOL  *File;
+  UINT8              Buffer[SIZE_4KB];
+  UINT64             Size;
+  UINT64             Offset;
+  UINTN              Length;
+  UINTN              Count;
+  UINTN              Index;
+  EFI_STATUS         Status;
+
+  BENCH_CHECK (BenchMakePath ("/bench/random"));
+  BenchPath (Name, "/bench/random/File.bin");
+  Size = BenchCount (64) * SIZE_1MB;
+  BENCH_CHECK (BenchWriteFile (Name, Size, BENCH_CHUNK));
+  BENCH_CHECK (BenchRemount ());
+
+  BENCH_CHECK (mRoot->Open (mRoot, &File, Name, BENCH_WRITE, 0));
+  Count = BenchCount (4096);
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count; Index++) {
+    Offset = BenchRandom () % (Size / sizeof (Buffer)) * sizeof (Buffer);
+    Length = sizeof (Buffer);
+    BENCH_CHECK (File->SetPosition (File, Offset));
+    BENCH_CHECK (File->Read (File, &Length, Buffer));
+    BENCH_ASSERT (Length == sizeof (Buffer));
+    BENCH_CHECK (BenchCheckPattern (Buffer, Offset, Length));
+  }
+  BenchReport (&Timer, "random", "read 4KiB", Count, Count * sizeof (Buffer));
+
+  Count = BenchCount (1024);
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count; Index++) {
+    Offset = BenchRandom () % (Size / sizeof (Buffer)) * sizeof (Buffer);
+    Length = sizeof (Buffer);
+    BenchPattern (Buffer, Offset, Length);
+    BENCH_CHECK (File->SetPosition (File, Offset));
+    BENCH_CHECK (File->Write (File, &Length, Buffer));
+  }
+  BENCH_CHECK (File->Flush (File));
+  BenchReport (&Timer, "random", "write 4KiB + flush", Count, Count * sizeof (Buffer));
+  File->Close (File);
+  return EFI_SUCCESS;
+}
+
+/**
+  Time opening, reading and closing a second handle of a file while the
+  first one keeps appending 4KiB, both share the pinned inode and the
+  reads have to see the data still buffered by the writes. The file is
+  then deleted through a third handle, the first one sees it gone.
+
+**/
+STATIC
+EFI_STATUS
+BenchShared (
+  VOID
+  )
+{
+  CHAR16             Name[BENCH_PATH_LENGTH];
+  BENCH_TIMER        Timer;
+  EFI_FILE_PROTOCOL  *Writer;
+  EFI_FILE_PROTOCOL  *Reader;
+  UINT8              Buffer[SIZE_4KB];
+  EFI_FILE_INFO      *Info;
+  UINT64             Offset;
+  UINTN              Length;
+  UINTN              Count;
+  UINTN              Index;
+  EFI_STATUS         Status;
+
+  BENCH_CHECK (BenchMakePath ("/bench/shared"));
+  BenchPath (Name, "/bench/shared/File.bin");
+  BENCH_CHECK (mRoot->Open (mRoot, &Writer, Name, BENCH_CREATE, 0));
+
+  Count = BenchCount (1024);
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count; Index++) {
+    Offset = Index * sizeof (Buffer);
+    Length = sizeof (Buffer);
+    BenchPattern (Buffer, Offset, Length);
+    BENCH_CHECK (Writer->Write (Writer, &Length, Buffer));
+
+    BENCH_CHECK (mRoot->Open (mRoot, &Reader, Name, BENCH_READ, 0));
+    Length = sizeof (Buffer);
+    ZeroMem (Buffer, Length);
+    BENCH_CHECK (Reader->SetPosition (Reader, Offset));
+    BENCH_CHECK (Reader->Read (Reader, &Length, Buffer));
+    BENCH_ASSERT (Length == sizeof (Buffer));
+    BENCH_CHECK (BenchCheckPattern (Buffer, Offset, Length));
+    BENCH_CHECK (Reader->Close (Reader));
+  }
+  BenchReport (&Timer, "shared", "write+open+read+close", Count, Count * sizeof (Buffer));
+
+  //
+  // The clusters preallocated ahead of the writes are not reported, by
+  // the handle nor by its directory
+  //
+  BENCH_CHECK (Writer->Flush (Writer));
+  Length = sizeof (Buffer);
+  BENCH_CHECK (Writer->GetInfo (Writer, &gEfiFileInfoGuid, &Length, Buffer));
+  Info = (EFI_FILE_INFO *) Buffer;
+  BENCH_ASSERT (Info->FileSize == Count * sizeof (Buffer));
+  BENCH_ASSERT (Info->PhysicalSize >= Info->FileSize && Info->PhysicalSize < Info->FileSize + SIZE_64KB);
+  BENCH_CHECK (mRoot->Open (mRoot, &Reader, BenchPath (Name, "/bench/shared"), BENCH_READ, 0));
+  Length = sizeof (Buffer);
+  Status = Reader->Read (Reader, &Length, Buffer);
+  Reader->Close (Reader);
+  BENCH_ASSERT (!EFI_ERROR (Status) && Length != 0);
+  BENCH_ASSERT (Info->FileSize == Count * sizeof (Buffer));
+  BENCH_ASSERT (Info->PhysicalSize >= Info->FileSize && Info->PhysicalSize < Info->FileSize + SIZE_64KB);
+  BenchPath (Name, "/bench/shared/File.bin");
+
+  BENCH_CHECK (mRoot->Open (mRoot, &Reader, Name, BENCH_WRITE, 0));
+  BENCH_CHECK (Reader->Delete (Reader));
+  Length = sizeof (Buffer);
+  BENCH_CHECK (Writer->SetPosition (Writer, 0));
+  BENCH_ASSERT (EFI_ERROR (Writer->Read (Writer, &Length, Buffer)));
+  Writer->Close (Writer);
+
+  BENCH_CHECK (BenchRemount ());
+  BENCH_ASSERT (mRoot->Open (mRoot, &Reader, Name, BENCH_READ, 0) == EFI_NOT_FOUND);
+  return EFI_SUCCESS;
+}
+
+/**
+  Time the bitmap kernels of the library on a 256MiB bitmap in memory,
+  the size of the $Bitmap of an 8TiB volume of 4KiB clusters. It is made
+  of alternating runs of set and clear bits, mostly short, and the
+  results are checked against the runs.
+
+**/
+STATIC
+EFI_STATUS
+BenchBitmap (
+  VOID
+  )
+{
+  BENCH_TIMER  Timer;
+  UINT8        *Bitmap;
+  UINT64       Size;
+  s64          Bits;
+  s64          Bit;
+  s64          Run;
+  s64          Set;
+  s64          Runs;
+  s64          Longest;
+  s64          LongestStart;
+  s64          Length;
+  s64          Found;
+  UINTN        Calls;
+  UINTN        Count;
+  UINTN        Index;
+  BOOLEAN      Value;
+
+  Size   = BenchCount (256) * SIZE_1MB;
+  Bits   = (s64) Size * 8;
+  Bitmap = AllocatePool ((UINTN) Size);
+  BENCH_ASSERT (Bitmap != NULL);
+
+  //
+  // Alternate runs of 1 to 64 bits with, once in sixteen, up to 64Ki bits
+  //
+  Set          = 0;
+  Runs         = 0;
+  Longest      = 0;
+  LongestStart = -1;
+  Calls        = 0;
+  Value        = TRUE;
+  BenchStart (&Timer);
+  for (Bit = 0; Bit < Bits; Bit += Run) {
+    Run = (BenchRandom () & 15) == 0 ? 1 + BenchRandom () % SIZE_64KB : 1 + BenchRandom () % 64;
+    Run = MIN (Run, Bits - Bit);
+    ntfs_bits_set_range (Bitmap, Bit, Run, Value);
+    Calls++;
+    if (Value) {
+      Set += Run;
+    } else {
+      Runs++;
+      if (Run > Longest) {
+        Longest      = Run;
+        LongestStart = Bit;
+      }
+    }
+    Value = !Value;
+  }
+  BenchReport (&Timer, "bitmap", "set_range fill", Calls, Size);
+
+  Count = BenchCount (10);
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count; Index++) {
+    BENCH_ASSERT (ntfs_bits_weight (Bitmap, Bits) == Set);
+  }
+  BenchReport (&Timer, "bitmap", "weight", Count, Count * Size);
+
+  //
+  // Walk the runs the way the cluster allocator does: find a clear bit,
+  // then the set bit ending its run
+  //
+  BenchStart (&Timer);
+  Found = 0;
+  Calls = 0;
+  for (Bit = 0; ; Bit = Run) {
+    Bit = ntfs_bits_find_zero (Bitmap, Bit, Bits);
+    Calls++;
+    if (Bit < 0) {
+      break;
+    }
+    Found++;
+    Run = ntfs_bits_find_set (Bitmap, Bit, Bits);
+    Calls++;
+    if (Run < 0) {
+      break;
+    }
+  }
+  BenchReport (&Timer, "bitmap", "find_zero/find_set walk", Calls, Size);
+  BENCH_ASSERT (Found == Runs);
+
+  Count = BenchCount (10);
+  BenchStart (&Timer);
+  for (Index = 0; Index < Count; Index++) {
+    BENCH_ASSERT (ntfs_bits_longest_zero_run (Bitmap, Bits, &Length) == LongestStart);
+    BENCH_ASSERT (Length == Longest);
+  }
+  BenchReport (&Timer, "bitmap", "longest_zero_run", Count, Count * Size);
+
+  FreePool (Bitmap);
+  return EFI_SUCCESS;
+}
+
+/**
+  Time ntfs_attr_find_vcn() on the runlist of a file fragmented into
+  100000 runs, one in eight being a hole. The attribute is built in memory,
+  so that the runlist is never mapped from an MFT record. A linear walk of
+  the runlist gives the reference result and time.
+
+**/
+STATIC
+EFI_STATUS
+BenchRunlist (
+  VOID
+  )
+{
+  BENCH_TIMER      Timer;
+  ntfs_inode       *ni;
+  ntfs_attr        *na;
+  runlist_element  *rl;
+  runlist_element  *Found;
+  runlist_element  *Walk;
+  VCN              *Vcns;
+  VCN              End;
+  LCN              Lcn;
+  UINTN            Runs;
+  UINTN            Count;
+  UINTN            Index;
+  EFI_STATUS       Status;
+
+  Runs = BenchCount (100000);
+  Vcns = AllocatePool (Runs * 2 * sizeof (VCN));
+  rl   = AllocatePool ((Runs + 1) * sizeof (runlist_element));
+  ni   = AllocateZeroPool (sizeof (ntfs_inode));
+  na   = AllocateZeroPool (sizeof (ntfs_attr));
+  BENCH_ASSERT (Vcns != NULL && rl != NULL && ni != NULL && na != NULL);
+
+  End = 0;
+  Lcn = 0;
+  for (Index = 0; Index < Runs; Index++) {
+    rl[Index].vcn    = End;
+    rl[Index].length = 1 + BenchRandom () % 16;
+    if ((BenchRandom () & 7) == 0) {
+      rl[Index].lcn = LCN_HOLE;
+    } else {
+      Lcn           += 1 + BenchRandom () % 64;
+      rl[Index].lcn  = Lcn;
+      Lcn           += rl[Index].length;
+    }
+    End += rl[Index].length;
+  }
+  rl[Runs].vcn    = End;
+  rl[Runs].lcn    = LCN_ENOENT;
+  rl[Runs].length = 0;
+
+  na->ni   = ni;
+  na->type = AT_DATA;
+  na->rl   = rl;
+  NAttrSetNonResident (na);
+
+  //
+  // Every run once from the start, as a sequential read does, then the
+  // same number of random clusters
+  //
+  for (Index = 0; Index < Runs; Index++) {
+    Vcns[Index] = rl[Index].vcn + rl[Index].length / 2;
+  }
+  for (Index = Runs; Index < Runs * 2; Index++) {
+    Vcns[Index] = BenchRandom () % End;
+  }
+
+  Status = EFI_SUCCESS;
+  BenchStart (&Timer);
+  for (Index = 0; Index < Runs; Index++) {
+    Found = ntfs_attr_find_vcn (na, Vcns[Index]);
+    if (Found != &rl[Index]) {
+      Status = EFI_VOLUME_CORRUPTED;
+    }
+  }
+  BenchReport (&Timer, "runlist", "find_vcn sequential", Runs, 0);
+
+  BenchStart (&Timer);
+  for (Index = Runs; Index < Runs * 2; Index++) {
+    Found = ntfs_attr_find_vcn (na, Vcns[Index]);
+    if (Found == NULL || Vcns[Index] < Found->vcn || Vcns[Index] >= Found[1].vcn) {
+      Status = EFI_VOLUME_CORRUPTED;
+    }
+  }
+  BenchReport (&Timer, "runlist", "find_vcn random", Runs, 0);
+
+  Count = MIN (Runs, BenchCount (4096));
+  BenchStart (&Timer);
+  for (Index = Runs; Index < Runs + Count; Index++) {
+    for (Walk = rl; Walk[1].vcn <= Vcns[Index]; Walk++) {
+    }
+    if (Walk != ntfs_attr_find_vcn (na, Vcns[Index])) {
+      Status = EFI_VOLUME_CORRUPTED;
+    }
+  }
+  BenchReport (&Timer, "runlist", "linear walk (reference)", Count, 0);
+
+  FreePool (na);
+  FreePool (ni);
+  FreePool (rl);
+  FreePool (Vcns);
+  BENCH_ASSERT (!EFI_ERROR (Status));
+  return EFI_SUCCESS;
+}
+
+/**
+  Merge Count single runs with ntfs_runlists_merge() into the holes of a
+  runlist of Runs runs, each splitting its hole in three. Middle is the
+  index of the pair (data run, 3 cluster hole) receiving the first one.
+
+  @param  Runs                  - Runs of the runlist before the merges.
+  @param  Middle                - First pair receiving a run.
+  @param  Count                 - Runs to merge.
+  @param  Name                  - What to report.
+
+**/
+STATIC
+EFI_STATUS
+BenchMergeRuns (
+  IN UINTN        Runs,
+  IN UINTN        Middle,
+  IN UINTN        Count,
+  IN CONST CHAR8  *Name
+  )
+{
+  BENCH_TIMER      Timer;
+  runlist_element  *rl;
+  runlist_element  *Run;
+  UINTN            Pairs;
+  UINTN            Size;
+  UINTN            Index;
+  EFI_STATUS       Status;
+
+  //
+  // ntfs_rl_realloc() expects the runlists in power of two blocks of at
+  // least 4KiB, allocate one for the final runlist
+  //
+  Pairs = Runs / 2;
+  for (Size = SIZE_4KB; Size < (Pairs * 2 + Count * 2 + 1) * sizeof (runlist_element); Size <<= 1) {
+  }
+  rl = ntfs_malloc (Size);
+  BENCH_ASSERT (rl != NULL);
+  for (Index = 0; Index < Pairs; Index++) {
+    rl[Index * 2].vcn        = Index * 4;
+    rl[Index * 2].lcn        = Index * 4;
+    rl[Index * 2].length     = 1;
+    rl[Index * 2 + 1].vcn    = Index * 4 + 1;
+    rl[Index * 2 + 1].lcn    = LCN_HOLE;
+    rl[Index * 2 + 1].length = 3;
+  }
+  rl[Pairs * 2].vcn    = Pairs * 4;
+  rl[Pairs * 2].lcn    = LCN_ENOENT;
+  rl[Pairs * 2].length = 0;
+
+  Status = EFI_SUCCESS;
+  BenchStart (&Timer);
+  for (Index = Middle; Index < Middle + Count && rl != NULL; Index++) {
+    Run = ntfs_malloc (2 * sizeof (runlist_element));
+    BENCH_ASSERT (Run != NULL);
+    Run[0].vcn    = Index * 4 + 2;
+    Run[0].lcn    = Index * 4 + 2;
+    Run[0].length = 1;
+    Run[1].vcn    = Index * 4 + 3;
+    Run[1].lcn    = LCN_RL_NOT_MAPPED;
+    Run[1].length = 0;
+    rl = ntfs_runlists_merge (rl, Run);
+  }
+  BenchReport (&Timer, "rlmerge", Name, Count, 0);
+
+  if (rl == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  for (Index = Middle; Index < Middle + Count; Index++) {
+    if (ntfs_rl_vcn_to_lcn (rl, Index * 4 + 2) != (LCN) (Index * 4 + 2) ||
+        ntfs_rl_vcn_to_lcn (rl, Index * 4 + 3) != LCN_HOLE) {
+      Status = EFI_VOLUME_CORRUPTED;
+    }
+  }
+  for (Index = 0; rl[Index].length != 0; Index++) {
+  }
+  if (Index != Pairs * 2 + Count * 2) {
+    Status = EFI_VOLUME_CORRUPTED;
+  }
+  free (rl);
+  return Status;
+}
+
+/**
+  Time ntfs_runlists_merge() of single runs into the middle and into the
+  tail of runlists of two sizes. The runlist stays one array: a merge in
+  the middle moves the whole tail, and any merge scans to the end of the
+  runlist, so the time of each grows with the runlist.
+
+**/
+STATIC
+EFI_STATUS
+BenchRunlistMerge (
+  VOID
+  )
+{
+  UINTN       Runs;
+  UINTN       Count;
+  CHAR8       What[32];
+  EFI_STATUS  Status;
+
+  Count = BenchCount (2048);
+  for (Runs = BenchCount (25000) * 2; Runs <= BenchCount (100000) * 2; Runs *= 4) {
+    snprintf (What, sizeof (What), "middle, %u runs", (unsigned) Runs);
+    BENCH_CHECK (BenchMergeRuns (Runs, Runs / 4, Count, What));
+    snprintf (What, sizeof (What), "tail, %u runs", (unsigned) Runs);
+    BENCH_CHECK (BenchMergeRuns (Runs, Runs / 2 - Count, Count, What));
+  }
+  return EFI_SUCCESS;
+}
+
+STATIC CONST BENCH  mBenchmarks[] = {
+  { "mount",   BenchMountVolume, "cold mounts and warm OpenVolume calls"        },
+  { "open",    BenchDeepOpen,    "open a file 16 directories deep"              },
+  { "readdir", BenchDirectory,   "list a directory of 2048 files"               },
+  { "lookup",  BenchLookup,      "look up names in a directory of 20000 files"  },
+  { "delete",  BenchDelete,      "delete the files of a directory of 2048 files" },
+  { "seq",     BenchSequential,  "sequential 64KiB and 4KiB writes and reads"   },
+  { "random",  BenchRandomIo,    "random 4KiB reads and writes"                 },
+  { "shared",  BenchShared,      "two handles of a file sharing its inode"      },
+  { "readex",  BenchReadEx,      "non-blocking 64KiB reads, four in flight"     },
+  { "lznt1",   BenchLznt1,       "read back a compressed 16MiB text file"       },
+  { "bitmap",  BenchBitmap,      "bitmap kernels on a 256MiB bitmap"            },
+  { "runlist", BenchRunlist,     "ntfs_attr_find_vcn on a 100000 run file"      },
+  { "rlmerge", BenchRunlistMerge, "ntfs_runlists_merge into 50000 and 200000 runs" },
+};
+
+/**
+  SIGALRM handler of the -w watchdog: show where the driver is stuck.
+
+**/
+STATIC
+VOID
+BenchWatchdog (
+  int  Signal
+  )
+{
+  VOID  *Frames[64];
+
+  fprintf (stderr, "watchdog expired\n");
+  backtrace_symbols_fd (Frames, backtrace (Frames, ARRAY_SIZE (Frames)), 2);
+  _exit (3);
+}
+
+STATIC
+VOID
+BenchUsage (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  fprintf (
+    stderr,
+    "usage: NtfsBench [options] image [benchmark ...]\n"
+    "  -l us      latency of each device request (100)\n"
+    "  -b MB/s    bandwidth of the device (500)\n"
+    "  -a bytes   IoAlign of the device (0)\n"
+    "  -n         do not install DiskIo2\n"
+    "  -x percent scale the sizes and counts of the benchmarks (100)\n"
+    "  -c bytes   PcdNtfsCacheBudget (0, the driver default)\n"
+    "  -d mask    debug level of DEBUG() prints (0x80000000, errors)\n"
+    "  -w seconds abort with a backtrace after that time\n"
+    "benchmarks, all by default:\n"
+    );
+  for (Index = 0; Index < ARRAY_SIZE (mBenchmarks); Index++) {
+    fprintf (stderr, "  %-10s %s\n", mBenchmarks[Index].Name, mBenchmarks[Index].Help);
+  }
+}
+
+STATIC
+EFI_STATUS
+BenchRun (
+  IN CONST CHAR8  *Name
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mBenchmarks); Index++) {
+    if (strcmp (Name, mBenchmarks[Index].Name) == 0) {
+      return mBenchmarks[Index].Function ();
+    }
+  }
+  fprintf (stderr, "unknown benchmark %s\n", Name);
+  return EFI_INVALID_PARAMETER;
+}
+
+int
+main (
+  int   argc,
+  char  **argv
+  )
+{
+  HOST_DISK_CONFIG  Config;
+  HOST_POOL_STATS   Pool;
+  UINT64            PoolMark;
+  EFI_STATUS        Status;
+  UINTN             Index;
+  int               Option;
+
+  setvbuf (stdout, NULL, _IOLBF, 0);
+  ZeroMem (&Config, sizeof (Config));
+  Config.LatencyNs = 100000;
+  Config.Bandwidth = 500ULL * 1000 * 1000;
+  while ((Option = getopt (argc, argv, "l:b:a:nx:c:d:w:h")) != -1) {
+    switch (Option) {
+    case 'l':
+      Config.LatencyNs = strtoull (optarg, NULL, 0) * 1000;
+      break;
+    case 'b':
+      Config.Bandwidth = strtoull (optarg, NULL, 0) * 1000 * 1000;
+      break;
+    case 'a':
+      Config.IoAlign = (UINT32) strtoul (optarg, NULL, 0);
+      break;
+    case 'n':
+      Config.NoDiskIo2 = TRUE;
+      break;
+    case 'x':
+      mScale = strtoul (optarg, NULL, 0);
+      break;
+    case 'c':
+      gHostPcd.PcdNtfsCacheBudget = (UINT32) strtoul (optarg, NULL, 0);
+      break;
+    case 'd':
+      gHostDebugLevel = strtoul (optarg, NULL, 0);
+      break;
+    case 'w':
+      signal (SIGALRM, BenchWatchdog);
+      alarm ((unsigned) strtoul (optarg, NULL, 0));
+      break;
+    default:
+      BenchUsage ();
+      return 2;
+    }
+  }
+  if (optind >= argc || mScale == 0) {
+    BenchUsage ();
+    return 2;
+  }
+
+  Status = HostUefiInitialize ();
+  if (!EFI_ERROR (Status)) {
+    Status = HostDiskOpen (argv[optind], &Config, &mDisk);
+  }
+  if (EFI_ERROR (Status)) {
+    return 1;
+  }
+  mDiskHandle = HostDiskHandle (mDisk);
+  Pool        = gHostPool;
+  PoolMark    = HostPoolMark ();
+
+  Status = NtfsEntryPoint (gImageHandle, gST);
+  if (!EFI_ERROR (Status)) {
+    Status = BenchMount ();
+  }
+  if (!EFI_ERROR (Status)) {
+    printf (
+      "%s: latency %lluus, %lluMB/s, IoAlign %u%s, scale %u%%\n",
+      argv[optind],
+      (unsigned long long) (Config.LatencyNs / 1000),
+      (unsigned long long) (Config.Bandwidth / 1000 / 1000),
+      (unsigned) Config.IoAlign,
+      Config.NoDiskIo2 ? ", no DiskIo2" : "",
+      (unsigned) mScale
+      );
+    if (optind + 1 == argc) {
+      for (Index = 0; Index < ARRAY_SIZE (mBenchmarks) && !EFI_ERROR (Status); Index++) {
+        Status = mBenchmarks[Index].Function ();
+      }
+    } else {
+      for (Index = optind + 1; Index < (UINTN) argc && !EFI_ERROR (Status); Index++) {
+        Status = BenchRun (argv[Index]);
+      }
+    }
+  }
+  if (mRoot != NULL) {
+    if (!EFI_ERROR (BenchUnmount ()) && !EFI_ERROR (Status)) {
+      Status = NtfsUnload (gImageHandle);
+    }
+  }
+
+  //
+  // Everything the driver allocated is to be freed once it is unloaded
+  //
+  if (!EFI_ERROR (Status) &&
+      (gHostPool.PoolAllocations != Pool.PoolAllocations ||
+       gHostPool.PageAllocations != Pool.PageAllocations ||
+       gHostPool.Events != Pool.Events)) {
+    fprintf (
+      stderr,
+      "leaked %lld pool allocations (%lld bytes), %lld page allocations (%lld pages), %lld events\n",
+      (long long) (gHostPool.PoolAllocations - Pool.PoolAllocations),
+      (long long) (gHostPool.PoolBytes - Pool.PoolBytes),
+      (long long) (gHostPool.PageAllocations - Pool.PageAllocations),
+      (long long) (gHostPool.Pages - Pool.Pages),
+      (long long) (gHostPool.Events - Pool.Events)
+      );
+    HostPoolDump (PoolMark);
+    Status = EFI_OUT_OF_RESOURCES;
+  }
+  HostDiskClose (mDisk);
+  if (EFI_ERROR (Status)) {
+    fprintf (stderr, "NtfsBench: %s\n", HostStatusName (Status));
+    return 1;
+  }
+  return 0;
+}
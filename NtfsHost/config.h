@@ -0,0 +1,49 @@
+/*
+ * Host configuration of the library, see Library/config.h for the
+ * firmware one. The C library of the host provides the same headers,
+ * time and string functions as the edk2-libc StdLib.
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <Base.h>
+
+/*
+ * The StdLib <stdio.h> brings PATH_MAX in, glibc keeps it in <limits.h>
+ */
+#include <limits.h>
+
+#define HAVE_STDIO_H
+#define HAVE_STDLIB_H
+#define HAVE_STRING_H
+#define HAVE_ERRNO_H
+#define HAVE_SYS_STAT_H
+#define HAVE_FCNTL_H
+#define HAVE_SYS_TYPES_H
+#define HAVE_STDDEF_H
+#define HAVE_LOCALE_H
+#define HAVE_TIME_H
+#define HAVE_CTYPE_H
+#define HAVE_LIMITS_H
+#define HAVE_UNISTD_H
+#define HAVE_STDARG_H
+#define HAVE_STRSEP
+#define HAVE_FFS
+
+#define MAJOR_IN_SYSMACROS
+
+#define HAVE_DAEMON
+#define HAVE_GETTIMEOFDAY
+
+/*
+ * File attribute bits of the edk2-libc <sys/stat.h>, passed by the
+ * driver to ntfs_create()
+ */
+#define S_IREADONLY   0x10000000
+#define S_IHIDDEN     0x20000000
+#define S_ISYSTEM     0x40000000
+
+#undef linux
+
+#endif /* CONFIG_H */
@@ -0,0 +1,267 @@
+/** @file
+  Shell application dumping the counters and the trace events of the
+  volumes mounted by NtfsDxe.
+
+  Usage: NtfsTrace [-r]
+
+    -r    Reset the counters and the events once they are dumped.
+
+  Events are only recorded by a driver built with NTFS_TRACE defined.
+  Times are shown in microseconds, from a TSC rate measured at start.
+  The hit ratios of the library caches are counted from the mount of the
+  volume, they are not cleared by -r.
+
+**/
+
+#include <Uefi.h>
+
+#include <Protocol/ShellParameters.h>
+
+#include <Library/BaseLib.h>
+#include <Library/UefiLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "NtfsTrace.h"
+
+STATIC CONST CHAR16 *mNtfsTraceOpNames[NtfsTraceMaxOp] = {
+  L"OpenVolume",
+  L"Open",
+  L"Close",
+  L"Delete",
+  L"Read",
+  L"Write",
+  L"GetInfo",
+  L"SetInfo",
+  L"Flush"
+};
+
+/**
+
+  Measure the rate of the time stamp counter.
+
+  @return The number of ticks in a microsecond.
+
+**/
+STATIC
+UINT64
+NtfsTraceTicksPerMicrosecond (
+  VOID
+  )
+{
+  UINT64  Start;
+  UINT64  Ticks;
+
+  Start = AsmReadTsc ();
+  gBS->Stall (10000);
+  Ticks = DivU64x32 (AsmReadTsc () - Start, 10000);
+
+  return (Ticks == 0) ? 1 : Ticks;
+}
+
+/**
+
+  Dump the statistics of the library caches of a volume.
+
+  @param  Trace                 - The trace protocol of the volume.
+
+**/
+STATIC
+VOID
+NtfsTraceDumpCaches (
+  IN NTFS_TRACE_PROTOCOL  *Trace
+  )
+{
+  EFI_STATUS           Status;
+  NTFS_CACHE_COUNTERS  *Caches;
+  UINTN                Count;
+  UINTN                Number;
+  UINT64               Ratio;
+
+  if (Trace->Revision < 0x00010001) {
+    return;
+  }
+
+  Count  = 0;
+  Status = Trace->GetCacheStats (Trace, &Count, NULL);
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    Print (L"  Cannot get the cache statistics: %r\n", Status);
+    return;
+  }
+
+  Caches = AllocatePool (Count * sizeof (NTFS_CACHE_COUNTERS));
+  if (Caches == NULL) {
+    Print (L"  Cannot get the cache statistics: %r\n", EFI_OUT_OF_RESOURCES);
+    return;
+  }
+
+  Status = Trace->GetCacheStats (Trace, &Count, Caches);
+  if (EFI_ERROR (Status)) {
+    Print (L"  Cannot get the cache statistics: %r\n", Status);
+  } else {
+    Print (L"  %-8s %8s %12s %12s %12s %7s\n",
+      L"Cache", L"Entries", L"Lookups", L"Hits", L"Inserts", L"Hits(%)");
+    for (Number = 0; Number < Count; Number++) {
+      if (Caches[Number].Entries == 0) {
+        continue;
+      }
+      Ratio = 0;
+      if (Caches[Number].Lookups != 0) {
+        Ratio = DivU64x64Remainder (MultU64x32 (Caches[Number].Hits, 1000), Caches[Number].Lookups, NULL);
+      }
+      Print (
+        L"  %-8a %8d %12ld %12ld %12ld %3ld.%ld\n",
+        Caches[Number].Name,
+        Caches[Number].Entries,
+        Caches[Number].Lookups,
+        Caches[Number].Hits,
+        Caches[Number].Inserts,
+        DivU64x32 (Ratio, 10),
+        ModU64x32 (Ratio, 10)
+        );
+    }
+  }
+
+  FreePool (Caches);
+}
+
+/**
+
+  Dump the counters and the events of a volume.
+
+  @param  Index                 - The number of the volume.
+  @param  Trace                 - The trace protocol of the volume.
+  @param  TicksPerUs            - The number of ticks in a microsecond.
+
+**/
+STATIC
+VOID
+NtfsTraceDumpVolume (
+  IN UINTN                Index,
+  IN NTFS_TRACE_PROTOCOL  *Trace,
+  IN UINT64               TicksPerUs
+  )
+{
+  EFI_STATUS            Status;
+  NTFS_VOLUME_COUNTERS  Counters;
+  NTFS_TRACE_EVENT      *Events;
+  NTFS_TRACE_EVENT      *Event;
+  UINTN                 Count;
+  UINTN                 Number;
+  UINT64                Dropped;
+  CONST CHAR16          *OpName;
+
+  Print (L"Volume %d\n", Index);
+
+  Status = Trace->GetCounters (Trace, &Counters);
+  if (EFI_ERROR (Status)) {
+    Print (L"  Cannot get the counters: %r\n", Status);
+    return;
+  }
+
+  Print (L"  Block cache hits      %ld\n", Counters.CacheHits);
+  Print (L"  Block cache misses    %ld\n", Counters.CacheMisses);
+  Print (L"  MFT record reads      %ld\n", Counters.MftRecordReads);
+  Print (L"  Index block reads     %ld\n", Counters.IndexBlockReads);
+  Print (L"  Device reads          %ld (%ld bytes)\n", Counters.DeviceReads, Counters.DeviceBytesRead);
+  Print (L"  Device writes         %ld (%ld bytes)\n", Counters.DeviceWrites, Counters.DeviceBytesWritten);
+
+  NtfsTraceDumpCaches (Trace);
+
+  Events = AllocatePool (NTFS_TRACE_EVENTS * sizeof (NTFS_TRACE_EVENT));
+  if (Events == NULL) {
+    Print (L"  Cannot get the events: %r\n", EFI_OUT_OF_RESOURCES);
+    return;
+  }
+
+  Count  = NTFS_TRACE_EVENTS;
+  Status = Trace->GetEvents (Trace, &Count, Events, &Dropped);
+  if (Status == EFI_UNSUPPORTED) {
+    Print (L"  No events, the driver is built without NTFS_TRACE\n");
+  } else if (EFI_ERROR (Status)) {
+    Print (L"  Cannot get the events: %r\n", Status);
+  } else {
+    Print (L"  %d events, %ld dropped\n", Count, Dropped);
+    Print (L"  %12s %-10s %16s %8s %10s %6s %6s %10s\n",
+      L"Start(us)", L"Op", L"Handle", L"Path", L"Bytes", L"Reads", L"Writes", L"Time(us)");
+    for (Number = 0; Number < Count; Number++) {
+      Event  = &Events[Number];
+      OpName = (Event->Op < NtfsTraceMaxOp) ? mNtfsTraceOpNames[Event->Op] : L"?";
+      Print (
+        L"  %12ld %-10s %16lx %08x %10ld %6d %6d %10ld\n",
+        DivU64x64Remainder (Event->Tick - Events[0].Tick, TicksPerUs, NULL),
+        OpName,
+        Event->Handle,
+        Event->PathHash,
+        Event->Bytes,
+        Event->DeviceReads,
+        Event->DeviceWrites,
+        DivU64x64Remainder (Event->Elapsed, TicksPerUs, NULL)
+        );
+    }
+  }
+
+  FreePool (Events);
+}
+
+/**
+
+  Entry point of the application.
+
+  @param  ImageHandle           - The image handle of the application.
+  @param  SystemTable           - The system table.
+
+  @retval EFI_SUCCESS           - The volumes are dumped.
+  @retval EFI_INVALID_PARAMETER - The command line is not valid.
+  @retval EFI_NOT_FOUND         - No NTFS volume is mounted.
+
+**/
+EFI_STATUS
+EFIAPI
+NtfsTraceMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *Parameters;
+  EFI_HANDLE                     *Handles;
+  UINTN                          HandleCount;
+  UINTN                          Index;
+  NTFS_TRACE_PROTOCOL            *Trace;
+  BOOLEAN                        Reset;
+  UINT64                         TicksPerUs;
+
+  Reset  = FALSE;
+  Status = gBS->HandleProtocol (ImageHandle, &gEfiShellParametersProtocolGuid, (VOID **) &Parameters);
+  if (!EFI_ERROR (Status) && Parameters->Argc > 1) {
+    if (Parameters->Argc != 2 || StrCmp (Parameters->Argv[1], L"-r") != 0) {
+      Print (L"Usage: NtfsTrace [-r]\n");
+      return EFI_INVALID_PARAMETER;
+    }
+    Reset = TRUE;
+  }
+
+  Status = gBS->LocateHandleBuffer (ByProtocol, &gNtfsTraceProtocolGuid, NULL, &HandleCount, &Handles);
+  if (EFI_ERROR (Status)) {
+    Print (L"No NTFS volume\n");
+    return EFI_NOT_FOUND;
+  }
+
+  TicksPerUs = NtfsTraceTicksPerMicrosecond ();
+
+  for (Index = 0; Index < HandleCount; Index++) {
+    Status = gBS->HandleProtocol (Handles[Index], &gNtfsTraceProtocolGuid, (VOID **) &Trace);
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+
+    NtfsTraceDumpVolume (Index, Trace, TicksPerUs);
+    if (Reset) {
+      Trace->Reset (Trace);
+    }
+  }
+
+  FreePool (Handles);
+  return EFI_SUCCESS;
+}